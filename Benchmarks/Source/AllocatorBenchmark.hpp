@@ -0,0 +1,160 @@
+
+// Copyright 2019 Nikita Fediuchin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+#include "Benchmark.hpp"
+#include "Engine/BuddyAllocator.hpp"
+
+#include <map>
+#include <random>
+
+// Allocate or free operation count
+const size_t AllocatorBenchmarkOperationCount = 1000000;
+// Managed range size (same as the default device memory block)
+const uint64_t AllocatorBenchmarkBlockSize = 64 * 1024 * 1024;
+// Minimal allocation size (same as the device memory suballocation minimum)
+const uint64_t AllocatorBenchmarkMinSize = 512;
+// Maximal request size (buffer sized requests, larger ones get dedicated memory)
+const uint64_t AllocatorBenchmarkMaxSize = 64 * 1024;
+// Operation count between the fragmentation samples
+const size_t AllocatorBenchmarkSampleInterval = 1000;
+
+// Random allocator request (size and power of two alignment)
+struct AllocatorRequest
+{
+	// Requested size in bytes
+	uint64_t size;
+	// Requested alignment in bytes
+	uint64_t alignment;
+};
+
+// Returns a new random allocator request
+inline AllocatorRequest CreateAllocatorRequest(mt19937_64& random)
+{
+	return { 1 + random() % AllocatorBenchmarkMaxSize, 1ull << (random() % 9) };
+}
+
+// Checks allocated blocks against the live block map (no overlap, requested alignment)
+inline void RunCheckedAllocatorCycles(size_t operationCount)
+{
+	BuddyAllocator allocator(AllocatorBenchmarkBlockSize, AllocatorBenchmarkMinSize);
+	mt19937_64 random(1);
+	map<uint64_t, uint64_t> liveBlocks;
+	vector<uint64_t> offsets;
+
+	for (size_t i = 0; i < operationCount; i++)
+	{
+		if (offsets.empty() || random() % 2)
+		{
+			auto request = CreateAllocatorRequest(random);
+			uint64_t offset;
+
+			if (!allocator.Allocate(request.size, request.alignment, offset))
+				continue;
+
+			auto blockSize = NextPowerOfTwo(max(max(request.size, request.alignment), AllocatorBenchmarkMinSize));
+			CheckBenchmark(offset % request.alignment == 0, "allocation is not aligned");
+
+			auto next = liveBlocks.lower_bound(offset);
+			CheckBenchmark(next == liveBlocks.end() || next->first >= offset + blockSize, "allocation overlaps the next block");
+			CheckBenchmark(next == liveBlocks.begin() || prev(next)->first + prev(next)->second <= offset, "allocation overlaps the previous block");
+
+			liveBlocks[offset] = blockSize;
+			offsets.push_back(offset);
+		}
+		else
+		{
+			auto index = random() % offsets.size();
+			auto offset = offsets[index];
+			offsets[index] = offsets.back();
+			offsets.pop_back();
+
+			liveBlocks.erase(offset);
+			allocator.Free(offset);
+		}
+	}
+
+	for (auto offset : offsets)
+		allocator.Free(offset);
+
+	CheckBenchmark(allocator.IsEmpty() && allocator.GetLargestFreeBlock() == AllocatorBenchmarkBlockSize, "allocator is not empty after freeing every block");
+}
+
+// Runs 1M random allocate and free cycles on the device memory block allocator
+// Prints time per operation and fragmentation (largest free block share of the free space), then checks the results.
+inline void RunAllocatorBenchmark(const BenchmarkOptions& options)
+{
+	auto operationCount = options.isQuick ? AllocatorBenchmarkOperationCount / 10 : AllocatorBenchmarkOperationCount;
+
+	BuddyAllocator allocator(AllocatorBenchmarkBlockSize, AllocatorBenchmarkMinSize);
+	mt19937_64 random(1);
+	vector<AllocatorRequest> requests(operationCount);
+	vector<uint64_t> choices(operationCount);
+	vector<uint64_t> offsets;
+	offsets.reserve(operationCount);
+
+	// Requests are generated up front, so the timing contains only the allocator
+	for (size_t i = 0; i < operationCount; i++)
+	{
+		requests[i] = CreateAllocatorRequest(random);
+		choices[i] = random();
+	}
+
+	size_t failedCount = 0, sampleCount = 0;
+	double totalFragmentation = 0.0, maxFragmentation = 0.0;
+	auto startTime = chrono::high_resolution_clock::now();
+
+	for (size_t i = 0; i < operationCount; i++)
+	{
+		if (offsets.empty() || choices[i] % 2)
+		{
+			uint64_t offset;
+
+			if (allocator.Allocate(requests[i].size, requests[i].alignment, offset))
+				offsets.push_back(offset);
+			else
+				failedCount++;
+		}
+		else
+		{
+			auto index = (choices[i] >> 1) % offsets.size();
+			allocator.Free(offsets[index]);
+			offsets[index] = offsets.back();
+			offsets.pop_back();
+		}
+
+		// Sampling is one operation of the interval, so it stays in the timing
+		if (i % AllocatorBenchmarkSampleInterval != 0)
+			continue;
+
+		auto freeSize = allocator.GetSize() - allocator.GetUsedSize();
+
+		if (freeSize == 0)
+			continue;
+
+		auto fragmentation = 1.0 - static_cast<double>(allocator.GetLargestFreeBlock()) / freeSize;
+		totalFragmentation += fragmentation;
+		maxFragmentation = max(maxFragmentation, fragmentation);
+		sampleCount++;
+	}
+
+	auto totalTime = GetElapsedTime(startTime);
+
+	cout << "Buddy allocator " << operationCount << " operations: " << totalTime / operationCount * 1000000000.0 << " ns per operation, " <<
+		failedCount << " failed allocations, " << totalFragmentation / max(sampleCount, static_cast<size_t>(1)) * 100.0 << "% average and " <<
+		maxFragmentation * 100.0 << "% max fragmentation" << endl;
+
+	RunCheckedAllocatorCycles(operationCount);
+}
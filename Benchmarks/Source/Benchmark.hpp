@@ -0,0 +1,168 @@
+
+// Copyright 2019 Nikita Fediuchin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+#include <chrono>
+#include <string>
+#include <vector>
+#include <thread>
+#include <cstdint>
+#include <iostream>
+#include <stdexcept>
+#include <algorithm>
+
+#if defined(__linux__)
+#include <cerrno>
+#include <cstring>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+using namespace std;
+
+// Benchmark result check exception container class
+class BenchmarkException : public runtime_error
+{
+public:
+	// Creates a new benchmark exception class instance
+	BenchmarkException(const string& message) : runtime_error(message) { }
+	// Creates a new benchmark exception class instance
+	BenchmarkException(const char* message) : runtime_error(message) { }
+};
+
+// Benchmark run options
+struct BenchmarkOptions
+{
+	// Are problem sizes reduced (sanitizer and smoke runs)
+	bool isQuick;
+	// Maximal thread count of the scaling runs
+	size_t maxThreadCount;
+};
+
+// Benchmark description
+struct Benchmark
+{
+	// Benchmark name (command line argument)
+	const char* name;
+	// Benchmark description (usage output)
+	const char* description;
+	// Runs benchmark and prints its results (throws if a result check fails)
+	void (*run)(const BenchmarkOptions& options);
+};
+
+// Returns seconds since the start time
+inline double GetElapsedTime(chrono::high_resolution_clock::time_point startTime)
+{
+	return chrono::duration<double>(chrono::high_resolution_clock::now() - startTime).count();
+}
+
+// Returns thread counts of the scaling runs (powers of two and the maximal count)
+inline vector<size_t> GetScalingThreadCounts(size_t maxThreadCount)
+{
+	vector<size_t> threadCounts;
+
+	for (size_t threadCount = 1; threadCount < maxThreadCount; threadCount *= 2)
+		threadCounts.push_back(threadCount);
+
+	threadCounts.push_back(max(maxThreadCount, static_cast<size_t>(1)));
+	return threadCounts;
+}
+
+// Throws benchmark exception if the result check failed
+inline void CheckBenchmark(bool condition, const string& message)
+{
+	if (!condition)
+		throw BenchmarkException("Benchmark check failed: " + message);
+}
+
+// Hardware cache miss counter of the calling thread (Linux perf events, not available on the other platforms)
+class CacheMissCounter
+{
+protected:
+	// Perf event file descriptor (-1 if counter is not available)
+	int descriptor;
+	// Reason why counter is not available
+	string error;
+public:
+	// Creates a new cache miss counter instance (check IsAvailable, virtual machines often have no counters)
+	CacheMissCounter()
+	{
+		descriptor = -1;
+
+#if defined(__linux__)
+		perf_event_attr attributes = {};
+		attributes.size = sizeof(perf_event_attr);
+		attributes.type = PERF_TYPE_HARDWARE;
+		attributes.config = PERF_COUNT_HW_CACHE_MISSES;
+		attributes.disabled = 1;
+		attributes.exclude_kernel = 1;
+		attributes.exclude_hv = 1;
+
+		descriptor = static_cast<int>(syscall(SYS_perf_event_open, &attributes, 0, -1, -1, 0));
+
+		if (descriptor < 0)
+			error = string("perf_event_open failed: ") + strerror(errno);
+#else
+		error = "no perf events on this platform";
+#endif
+	}
+	// Destroys cache miss counter instance
+	~CacheMissCounter()
+	{
+#if defined(__linux__)
+		if (descriptor >= 0)
+			close(descriptor);
+#endif
+	}
+
+	CacheMissCounter(const CacheMissCounter&) = delete;
+	CacheMissCounter& operator=(const CacheMissCounter&) = delete;
+
+	// Returns true if hardware counter is available
+	bool IsAvailable() { return descriptor >= 0; }
+	// Returns reason why counter is not available
+	const string& GetError() { return error; }
+
+	// Resets and starts counting
+	void Start()
+	{
+#if defined(__linux__)
+		if (descriptor < 0)
+			return;
+
+		ioctl(descriptor, PERF_EVENT_IOC_RESET, 0);
+		ioctl(descriptor, PERF_EVENT_IOC_ENABLE, 0);
+#endif
+	}
+	// Stops counting, returns cache miss count since the start (zero if counter is not available)
+	uint64_t Stop()
+	{
+		uint64_t count = 0;
+
+#if defined(__linux__)
+		if (descriptor < 0)
+			return 0;
+
+		ioctl(descriptor, PERF_EVENT_IOC_DISABLE, 0);
+
+		if (read(descriptor, &count, sizeof(uint64_t)) != sizeof(uint64_t))
+			count = 0;
+#endif
+
+		return count;
+	}
+};
@@ -0,0 +1,93 @@
+
+// Copyright 2019 Nikita Fediuchin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+#include "Benchmark.hpp"
+#include "Engine/Transform.hpp"
+
+#include <random>
+
+// Live entity count (kept constant during the churn)
+const size_t ChurnBenchmarkEntityCount = 100000;
+// Remove and add pair count
+const size_t ChurnBenchmarkPairCount = 5000000;
+
+// Removes and adds entities with a transform component millions of times
+// Prints time per remove and add pair, then checks that slots are reused and every removed handle is stale.
+inline void RunChurnBenchmark(const BenchmarkOptions& options)
+{
+	auto pairCount = options.isQuick ? ChurnBenchmarkPairCount / 50 : ChurnBenchmarkPairCount;
+
+	System system;
+	vector<Entity> entities(ChurnBenchmarkEntityCount);
+
+	for (auto& entity : entities)
+	{
+		entity = system.Add();
+		system.AddComponent<Transform>(entity);
+	}
+
+	mt19937 random(3);
+	vector<uint32_t> choices(pairCount);
+
+	for (auto& choice : choices)
+		choice = random() % ChurnBenchmarkEntityCount;
+
+	size_t staleCount = 0;
+	auto startTime = chrono::high_resolution_clock::now();
+
+	for (size_t i = 0; i < pairCount; i++)
+	{
+		auto removed = entities[choices[i]];
+		system.Remove(removed);
+
+		auto entity = system.Add();
+		system.AddComponent<Transform>(entity);
+		entities[choices[i]] = entity;
+
+		// Removed slot is reused by the new entity, so only the generation tells them apart
+		if (!system.Contains(removed))
+			staleCount++;
+	}
+
+	auto totalTime = GetElapsedTime(startTime);
+
+	cout << "Entity churn " << pairCount << " remove and add pairs: " << totalTime / pairCount * 1000000000.0 << " ns per pair, " <<
+		staleCount << " stale handles detected, " << system.GetEntitySlotCount() << " entity slots" << endl;
+
+	CheckBenchmark(staleCount == pairCount, "removed entity handle is still alive");
+	CheckBenchmark(system.GetEntityCount() == ChurnBenchmarkEntityCount, "entity count changed");
+	CheckBenchmark(system.GetEntitySlotCount() == ChurnBenchmarkEntityCount, "removed entity slots were not reused");
+
+	for (auto entity : entities)
+		CheckBenchmark(system.Contains(entity) && system.HasComponent<Transform>(entity), "live entity lost its transform");
+
+	auto staleEntity = entities[0];
+	system.Remove(entities[0]);
+	entities[0] = system.Add();
+
+	auto isThrown = false;
+
+	try
+	{
+		system.GetComponent<Transform>(staleEntity);
+	}
+	catch (const ArgumentException&)
+	{
+		isThrown = true;
+	}
+
+	CheckBenchmark(isThrown, "stale entity handle access did not throw");
+}
@@ -0,0 +1,131 @@
+
+// Copyright 2019 Nikita Fediuchin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+#include "Benchmark.hpp"
+#include "Engine/Scheduler.hpp"
+#include "Engine/Transform.hpp"
+
+// Spawned entity count of the command buffer timing
+const size_t CommandBufferBenchmarkEntityCount = 100000;
+// Scheduler task count of the determinism check
+const size_t CommandBufferBenchmarkTaskCount = 8;
+// Spawned entity count of one scheduler task
+const size_t CommandBufferBenchmarkTaskEntityCount = 1000;
+
+// Benchmark spawn order component (records which task spawned the entity)
+struct BenchmarkSpawnOrder
+{
+	// Component type name (snapshot serialization key)
+	static constexpr const char* ComponentName = "BenchmarkSpawnOrder";
+
+	// Spawning task index
+	uint32_t taskIndex;
+	// Spawn index inside the task
+	uint32_t spawnIndex;
+};
+
+// Runs concurrent spawning tasks through the scheduler, returns entity indices and spawn orders in storage order
+inline vector<uint32_t> RunSpawnTasks(size_t threadCount)
+{
+	System system;
+	JobSystem jobSystem(threadCount - 1);
+	Scheduler scheduler(&jobSystem);
+
+	for (size_t i = 0; i < CommandBufferBenchmarkTaskCount; i++)
+	{
+		SystemTask task;
+		task.name = "Spawn " + to_string(i);
+		task.Read<Transform>();
+		task.execute = [i](System& system, EntityCommandBuffer& commandBuffer)
+		{
+			for (size_t j = 0; j < CommandBufferBenchmarkTaskEntityCount; j++)
+			{
+				auto entity = commandBuffer.Create();
+				commandBuffer.AddComponent<Transform>(entity);
+				commandBuffer.AddComponent<BenchmarkSpawnOrder>(entity, BenchmarkSpawnOrder{ static_cast<uint32_t>(i), static_cast<uint32_t>(j) });
+			}
+		};
+
+		scheduler.Add(task);
+	}
+
+	scheduler.Run(system);
+
+	vector<uint32_t> order;
+	auto query = system.CreateQuery(QueryDescription().Require<BenchmarkSpawnOrder>());
+
+	query->ForEachChunk([&](QueryChunk& chunk)
+	{
+		auto indices = chunk.GetEntityIndices();
+		auto spawnOrders = chunk.GetConst<BenchmarkSpawnOrder>();
+
+		for (uint32_t i = 0; i < chunk.count; i++)
+		{
+			order.push_back(indices[i]);
+			order.push_back(spawnOrders[i].taskIndex);
+			order.push_back(spawnOrders[i].spawnIndex);
+		}
+	});
+
+	system.DestroyQuery(query);
+	return order;
+}
+
+// Spawns entities through a command buffer and directly, then checks that scheduler playback order does not depend on the thread count
+inline void RunCommandBufferBenchmark(const BenchmarkOptions& options)
+{
+	auto entityCount = options.isQuick ? CommandBufferBenchmarkEntityCount / 10 : CommandBufferBenchmarkEntityCount;
+
+	System commandSystem, directSystem;
+	EntityCommandBuffer commandBuffer;
+
+	auto startTime = chrono::high_resolution_clock::now();
+
+	for (size_t i = 0; i < entityCount; i++)
+	{
+		auto entity = commandBuffer.Create();
+		commandBuffer.AddComponent<Transform>(entity);
+		commandBuffer.AddComponent<BenchmarkSpawnOrder>(entity, BenchmarkSpawnOrder{ 0, static_cast<uint32_t>(i) });
+	}
+
+	commandBuffer.Playback(commandSystem);
+	auto commandTime = GetElapsedTime(startTime);
+	startTime = chrono::high_resolution_clock::now();
+
+	for (size_t i = 0; i < entityCount; i++)
+	{
+		auto entity = directSystem.Add();
+		directSystem.AddComponent<Transform>(entity);
+		directSystem.AddComponent<BenchmarkSpawnOrder>(entity, BenchmarkSpawnOrder{ 0, static_cast<uint32_t>(i) });
+	}
+
+	auto directTime = GetElapsedTime(startTime);
+
+	cout << "Spawn " << entityCount << " entities: command buffer " << commandTime / entityCount * 1000000000.0 << " ns per entity, direct " <<
+		directTime / entityCount * 1000000000.0 << " ns per entity" << endl;
+
+	CheckBenchmark(commandSystem.GetEntityCount() == entityCount, "command buffer playback lost entities");
+	// Playback places entities directly into the final archetype, only the system empty archetype is created besides it
+	CheckBenchmark(commandSystem.GetArchetypes().size() == 2, "command buffer playback created intermediate archetypes");
+
+	auto expectedOrder = RunSpawnTasks(1);
+	CheckBenchmark(expectedOrder.size() == CommandBufferBenchmarkTaskCount * CommandBufferBenchmarkTaskEntityCount * 3, "scheduler playback lost entities");
+
+	for (auto threadCount : GetScalingThreadCounts(options.maxThreadCount))
+		CheckBenchmark(RunSpawnTasks(threadCount) == expectedOrder, "scheduler playback order depends on the thread count");
+
+	cout << "Scheduler playback of " << CommandBufferBenchmarkTaskCount << " spawning tasks is identical with 1.." << options.maxThreadCount << " threads" << endl;
+}
@@ -0,0 +1,182 @@
+
+// Copyright 2019 Nikita Fediuchin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+#include "Benchmark.hpp"
+#include "Engine/Transform.hpp"
+
+#include <random>
+#include <memory>
+
+// Iterated entity count
+const size_t ComponentBenchmarkEntityCount = 1000000;
+// Timed iteration count (best time is reported)
+const size_t ComponentBenchmarkIterationCount = 10;
+
+// Benchmark velocity component (iterated together with the transform)
+struct BenchmarkVelocity
+{
+	// Component type name (snapshot serialization key)
+	static constexpr const char* ComponentName = "BenchmarkVelocity";
+
+	// Position change per iteration
+	float value[3];
+};
+
+// Pointer layout component base class (components were heap objects before the archetype storage)
+class PointerComponent
+{
+public:
+	// Destroys pointer component instance
+	virtual ~PointerComponent() { }
+};
+
+// Pointer layout transform component
+class PointerTransform : public PointerComponent
+{
+public:
+	// Transform data
+	Transform transform;
+};
+
+// Pointer layout velocity component
+class PointerVelocity : public PointerComponent
+{
+public:
+	// Velocity data
+	BenchmarkVelocity velocity;
+};
+
+// Pointer layout entity (component pointer array)
+struct PointerEntity
+{
+	// Entity component array
+	vector<PointerComponent*> components;
+};
+
+// Returns initial velocity of the entity
+inline BenchmarkVelocity GetBenchmarkVelocity(size_t index)
+{
+	auto value = static_cast<float>(index % 16);
+	return { { value, 1.0f, -value } };
+}
+
+// Returns sum of the first position coordinates
+inline double SumBenchmarkPositions(const vector<float>& positions)
+{
+	double sum = 0.0;
+
+	for (auto position : positions)
+		sum += position;
+
+	return sum;
+}
+
+// Iterates 1M transforms stored as heap component objects and as archetype chunks
+// Pointer layout entities are shuffled and interleaved with unrelated allocations, as after a play session.
+inline void RunComponentBenchmark(const BenchmarkOptions& options)
+{
+	auto entityCount = options.isQuick ? ComponentBenchmarkEntityCount / 10 : ComponentBenchmarkEntityCount;
+	auto iterationCount = options.isQuick ? static_cast<size_t>(2) : ComponentBenchmarkIterationCount;
+
+	vector<unique_ptr<PointerEntity>> pointerEntities(entityCount);
+	vector<unique_ptr<PointerComponent>> pointerComponents;
+	vector<unique_ptr<uint8_t[]>> fillerAllocations;
+	pointerComponents.reserve(entityCount * 2);
+	fillerAllocations.reserve(entityCount);
+
+	for (size_t i = 0; i < entityCount; i++)
+	{
+		auto transform = new PointerTransform();
+		pointerComponents.emplace_back(transform);
+		fillerAllocations.emplace_back(new uint8_t[64]);
+		auto velocity = new PointerVelocity();
+		velocity->velocity = GetBenchmarkVelocity(i);
+		pointerComponents.emplace_back(velocity);
+
+		pointerEntities[i].reset(new PointerEntity());
+		pointerEntities[i]->components.push_back(transform);
+		pointerEntities[i]->components.push_back(velocity);
+	}
+
+	shuffle(pointerEntities.begin(), pointerEntities.end(), mt19937(1));
+
+	System system;
+	auto query = system.CreateQuery(QueryDescription().Require<Transform>().Require<BenchmarkVelocity>());
+
+	for (size_t i = 0; i < entityCount; i++)
+	{
+		auto entity = system.Add();
+		system.AddComponent<Transform>(entity);
+		system.AddComponent<BenchmarkVelocity>(entity) = GetBenchmarkVelocity(i);
+	}
+
+	double pointerTime = 1e9, chunkTime = 1e9;
+
+	for (size_t iteration = 0; iteration < iterationCount; iteration++)
+	{
+		auto startTime = chrono::high_resolution_clock::now();
+
+		for (auto& entity : pointerEntities)
+		{
+			auto& transform = static_cast<PointerTransform*>(entity->components[0])->transform;
+			auto& velocity = static_cast<PointerVelocity*>(entity->components[1])->velocity;
+
+			for (size_t i = 0; i < 3; i++)
+				transform.position[i] += velocity.value[i];
+		}
+
+		pointerTime = min(pointerTime, GetElapsedTime(startTime));
+		startTime = chrono::high_resolution_clock::now();
+
+		query->ForEachChunk([](QueryChunk& chunk)
+		{
+			auto transforms = chunk.Get<Transform>();
+			auto velocities = chunk.GetConst<BenchmarkVelocity>();
+
+			for (uint32_t i = 0; i < chunk.count; i++)
+			{
+				for (size_t j = 0; j < 3; j++)
+					transforms[i].position[j] += velocities[i].value[j];
+			}
+		});
+
+		chunkTime = min(chunkTime, GetElapsedTime(startTime));
+	}
+
+	cout << "Transform iteration over " << entityCount << " entities: pointer layout " << pointerTime * 1000.0 << " ms, chunked archetypes " <<
+		chunkTime * 1000.0 << " ms (" << pointerTime / chunkTime << "x)" << endl;
+
+	vector<float> pointerPositions, chunkPositions;
+	pointerPositions.reserve(entityCount);
+	chunkPositions.reserve(entityCount);
+
+	for (auto& entity : pointerEntities)
+		pointerPositions.push_back(static_cast<PointerTransform*>(entity->components[0])->transform.position[0]);
+
+	query->ForEachChunk([&](QueryChunk& chunk)
+	{
+		auto transforms = chunk.GetConst<Transform>();
+
+		for (uint32_t i = 0; i < chunk.count; i++)
+			chunkPositions.push_back(transforms[i].position[0]);
+	});
+
+	CheckBenchmark(query->GetEntityCount() == entityCount, "query does not match every entity");
+	CheckBenchmark(chunkPositions.size() == entityCount, "chunk iteration skipped entities");
+	CheckBenchmark(SumBenchmarkPositions(pointerPositions) == SumBenchmarkPositions(chunkPositions), "layouts produced different positions");
+
+	system.DestroyQuery(query);
+}
@@ -0,0 +1,191 @@
+
+// Copyright 2019 Nikita Fediuchin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+#include "Benchmark.hpp"
+#include "Engine/JobSystem.hpp"
+
+#include <atomic>
+
+// Fibonacci number argument of the fork and join timing
+const int JobBenchmarkFibonacciNumber = 32;
+// Smaller Fibonacci numbers are computed without jobs (job cost would dominate)
+const int JobBenchmarkFibonacciCutoff = 12;
+// Element count of the parallel for timing
+const size_t JobBenchmarkElementCount = 10000000;
+// Element count of one parallel for batch
+const size_t JobBenchmarkBatchSize = 65536;
+// Empty job count of the job cost timing
+const size_t JobBenchmarkEmptyJobCount = 1000000;
+// Empty jobs scheduled between the waits (bounded by the worker deque capacity)
+const size_t JobBenchmarkEmptyJobBatch = 1024;
+
+// Returns Fibonacci number computed without jobs
+inline int64_t GetFibonacci(int number)
+{
+	return number < 2 ? number : GetFibonacci(number - 1) + GetFibonacci(number - 2);
+}
+// Returns Fibonacci number computed with nested fork and join jobs
+inline int64_t GetJobFibonacci(JobSystem& jobSystem, int number)
+{
+	if (number < JobBenchmarkFibonacciCutoff)
+		return GetFibonacci(number);
+
+	int64_t first, second;
+	JobCounter counter;
+
+	jobSystem.Schedule([&jobSystem, &first, number]() { first = GetJobFibonacci(jobSystem, number - 1); }, &counter);
+	second = GetJobFibonacci(jobSystem, number - 2);
+	jobSystem.Wait(counter);
+
+	return first + second;
+}
+
+// Checks nested waits, scheduling from a foreign thread and job exception propagation
+inline void CheckJobSystem(JobSystem& jobSystem, size_t roundCount)
+{
+	for (size_t round = 0; round < roundCount; round++)
+	{
+		atomic<size_t> executedCount(0);
+		JobCounter counter;
+
+		for (size_t i = 0; i < 100; i++)
+		{
+			jobSystem.Schedule([&]()
+			{
+				JobCounter nestedCounter;
+
+				for (size_t j = 0; j < 20; j++)
+					jobSystem.Schedule([&]() { executedCount++; }, &nestedCounter);
+
+				jobSystem.Wait(nestedCounter);
+				executedCount++;
+			}, &counter);
+		}
+
+		jobSystem.Wait(counter);
+		CheckBenchmark(executedCount == 2100, "nested jobs were lost");
+	}
+
+	atomic<size_t> foreignCount(0);
+
+	thread foreignThread([&]()
+	{
+		JobCounter counter;
+
+		for (size_t i = 0; i < 1000; i++)
+			jobSystem.Schedule([&]() { foreignCount++; }, &counter);
+
+		jobSystem.Wait(counter);
+	});
+
+	foreignThread.join();
+	CheckBenchmark(foreignCount == 1000, "jobs scheduled from a foreign thread were lost");
+
+	auto isThrown = false;
+
+	try
+	{
+		jobSystem.ParallelFor(1000, 10, [](size_t begin, size_t end)
+		{
+			if (begin <= 500 && 500 < end)
+				throw BenchmarkException("job exception");
+		});
+	}
+	catch (const BenchmarkException&)
+	{
+		isThrown = true;
+	}
+
+	CheckBenchmark(isThrown, "parallel for did not rethrow the job exception");
+}
+
+// Times fork and join Fibonacci, a 10M element parallel for and empty job cost for each thread count, then checks the job system
+inline void RunJobBenchmark(const BenchmarkOptions& options)
+{
+	auto fibonacciNumber = options.isQuick ? JobBenchmarkFibonacciNumber - 8 : JobBenchmarkFibonacciNumber;
+	auto elementCount = options.isQuick ? JobBenchmarkElementCount / 10 : JobBenchmarkElementCount;
+	auto emptyJobCount = options.isQuick ? JobBenchmarkEmptyJobCount / 10 : JobBenchmarkEmptyJobCount;
+	auto repeatCount = options.isQuick ? 1 : 5;
+
+	vector<float> data(elementCount, 0.0f);
+	auto expectedFibonacci = GetFibonacci(fibonacciNumber);
+
+	double sequentialTime = 1e9;
+
+	for (int i = 0; i < repeatCount; i++)
+	{
+		auto startTime = chrono::high_resolution_clock::now();
+
+		for (auto& value : data)
+			value += 1.0f;
+
+		sequentialTime = min(sequentialTime, GetElapsedTime(startTime));
+	}
+
+	cout << "Sequential " << elementCount << " element loop: " << sequentialTime * 1000.0 << " ms" << endl;
+
+	auto threadCounts = GetScalingThreadCounts(options.maxThreadCount);
+
+	for (auto threadCount : threadCounts)
+	{
+		JobSystem jobSystem(threadCount - 1);
+
+		auto startTime = chrono::high_resolution_clock::now();
+		auto fibonacci = GetJobFibonacci(jobSystem, fibonacciNumber);
+		auto fibonacciTime = GetElapsedTime(startTime);
+		CheckBenchmark(fibonacci == expectedFibonacci, "job Fibonacci number differs");
+
+		double parallelForTime = 1e9;
+
+		for (int i = 0; i < repeatCount; i++)
+		{
+			startTime = chrono::high_resolution_clock::now();
+
+			jobSystem.ParallelFor(data.size(), JobBenchmarkBatchSize, [&](size_t begin, size_t end)
+			{
+				for (size_t j = begin; j < end; j++)
+					data[j] += 1.0f;
+			});
+
+			parallelForTime = min(parallelForTime, GetElapsedTime(startTime));
+		}
+
+		JobCounter counter;
+		startTime = chrono::high_resolution_clock::now();
+
+		for (size_t i = 0; i < emptyJobCount; i++)
+		{
+			jobSystem.Schedule([]() { }, &counter);
+
+			if (i % JobBenchmarkEmptyJobBatch == JobBenchmarkEmptyJobBatch - 1)
+				jobSystem.Wait(counter);
+		}
+
+		jobSystem.Wait(counter);
+		auto emptyJobTime = GetElapsedTime(startTime);
+
+		cout << threadCount << " threads: fib(" << fibonacciNumber << ") " << fibonacciTime * 1000.0 << " ms, parallel for " <<
+			parallelForTime * 1000.0 << " ms, empty job " << emptyJobTime / emptyJobCount * 1000000000.0 << " ns" << endl;
+
+		CheckJobSystem(jobSystem, options.isQuick ? 20 : 200);
+	}
+
+	// Every loop increments each element once (counts stay exact in float)
+	auto expectedValue = static_cast<float>(repeatCount * (threadCounts.size() + 1));
+
+	for (auto value : data)
+		CheckBenchmark(value == expectedValue, "parallel for skipped elements");
+}
@@ -0,0 +1,58 @@
+
+// Copyright 2019 Nikita Fediuchin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+#include "Benchmark.hpp"
+#include "Engine/Graphics.hpp"
+
+// Measured frame count per loop mode
+const uint64_t LatencyBenchmarkFrameCount = 500;
+// Busy simulated update time per frame
+const double LatencyBenchmarkUpdateTime = 0.004;
+// Offscreen frame size
+const VkExtent2D LatencyBenchmarkFrameSize = { 800, 600 };
+
+// Renders headless frames with a busy simulated update on one thread and with the render thread
+// Prints frame time and input to submit latency of both loop modes.
+inline void RunLatencyBenchmark(const BenchmarkOptions& options)
+{
+	auto frameCount = options.isQuick ? LatencyBenchmarkFrameCount / 10 : LatencyBenchmarkFrameCount;
+
+	for (auto isRenderThreaded : { false, true })
+	{
+		auto graphics = Graphics::CreateHeadless(LatencyBenchmarkFrameSize, "Latency Benchmark", VK_MAKE_VERSION(0, 1, 0), {}, {}, {}, 2, isRenderThreaded);
+		auto startTime = chrono::high_resolution_clock::now();
+
+		graphics.RenderFrames(frameCount, [](RenderPacket& packet)
+		{
+			auto updateStartTime = chrono::high_resolution_clock::now();
+
+			while (GetElapsedTime(updateStartTime) < LatencyBenchmarkUpdateTime)
+				this_thread::yield();
+
+			packet.clearColor[0] = static_cast<float>(packet.frameIndex % 256) / 255.0f;
+			packet.clearColor[3] = 1.0f;
+		});
+
+		auto totalTime = GetElapsedTime(startTime);
+		auto frameTimes = graphics.GetFrameTimeSummary();
+
+		cout << (isRenderThreaded ? "Render thread: " : "Single thread: ") << totalTime / frameCount * 1000.0 << " ms per frame (" <<
+			frameTimes.p99Time * 1000.0 << " ms p99), input to submit latency " << graphics.GetAverageSubmitLatency() * 1000.0 << " ms average, " <<
+			graphics.GetMaxSubmitLatency() * 1000.0 << " ms max" << endl;
+
+		CheckBenchmark(graphics.GetSubmittedFrameCount() == frameCount, "submitted frame count differs");
+	}
+}
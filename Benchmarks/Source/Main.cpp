@@ -0,0 +1,116 @@
+
+// Copyright 2019 Nikita Fediuchin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "Benchmark.hpp"
+#include "AllocatorBenchmark.hpp"
+#include "ChurnBenchmark.hpp"
+#include "CommandBufferBenchmark.hpp"
+#include "ComponentBenchmark.hpp"
+#include "JobBenchmark.hpp"
+#include "PoolBenchmark.hpp"
+#include "RenderQueueBenchmark.hpp"
+#include "SnapshotBenchmark.hpp"
+#include "TransformBenchmark.hpp"
+
+#if !defined(NO_VULKAN_BENCHMARKS)
+#include "LatencyBenchmark.hpp"
+#include "RecordBenchmark.hpp"
+#endif
+
+#include <cstdlib>
+#include <cstring>
+
+// Engine benchmark array (Vulkan benchmarks need a device and a window, NO_VULKAN_BENCHMARKS builds leave them out)
+const vector<Benchmark> benchmarks =
+{
+	{ "allocator", "1M random allocate and free cycles of the device memory block allocator", RunAllocatorBenchmark },
+	{ "churn", "5M entity remove and add pairs with generational handle checks", RunChurnBenchmark },
+	{ "commands", "100k entity spawns through a command buffer and directly, scheduler playback determinism", RunCommandBufferBenchmark },
+	{ "component", "1M transform iteration, heap component pointers against chunked archetype storage", RunComponentBenchmark },
+	{ "jobs", "Fork and join Fibonacci, 10M element parallel for and empty job cost with 1..N threads", RunJobBenchmark },
+	{ "pool", "Chunk pool against the global allocator with cache miss counts, chunk boundary churn", RunPoolBenchmark },
+	{ "queue", "Render queue packet transfer and the modelled frame loop with and without the render thread", RunRenderQueueBenchmark },
+	{ "snapshot", "1M entity world snapshot save and load against an entity by entity rebuild", RunSnapshotBenchmark },
+	{ "transform", "100k animated transforms in a 6 level hierarchy with 1..N threads against the 2 ms single core budget", RunTransformBenchmark },
+#if !defined(NO_VULKAN_BENCHMARKS)
+	{ "latency", "Headless frames with a busy simulated update, input to submit latency with and without the render thread", RunLatencyBenchmark },
+	{ "record", "100k draws recorded into secondary command buffers with 1..N threads", RunRecordBenchmark },
+#endif
+};
+
+// Prints command line usage and the benchmark list
+void PrintUsage()
+{
+	cout << "Usage: Benchmarks [--quick] [--threads <count>] [benchmark names...]" << endl;
+	cout << "Runs all benchmarks if no name is given, --quick reduces problem sizes for the sanitizer runs." << endl;
+
+	for (auto& benchmark : benchmarks)
+		cout << "  " << benchmark.name << " - " << benchmark.description << endl;
+}
+
+int main(int argc, char* argv[])
+{
+	BenchmarkOptions options = {};
+	options.isQuick = false;
+	options.maxThreadCount = max(thread::hardware_concurrency(), 1u);
+
+	vector<const Benchmark*> selected;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--quick") == 0)
+		{
+			options.isQuick = true;
+			continue;
+		}
+		else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+		{
+			options.maxThreadCount = max(static_cast<size_t>(strtoull(argv[++i], nullptr, 10)), static_cast<size_t>(1));
+			continue;
+		}
+
+		auto benchmark = find_if(benchmarks.begin(), benchmarks.end(), [&](const Benchmark& b) { return strcmp(b.name, argv[i]) == 0; });
+
+		if (benchmark == benchmarks.end())
+		{
+			PrintUsage();
+			return EXIT_FAILURE;
+		}
+
+		selected.push_back(&*benchmark);
+	}
+
+	if (selected.empty())
+	{
+		for (auto& benchmark : benchmarks)
+			selected.push_back(&benchmark);
+	}
+
+	try
+	{
+		for (auto benchmark : selected)
+		{
+			cout << "[" << benchmark->name << "]" << endl;
+			benchmark->run(options);
+		}
+	}
+	catch (const std::exception& e)
+	{
+		cerr << e.what() << endl;
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,161 @@
+
+// Copyright 2019 Nikita Fediuchin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+#include "Benchmark.hpp"
+#include "Engine/Transform.hpp"
+
+#include <random>
+#include <sstream>
+
+// Live block count of one allocate and free round
+const size_t PoolBenchmarkBlockCount = 4096;
+// Allocate and free round count
+const size_t PoolBenchmarkRoundCount = 200;
+// Add and remove count at the chunk boundary
+const size_t PoolBenchmarkBoundaryCount = 1000000;
+
+// Allocate and free round timing result
+struct PoolBenchmarkResult
+{
+	// Time per allocate and free pair in seconds
+	double time;
+	// Cache misses per allocate and free pair
+	double cacheMisses;
+};
+
+// Runs allocate, touch and shuffled free rounds with the given allocate and free functions
+template<class Allocate, class Free>
+inline PoolBenchmarkResult RunPoolRounds(CacheMissCounter& counter, size_t roundCount, Allocate allocate, Free free)
+{
+	vector<void*> blocks(PoolBenchmarkBlockCount);
+	vector<size_t> order(PoolBenchmarkBlockCount);
+	mt19937 random(1);
+
+	for (size_t i = 0; i < order.size(); i++)
+		order[i] = i;
+
+	// Free orders are generated up front, so the timing contains only the allocator
+	vector<vector<size_t>> orders(roundCount);
+
+	for (auto& roundOrder : orders)
+	{
+		shuffle(order.begin(), order.end(), random);
+		roundOrder = order;
+	}
+
+	counter.Start();
+	auto startTime = chrono::high_resolution_clock::now();
+
+	for (auto& roundOrder : orders)
+	{
+		// Each block is touched as a chunk header write would
+		for (size_t i = 0; i < blocks.size(); i++)
+		{
+			blocks[i] = allocate();
+			static_cast<volatile uint64_t*>(blocks[i])[1] = i;
+		}
+
+		for (auto index : roundOrder)
+			free(blocks[index]);
+	}
+
+	auto totalTime = GetElapsedTime(startTime);
+	auto cacheMisses = counter.Stop();
+	auto pairCount = static_cast<double>(roundCount * PoolBenchmarkBlockCount);
+	return { totalTime / pairCount, cacheMisses / pairCount };
+}
+
+// Returns printable cache misses per pair
+inline string FormatCacheMisses(CacheMissCounter& counter, double cacheMisses)
+{
+	if (!counter.IsAvailable())
+		return "cache misses not available";
+
+	stringstream stream;
+	stream << cacheMisses << " cache misses";
+	return stream.str();
+}
+
+// Compares the chunk pool allocator with the global aligned allocator, then churns an archetype at its chunk boundary
+// Cache misses are read from the hardware counters if the platform exposes them.
+inline void RunPoolBenchmark(const BenchmarkOptions& options)
+{
+	auto roundCount = options.isQuick ? PoolBenchmarkRoundCount / 20 : PoolBenchmarkRoundCount;
+	auto boundaryCount = options.isQuick ? PoolBenchmarkBoundaryCount / 20 : PoolBenchmarkBoundaryCount;
+
+	CacheMissCounter counter;
+
+	if (!counter.IsAvailable())
+		cout << "Cache miss counter is not available (" << counter.GetError() << ")" << endl;
+
+	for (size_t blockSize : { static_cast<size_t>(64), ArchetypeChunkSize })
+	{
+		auto slabBlockCount = blockSize == ArchetypeChunkSize ? ArchetypeChunkSlabSize : static_cast<size_t>(1024);
+		PoolAllocator pool(blockSize, slabBlockCount, 64);
+
+		auto poolResult = RunPoolRounds(counter, roundCount,
+			[&]() { return pool.Allocate(); },
+			[&](void* block) { pool.Free(block); });
+		auto globalResult = RunPoolRounds(counter, roundCount,
+			[&]() { return operator new(blockSize, align_val_t(64)); },
+			[&](void* block) { operator delete(block, align_val_t(64)); });
+
+		cout << "Block size " << blockSize << ": pool " << poolResult.time * 1000000000.0 << " ns per pair (" <<
+			FormatCacheMisses(counter, poolResult.cacheMisses) << "), global " << globalResult.time * 1000000000.0 << " ns per pair (" <<
+			FormatCacheMisses(counter, globalResult.cacheMisses) << "), " << pool.GetSlabCount() << " pool slabs" << endl;
+
+		CheckBenchmark(pool.GetAllocationCount() == 0, "pool blocks were not freed");
+		CheckBenchmark(pool.GetSlabCount() == (PoolBenchmarkBlockCount + slabBlockCount - 1) / slabBlockCount, "pool reserved more than the peak usage");
+	}
+
+	// Removing the only entity of the last chunk frees it, the next add allocates it again
+	System system;
+	vector<Entity> entities;
+
+	for (size_t i = 0; i < 1000; i++)
+	{
+		entities.push_back(system.Add());
+		system.AddComponent<Transform>(entities.back());
+	}
+
+	auto capacity = system.GetArchetypes().back()->GetCapacity();
+
+	while (entities.size() % capacity != 0)
+	{
+		system.Remove(entities.back());
+		entities.pop_back();
+	}
+
+	auto chunkCount = system.GetChunkPool()->GetAllocationCount();
+	counter.Start();
+	auto startTime = chrono::high_resolution_clock::now();
+
+	for (size_t i = 0; i < boundaryCount; i++)
+	{
+		auto entity = system.Add();
+		system.AddComponent<Transform>(entity);
+		system.Remove(entity);
+	}
+
+	auto totalTime = GetElapsedTime(startTime);
+	auto cacheMisses = counter.Stop();
+
+	cout << "Chunk boundary churn " << boundaryCount << " add and remove pairs: " << totalTime / boundaryCount * 1000000000.0 << " ns per pair (" <<
+		FormatCacheMisses(counter, static_cast<double>(cacheMisses) / boundaryCount) << "), " << system.GetChunkPool()->GetSlabCount() << " pool slabs" << endl;
+
+	CheckBenchmark(system.GetChunkPool()->GetAllocationCount() == chunkCount, "chunk boundary churn leaked chunks");
+	CheckBenchmark(system.GetChunkPool()->GetSlabCount() == 1, "chunk boundary churn grew the chunk pool");
+}
@@ -0,0 +1,161 @@
+
+// Copyright 2019 Nikita Fediuchin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+#include "Benchmark.hpp"
+#include "Engine/Vulkan/Window.hpp"
+
+using namespace Vulkan;
+
+// Recorded triangle draw count per frame
+const uint32_t RecordBenchmarkDrawCount = 100000;
+// Measured frame count per thread count
+const uint32_t RecordBenchmarkFrameCount = 100;
+// Frame count before the measurement (pools and driver allocations reach their steady size)
+const uint32_t RecordBenchmarkWarmupFrameCount = 10;
+
+// Vulkan window which records the fixed triangle draw count split between the record threads
+class RecordBenchmarkWindow_T : public Window_T
+{
+protected:
+	// Triangle draw count per frame
+	uint32_t drawCount;
+
+public:
+	// Creates a new record benchmark window instance
+	RecordBenchmarkWindow_T(GlfwWindow glfwWindow, VkExtent2D windowSize, const vector<const char*>& vulkanExtensions, const vector<const char*>& deviceExtensions, JobSystem* jobSystem, uint32_t _drawCount) :
+		Window_T(glfwWindow, windowSize, "Record Benchmark", VK_MAKE_VERSION(0, 1, 0), vulkanExtensions, {}, deviceExtensions, 2, jobSystem)
+	{
+		drawCount = _drawCount;
+	}
+
+protected:
+	// Records the thread part of the triangle draws (each secondary command buffer binds its own state)
+	void RecordDrawCommands(VkCommandBuffer commandBuffer, size_t threadIndex, size_t threadCount) override
+	{
+		auto begin = drawCount * threadIndex / threadCount;
+		auto end = drawCount * (threadIndex + 1) / threadCount;
+
+		if (begin == end || graphicsPipeline->GetInstance() == VK_NULL_HANDLE)
+			return;
+
+		RecordTriangle(commandBuffer, renderPass->extent);
+
+		for (auto i = begin + 1; i < end; i++)
+			triangleMesh->Draw(commandBuffer, 1);
+	}
+};
+
+// Draws window frames and returns the average frame command record time in seconds
+inline double MeasureRecordTime(GlfwWindow glfwWindow, RecordBenchmarkWindow_T& window, uint32_t frameCount)
+{
+	RenderPacket packet = {};
+	packet.clearColor[3] = 1.0f;
+
+	auto drawFrame = [&]()
+	{
+		int width, height;
+		glfwPollEvents();
+		glfwGetFramebufferSize(glfwWindow, &width, &height);
+
+		packet.framebufferWidth = static_cast<uint32_t>(width);
+		packet.framebufferHeight = static_cast<uint32_t>(height);
+		packet.inputTime = chrono::high_resolution_clock::now();
+		window.DrawFrame(packet);
+		packet.frameIndex++;
+	};
+
+	// Frames are drawn without the triangle until its pipeline is compiled
+	while (!window.IsPipelineReady())
+		drawFrame();
+
+	for (uint32_t i = 0; i < RecordBenchmarkWarmupFrameCount; i++)
+		drawFrame();
+
+	double totalTime = 0.0;
+
+	for (uint32_t i = 0; i < frameCount; i++)
+	{
+		drawFrame();
+		totalTime += window.GetFrameRecordTime();
+	}
+
+	return totalTime / frameCount;
+}
+
+// Records 100k triangle draws per frame with 1..N record threads and prints the scaling efficiency
+// Should be run from the repository root (shaders are loaded from Shaders/Engine), works with lavapipe.
+inline void RunRecordBenchmark(const BenchmarkOptions& options)
+{
+	auto frameCount = options.isQuick ? RecordBenchmarkFrameCount / 10 : RecordBenchmarkFrameCount;
+
+	if (glfwInit() == GLFW_FALSE)
+		throw GraphicsException("Failed to initialize GLFW");
+
+	glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
+	glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
+
+	VkExtent2D windowSize = { 800, 600 };
+	auto glfwWindow = glfwCreateWindow(windowSize.width, windowSize.height, "Record Benchmark", nullptr, nullptr);
+
+	if (!glfwWindow)
+	{
+		glfwTerminate();
+		throw GraphicsException("Failed to create GLFW window");
+	}
+
+	vector<const char*> vulkanExtensions = {};
+	vector<const char*> deviceExtensions = { VK_KHR_SWAPCHAIN_EXTENSION_NAME };
+	double singleThreadTime = 0.0;
+
+	try
+	{
+		for (auto threadCount : GetScalingThreadCounts(options.maxThreadCount))
+		{
+			JobSystem jobSystem(threadCount - 1);
+			auto window = new RecordBenchmarkWindow_T(glfwWindow, windowSize, vulkanExtensions, deviceExtensions, &jobSystem, RecordBenchmarkDrawCount);
+			double recordTime;
+
+			try
+			{
+				recordTime = MeasureRecordTime(glfwWindow, *window, frameCount);
+			}
+			catch (...)
+			{
+				delete window;
+				throw;
+			}
+
+			delete window;
+
+			if (threadCount == 1)
+				singleThreadTime = recordTime;
+
+			auto efficiency = singleThreadTime / (recordTime * threadCount);
+
+			cout << "Record " << RecordBenchmarkDrawCount << " draws, " << threadCount << " threads: " << recordTime * 1000.0 <<
+				" ms per frame, " << RecordBenchmarkDrawCount / recordTime / 1000000.0 << " M draws/s, " << efficiency * 100.0 << "% scaling efficiency" << endl;
+		}
+	}
+	catch (...)
+	{
+		glfwDestroyWindow(glfwWindow);
+		glfwTerminate();
+		throw;
+	}
+
+	glfwDestroyWindow(glfwWindow);
+	glfwTerminate();
+}
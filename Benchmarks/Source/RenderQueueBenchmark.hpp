@@ -0,0 +1,145 @@
+
+// Copyright 2019 Nikita Fediuchin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+#include "Benchmark.hpp"
+#include "Engine/RenderQueue.hpp"
+
+// Packet count of the queue ordering timing
+const uint64_t RenderQueueBenchmarkPacketCount = 200000;
+// Frame count of the modelled frame loop
+const uint64_t RenderQueueBenchmarkFrameCount = 200;
+// Modelled simulation time per frame
+const chrono::microseconds RenderQueueBenchmarkSimulationTime(4000);
+// Modelled draw time per frame (waiting for the driver and GPU, so it is a sleep)
+const chrono::microseconds RenderQueueBenchmarkDrawTime(6000);
+
+// Modelled frame loop result
+struct FrameLoopResult
+{
+	// Time per frame in seconds
+	double frameTime;
+	// Average input to draw end latency in seconds
+	double latency;
+};
+
+// Pushes packets through the queue to a consumer thread, checks their order and returns time per packet in seconds
+inline double RunRenderQueueTransfer(uint64_t capacity, uint64_t packetCount)
+{
+	RenderQueue queue(capacity);
+	uint64_t poppedCount = 0;
+	bool isOrdered = true;
+
+	thread consumer([&]()
+	{
+		RenderPacket packet;
+
+		while (poppedCount < packetCount && queue.Pop(packet))
+		{
+			isOrdered &= packet.frameIndex == poppedCount;
+			poppedCount++;
+		}
+	});
+
+	auto startTime = chrono::high_resolution_clock::now();
+
+	for (uint64_t i = 0; i < packetCount; i++)
+	{
+		RenderPacket packet = {};
+		packet.frameIndex = i;
+		CheckBenchmark(queue.Push(packet), "render queue was closed");
+	}
+
+	consumer.join();
+	auto totalTime = GetElapsedTime(startTime);
+	queue.Close();
+
+	CheckBenchmark(poppedCount == packetCount && isOrdered, "render queue lost or reordered packets");
+	return totalTime / packetCount;
+}
+
+// Runs the modelled frame loop on one thread or with a render thread (queue of one packet)
+inline FrameLoopResult RunModelledFrameLoop(uint64_t frameCount, bool isRenderThreaded)
+{
+	double totalLatency = 0.0;
+
+	auto draw = [&](const RenderPacket& packet)
+	{
+		this_thread::sleep_for(RenderQueueBenchmarkDrawTime);
+		totalLatency += GetElapsedTime(packet.inputTime);
+	};
+
+	RenderQueue queue(1);
+	thread renderThread;
+
+	// Render thread stops after the last frame, close would drop the pending packets
+	if (isRenderThreaded)
+	{
+		renderThread = thread([&]()
+		{
+			RenderPacket packet;
+
+			for (uint64_t i = 0; i < frameCount && queue.Pop(packet); i++)
+				draw(packet);
+		});
+	}
+
+	auto startTime = chrono::high_resolution_clock::now();
+
+	for (uint64_t i = 0; i < frameCount; i++)
+	{
+		RenderPacket packet = {};
+		packet.frameIndex = i;
+		packet.inputTime = chrono::high_resolution_clock::now();
+		this_thread::sleep_for(RenderQueueBenchmarkSimulationTime);
+
+		if (isRenderThreaded)
+			queue.Push(packet);
+		else
+			draw(packet);
+	}
+
+	if (isRenderThreaded)
+		renderThread.join();
+
+	auto totalTime = GetElapsedTime(startTime);
+	queue.Close();
+
+	return { totalTime / frameCount, totalLatency / frameCount };
+}
+
+// Times render queue packet transfer and models the frame loop with and without the render thread
+// Model uses sleeps for both simulation and draw, so it shows the pipelining without the Vulkan device.
+inline void RunRenderQueueBenchmark(const BenchmarkOptions& options)
+{
+	auto packetCount = options.isQuick ? RenderQueueBenchmarkPacketCount / 20 : RenderQueueBenchmarkPacketCount;
+	auto frameCount = options.isQuick ? RenderQueueBenchmarkFrameCount / 10 : RenderQueueBenchmarkFrameCount;
+
+	for (uint64_t capacity : { 1, 2, 8 })
+	{
+		auto packetTime = RunRenderQueueTransfer(capacity, packetCount);
+		cout << "Render queue capacity " << capacity << ": " << packetTime * 1000000000.0 << " ns per packet" << endl;
+	}
+
+	auto singleThread = RunModelledFrameLoop(frameCount, false);
+	auto renderThread = RunModelledFrameLoop(frameCount, true);
+
+	cout << "Modelled frame loop (" << RenderQueueBenchmarkSimulationTime.count() / 1000.0 << " ms simulation, " <<
+		RenderQueueBenchmarkDrawTime.count() / 1000.0 << " ms draw): single thread " << singleThread.frameTime * 1000.0 << " ms per frame, " <<
+		singleThread.latency * 1000.0 << " ms latency, render thread " << renderThread.frameTime * 1000.0 << " ms per frame, " <<
+		renderThread.latency * 1000.0 << " ms latency" << endl;
+
+	CheckBenchmark(renderThread.frameTime < singleThread.frameTime, "render thread did not overlap simulation and draw");
+}
@@ -0,0 +1,147 @@
+
+// Copyright 2019 Nikita Fediuchin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+#include "Benchmark.hpp"
+#include "Engine/Snapshot.hpp"
+#include "Engine/Transform.hpp"
+
+#include <fstream>
+#include <filesystem>
+
+// Saved entity count
+const size_t SnapshotBenchmarkEntityCount = 1000000;
+// Every n-th entity is removed before saving (free list slots)
+const size_t SnapshotBenchmarkRemoveInterval = 10;
+
+// Returns true if the benchmark entity is alive in the saved world
+inline bool IsSnapshotEntityAlive(size_t index)
+{
+	return index % SnapshotBenchmarkRemoveInterval != 0;
+}
+
+// Saves and loads a 1M entity world snapshot, compares loading with rebuilding the world entity by entity
+// Loaded world is checked entity by entity, then a truncated snapshot should be rejected.
+inline void RunSnapshotBenchmark(const BenchmarkOptions& options)
+{
+	auto entityCount = options.isQuick ? SnapshotBenchmarkEntityCount / 20 : SnapshotBenchmarkEntityCount;
+	auto filePath = (filesystem::temp_directory_path() / "InjectorBenchmark.snapshot").string();
+	auto truncatedPath = (filesystem::temp_directory_path() / "InjectorBenchmarkTruncated.snapshot").string();
+
+	vector<Entity> entities(entityCount);
+	double saveTime;
+
+	{
+		System system;
+
+		for (size_t i = 0; i < entityCount; i++)
+		{
+			auto& entity = entities[i];
+			entity = system.Add();
+			system.AddComponent<Transform>(entity).position[0] = static_cast<float>(i);
+			system.AddComponent<WorldTransform>(entity);
+
+			if (i % 3 == 0 && i != 0)
+				system.AddComponent<Parent>(entity, entities[i / 2]);
+		}
+
+		for (size_t i = 0; i < entityCount; i++)
+		{
+			if (!IsSnapshotEntityAlive(i))
+				system.Remove(entities[i]);
+		}
+
+		auto startTime = chrono::high_resolution_clock::now();
+		Snapshot::Save(system, filePath);
+		saveTime = GetElapsedTime(startTime);
+	}
+
+	System system;
+	auto startTime = chrono::high_resolution_clock::now();
+	Snapshot::Load(system, filePath);
+	auto loadTime = GetElapsedTime(startTime);
+
+	startTime = chrono::high_resolution_clock::now();
+
+	{
+		System rebuiltSystem;
+
+		for (size_t i = 0; i < entityCount; i++)
+		{
+			auto entity = rebuiltSystem.Add();
+			rebuiltSystem.AddComponent<Transform>(entity).position[0] = static_cast<float>(i);
+			rebuiltSystem.AddComponent<WorldTransform>(entity);
+
+			if (i % 3 == 0 && i != 0)
+				rebuiltSystem.AddComponent<Parent>(entity, entities[i / 2]);
+		}
+	}
+
+	auto rebuildTime = GetElapsedTime(startTime);
+	auto fileSize = filesystem::file_size(filePath);
+
+	cout << "Snapshot of " << entityCount << " entities (" << fileSize / (1024.0 * 1024.0) << " MiB): save " << saveTime * 1000.0 << " ms, load " <<
+		loadTime * 1000.0 << " ms, entity by entity rebuild " << rebuildTime * 1000.0 << " ms" << endl;
+
+	size_t aliveCount = 0;
+
+	for (size_t i = 0; i < entityCount; i++)
+	{
+		auto entity = entities[i];
+
+		if (!IsSnapshotEntityAlive(i))
+		{
+			CheckBenchmark(!system.Contains(entity), "removed entity is alive after loading");
+			continue;
+		}
+
+		CheckBenchmark(system.Contains(entity), "entity is missing after loading");
+		CheckBenchmark(system.GetConstComponent<Transform>(entity)->position[0] == static_cast<float>(i), "loaded transform differs");
+
+		auto parent = system.GetConstComponent<Parent>(entity);
+		CheckBenchmark((i % 3 == 0 && i != 0) ? parent && parent->entity == entities[i / 2] : !parent, "loaded parent differs");
+		aliveCount++;
+	}
+
+	CheckBenchmark(system.GetEntityCount() == aliveCount, "loaded entity count differs");
+
+	// New entities reuse the saved free list slots
+	CheckBenchmark(system.GetEntitySlotCount() == entityCount && system.Add().index < entityCount, "loaded free list is not reused");
+
+	{
+		ifstream source(filePath, ios::binary);
+		ofstream destination(truncatedPath, ios::binary);
+		vector<char> data(static_cast<size_t>(fileSize / 2));
+		source.read(data.data(), data.size());
+		destination.write(data.data(), data.size());
+	}
+
+	auto isThrown = false;
+
+	try
+	{
+		System truncatedSystem;
+		Snapshot::Load(truncatedSystem, truncatedPath);
+	}
+	catch (const IOException&)
+	{
+		isThrown = true;
+	}
+
+	filesystem::remove(filePath);
+	filesystem::remove(truncatedPath);
+
+	CheckBenchmark(isThrown, "truncated snapshot was loaded");
+}
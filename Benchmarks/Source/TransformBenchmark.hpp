@@ -0,0 +1,220 @@
+
+// Copyright 2019 Nikita Fediuchin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+#include "Benchmark.hpp"
+#include "Engine/Transform.hpp"
+
+#include <cmath>
+#include <random>
+
+// Animated transform count
+const size_t TransformBenchmarkEntityCount = 100000;
+// Node count per hierarchy level (roots first, the rest is split between the child levels)
+const size_t TransformBenchmarkLevelShares[] = { 1, 4, 10, 20, 30, 35 };
+// Measured frame count per thread count
+const size_t TransformBenchmarkFrameCount = 50;
+// Frame count before the measurement
+const size_t TransformBenchmarkWarmupFrameCount = 5;
+// Single core world transform update budget in seconds
+const double TransformBenchmarkBudget = 0.002;
+// Allowed world matrix element difference from the reference
+const float TransformBenchmarkTolerance = 1e-3f;
+
+// Animates every transform of the system (all transform chunks become changed)
+inline void AnimateTransforms(Query* query, size_t frameIndex)
+{
+	auto angle = static_cast<float>(frameIndex) * 0.01f;
+
+	query->ForEachChunk([&](QueryChunk& chunk)
+	{
+		auto indices = chunk.GetEntityIndices();
+		auto transforms = chunk.Get<Transform>();
+
+		for (uint32_t i = 0; i < chunk.count; i++)
+		{
+			auto halfAngle = (angle + static_cast<float>(indices[i] % 64) * 0.1f) * 0.5f;
+			auto& transform = transforms[i];
+			transform.rotation[0] = 0.0f;
+			transform.rotation[1] = sin(halfAngle);
+			transform.rotation[2] = 0.0f;
+			transform.rotation[3] = cos(halfAngle);
+			transform.position[1] = sin(angle + static_cast<float>(indices[i] % 16));
+		}
+	});
+}
+
+// Multiplies matrices without the SIMD kernels (reference result)
+inline Matrix4 MultiplyReferenceMatrix(const Matrix4& a, const Matrix4& b)
+{
+	Matrix4 result;
+
+	for (int j = 0; j < 4; j++)
+	{
+		for (int i = 0; i < 4; i++)
+		{
+			float value = 0.0f;
+
+			for (int k = 0; k < 4; k++)
+				value += a.m[k * 4 + i] * b.m[j * 4 + k];
+
+			result.m[j * 4 + i] = value;
+		}
+	}
+
+	return result;
+}
+// Returns matrix composed without the SIMD kernels (reference result)
+inline Matrix4 ComposeReferenceMatrix(const Transform& transform)
+{
+	auto x = transform.rotation[0], y = transform.rotation[1], z = transform.rotation[2], w = transform.rotation[3];
+
+	Matrix4 rotation = Matrix4::Identity();
+	rotation.m[0] = 1.0f - 2.0f * (y * y + z * z);
+	rotation.m[1] = 2.0f * (x * y + w * z);
+	rotation.m[2] = 2.0f * (x * z - w * y);
+	rotation.m[4] = 2.0f * (x * y - w * z);
+	rotation.m[5] = 1.0f - 2.0f * (x * x + z * z);
+	rotation.m[6] = 2.0f * (y * z + w * x);
+	rotation.m[8] = 2.0f * (x * z + w * y);
+	rotation.m[9] = 2.0f * (y * z - w * x);
+	rotation.m[10] = 1.0f - 2.0f * (x * x + y * y);
+
+	Matrix4 translation = Matrix4::Identity(), scale = Matrix4::Identity();
+	translation.m[12] = transform.position[0];
+	translation.m[13] = transform.position[1];
+	translation.m[14] = transform.position[2];
+	scale.m[0] = transform.scale[0];
+	scale.m[5] = transform.scale[1];
+	scale.m[10] = transform.scale[2];
+
+	return MultiplyReferenceMatrix(translation, MultiplyReferenceMatrix(rotation, scale));
+}
+
+// Checks world transforms against the naive parent chain walk
+inline void CheckWorldTransforms(System& system, const vector<Entity>& entities)
+{
+	for (auto entity : entities)
+	{
+		auto expected = ComposeReferenceMatrix(*system.GetConstComponent<Transform>(entity));
+		auto parent = system.GetConstComponent<Parent>(entity);
+
+		while (parent)
+		{
+			expected = MultiplyReferenceMatrix(ComposeReferenceMatrix(*system.GetConstComponent<Transform>(parent->entity)), expected);
+			parent = system.GetConstComponent<Parent>(parent->entity);
+		}
+
+		auto& matrix = system.GetConstComponent<WorldTransform>(entity)->matrix;
+
+		for (size_t i = 0; i < 16; i++)
+			CheckBenchmark(fabs(matrix.m[i] - expected.m[i]) <= TransformBenchmarkTolerance * max(1.0f, fabs(expected.m[i])), "world transform differs from the reference");
+	}
+}
+
+// Updates 100k animated transforms in a 6 level hierarchy of 1000 roots with 1..N threads
+// Prints update time per frame against the single core budget, then checks world transforms against the naive reference.
+inline void RunTransformBenchmark(const BenchmarkOptions& options)
+{
+	auto entityCount = options.isQuick ? TransformBenchmarkEntityCount / 10 : TransformBenchmarkEntityCount;
+	auto frameCount = options.isQuick ? static_cast<size_t>(5) : TransformBenchmarkFrameCount;
+
+	size_t shareSum = 0;
+
+	for (auto share : TransformBenchmarkLevelShares)
+		shareSum += share;
+
+	System system;
+	vector<Entity> entities(entityCount);
+	mt19937 random(1);
+
+	// Creation order is shuffled, so chunk order differs from the breadth first order as in a real scene
+	vector<size_t> creationOrder(entityCount);
+
+	for (size_t i = 0; i < entityCount; i++)
+		creationOrder[i] = i;
+
+	shuffle(creationOrder.begin(), creationOrder.end(), random);
+
+	for (auto index : creationOrder)
+	{
+		entities[index] = system.Add();
+		auto& transform = system.AddComponent<Transform>(entities[index]);
+		transform.position[0] = static_cast<float>(index % 100) * 0.1f;
+		transform.scale[2] = 1.0f + static_cast<float>(index % 3) * 0.5f;
+		system.AddComponent<WorldTransform>(entities[index]);
+	}
+
+	size_t levelBegin = 0, previousLevelBegin = 0;
+
+	for (size_t level = 0; level < size(TransformBenchmarkLevelShares); level++)
+	{
+		auto levelEnd = level + 1 == size(TransformBenchmarkLevelShares) ?
+			entityCount : levelBegin + entityCount * TransformBenchmarkLevelShares[level] / shareSum;
+
+		if (levelBegin != 0)
+		{
+			for (auto i = levelBegin; i < levelEnd; i++)
+				system.AddComponent<Parent>(entities[i], entities[previousLevelBegin + random() % (levelBegin - previousLevelBegin)]);
+		}
+
+		previousLevelBegin = levelBegin;
+		levelBegin = levelEnd;
+	}
+
+	auto query = system.CreateQuery(QueryDescription().Require<Transform>());
+	size_t frameIndex = 0;
+
+	for (auto threadCount : GetScalingThreadCounts(options.maxThreadCount))
+	{
+		JobSystem jobSystem(threadCount - 1);
+		TransformHierarchy hierarchy(&system, &jobSystem);
+
+		double bestTime = 1e9, totalTime = 0.0;
+
+		for (size_t i = 0; i < TransformBenchmarkWarmupFrameCount + frameCount; i++)
+		{
+			AnimateTransforms(query, frameIndex++);
+
+			auto startTime = chrono::high_resolution_clock::now();
+			hierarchy.Update();
+			auto updateTime = GetElapsedTime(startTime);
+
+			CheckBenchmark(hierarchy.GetUpdatedCount() == entityCount, "animated transforms were not updated");
+
+			if (i < TransformBenchmarkWarmupFrameCount)
+				continue;
+
+			bestTime = min(bestTime, updateTime);
+			totalTime += updateTime;
+		}
+
+		auto averageTime = totalTime / frameCount;
+
+		cout << threadCount << " threads: " << entityCount << " animated transforms (" << hierarchy.GetLevelCount() << " levels) updated in " <<
+			averageTime * 1000.0 << " ms average, " << bestTime * 1000.0 << " ms best";
+
+		if (threadCount == 1 && entityCount == TransformBenchmarkEntityCount)
+		{
+			cout << (averageTime <= TransformBenchmarkBudget ? " (within" : " (OVER") << " the " <<
+				TransformBenchmarkBudget * 1000.0 << " ms single core budget)";
+		}
+
+		cout << endl;
+		CheckWorldTransforms(system, entities);
+	}
+
+	system.DestroyQuery(query);
+}
@@ -0,0 +1,298 @@
+
+// Copyright 2019 Nikita Fediuchin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+#include "Exceptions.hpp"
+#include "Engine/Component.hpp"
+#include "Engine/PoolAllocator.hpp"
+
+#include <new>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include <algorithm>
+
+using namespace std;
+
+// Archetype chunk size in bytes
+const size_t ArchetypeChunkSize = 16 * 1024;
+// Archetype chunk column alignment in bytes (cache line)
+const size_t ArchetypeColumnAlignment = 64;
+// Archetype chunk count per pool slab
+const size_t ArchetypeChunkSlabSize = 16;
+// Invalid entity index value
+const uint32_t InvalidEntityIndex = UINT32_MAX;
+
+// Archetype storage chunk (fixed size block with one array per component type)
+struct ArchetypeChunk
+{
+	// Chunk memory block
+	uint8_t* data;
+	// Chunk entity count
+	uint32_t count;
+	// Last change version per component array (bumped on the mutable access and structural changes)
+	vector<uint64_t> versions;
+};
+
+// Archetype class (storage of the entities with the same component type set)
+// Entities are packed densely, only the last chunk can be partially filled
+class Archetype
+{
+protected:
+	// Component type array (sorted by identifier)
+	vector<const ComponentType*> types;
+	// Component type set mask
+	ComponentMask mask;
+	// Component array index per component type identifier (valid if mask bit is set)
+	uint8_t typeIndices[MaxComponentTypeCount];
+	// Component array offset array (in the chunk, entity index array is at the beginning)
+	vector<size_t> offsets;
+	// Chunk entity capacity
+	uint32_t capacity;
+
+	// Chunk memory pool (shared by all system archetypes)
+	PoolAllocator* chunkPool;
+	// Chunk array
+	vector<ArchetypeChunk> chunks;
+	// Archetype entity count
+	size_t entityCount;
+
+	// Returns chunk layout size for the capacity (and fills component array offsets)
+	size_t CalculateLayout(uint32_t _capacity)
+	{
+		auto offset = static_cast<size_t>(_capacity) * sizeof(uint32_t);
+
+		for (size_t i = 0; i < types.size(); i++)
+		{
+			auto alignment = max(types[i]->alignment, ArchetypeColumnAlignment);
+			offset = (offset + alignment - 1) / alignment * alignment;
+			offsets[i] = offset;
+			offset += types[i]->size * _capacity;
+		}
+
+		return offset;
+	}
+
+	// Allocates a new chunk memory block
+	uint8_t* AllocateChunk()
+	{
+		return static_cast<uint8_t*>(chunkPool->Allocate());
+	}
+	// Frees chunk memory block
+	void FreeChunk(uint8_t* data)
+	{
+		chunkPool->Free(data);
+	}
+
+public:
+	// Creates a new archetype instance (chunk pool block size should be the archetype chunk size)
+	Archetype(const vector<const ComponentType*>& _types, PoolAllocator* _chunkPool)
+	{
+		if (!_chunkPool)
+			throw ArgumentNullException("Archetype chunk pool is null");
+		if (_chunkPool->GetBlockSize() != ArchetypeChunkSize)
+			throw ArgumentException("Archetype chunk pool block size is not the chunk size");
+
+		types = _types;
+		chunkPool = _chunkPool;
+		sort(types.begin(), types.end(), [](const ComponentType* a, const ComponentType* b) { return a->id < b->id; });
+
+		mask = {};
+
+		for (size_t i = 0; i < types.size(); i++)
+		{
+			if (types[i]->alignment > ArchetypeColumnAlignment)
+				throw ArgumentException("Component alignment is bigger than the archetype column alignment");
+
+			mask.Set(types[i]->id);
+			typeIndices[types[i]->id] = static_cast<uint8_t>(i);
+		}
+
+		offsets.resize(types.size());
+
+		size_t rowSize = sizeof(uint32_t);
+
+		for (auto type : types)
+			rowSize += type->size;
+
+		capacity = static_cast<uint32_t>(ArchetypeChunkSize / rowSize);
+
+		while (capacity > 0 && CalculateLayout(capacity) > ArchetypeChunkSize)
+			capacity--;
+
+		if (capacity == 0)
+			throw ArgumentException("Archetype components do not fit into the chunk");
+
+		entityCount = 0;
+	}
+	// Destroys archetype instance (and all its components)
+	~Archetype()
+	{
+		for (auto& chunk : chunks)
+		{
+			for (size_t i = 0; i < types.size(); i++)
+			{
+				auto column = chunk.data + offsets[i];
+
+				for (uint32_t j = 0; j < chunk.count; j++)
+					types[i]->destruct(column + types[i]->size * j);
+			}
+
+			FreeChunk(chunk.data);
+		}
+	}
+
+	// Returns component type array (sorted by identifier)
+	const vector<const ComponentType*>& GetTypes() { return types; }
+	// Returns component type set mask
+	const ComponentMask& GetMask() { return mask; }
+	// Returns chunk entity capacity
+	uint32_t GetCapacity() { return capacity; }
+	// Returns archetype entity count
+	size_t GetEntityCount() { return entityCount; }
+	// Returns chunk count
+	uint32_t GetChunkCount() { return static_cast<uint32_t>(chunks.size()); }
+	// Returns chunk entity count
+	uint32_t GetChunkEntityCount(uint32_t chunkIndex) { return chunks[chunkIndex].count; }
+
+	// Returns chunk entity index array
+	uint32_t* GetEntities(uint32_t chunkIndex)
+	{
+		return reinterpret_cast<uint32_t*>(chunks[chunkIndex].data);
+	}
+	// Returns chunk component array
+	uint8_t* GetColumn(uint32_t chunkIndex, size_t typeIndex)
+	{
+		return chunks[chunkIndex].data + offsets[typeIndex];
+	}
+	// Returns chunk component array change version
+	uint64_t GetChunkVersion(uint32_t chunkIndex, size_t typeIndex)
+	{
+		return chunks[chunkIndex].versions[typeIndex];
+	}
+	// Marks chunk component array as changed at the version
+	void SetChunkVersion(uint32_t chunkIndex, size_t typeIndex, uint64_t version)
+	{
+		chunks[chunkIndex].versions[typeIndex] = version;
+	}
+	// Returns true if any chunk component array of the mask types changed after the version
+	bool IsChunkChanged(uint32_t chunkIndex, const ComponentMask& changedMask, uint64_t version)
+	{
+		auto& versions = chunks[chunkIndex].versions;
+
+		for (size_t i = 0; i < types.size(); i++)
+		{
+			if (changedMask.Test(types[i]->id) && versions[i] > version)
+				return true;
+		}
+
+		return false;
+	}
+
+	// Returns entity component
+	void* GetComponent(uint32_t chunkIndex, uint32_t rowIndex, size_t typeIndex)
+	{
+		return chunks[chunkIndex].data + offsets[typeIndex] + types[typeIndex]->size * rowIndex;
+	}
+
+	// Returns true if archetype has the component type
+	bool HasType(uint32_t typeId) { return mask.Test(typeId); }
+	// Returns component array index of the type (archetype should have the type)
+	size_t GetTypeIndex(uint32_t typeId) { return typeIndices[typeId]; }
+
+	// Returns true if archetype has the component type (and its index)
+	bool FindType(uint32_t typeId, size_t& typeIndex)
+	{
+		if (!mask.Test(typeId))
+			return false;
+
+		typeIndex = typeIndices[typeId];
+		return true;
+	}
+
+	// Allocates a new entity row (components are not constructed), returns its row index
+	// Chunk component arrays are marked as changed at the version
+	uint32_t Allocate(uint32_t entity, uint32_t& chunkIndex, uint64_t version)
+	{
+		if (chunks.empty() || chunks.back().count == capacity)
+		{
+			ArchetypeChunk chunk = {};
+			chunk.data = AllocateChunk();
+			chunk.versions.resize(types.size());
+			chunks.push_back(move(chunk));
+		}
+
+		chunkIndex = static_cast<uint32_t>(chunks.size() - 1);
+		auto& chunk = chunks.back();
+		auto rowIndex = chunk.count++;
+
+		for (auto& chunkVersion : chunk.versions)
+			chunkVersion = version;
+
+		GetEntities(chunkIndex)[rowIndex] = entity;
+		entityCount++;
+		return rowIndex;
+	}
+	// Allocates up to count rows in the last chunk (components are not constructed), returns allocated row count
+	// Rows are contiguous, so component arrays can be filled with a single copy
+	uint32_t AllocateRows(const uint32_t* entities, uint32_t count, uint32_t& chunkIndex, uint32_t& rowIndex, uint64_t version)
+	{
+		rowIndex = Allocate(entities[0], chunkIndex, version);
+		auto& chunk = chunks[chunkIndex];
+		auto rowCount = min(count, capacity - rowIndex);
+
+		memcpy(GetEntities(chunkIndex) + rowIndex + 1, entities + 1, (rowCount - 1) * sizeof(uint32_t));
+		chunk.count += rowCount - 1;
+		entityCount += rowCount - 1;
+		return rowCount;
+	}
+	// Removes entity row (destroys its components if required), returns index of the entity moved to its place
+	// Chunk component arrays are marked as changed at the version if other entity is moved into the row
+	uint32_t Remove(uint32_t chunkIndex, uint32_t rowIndex, bool isDestruct, uint64_t version)
+	{
+		if (isDestruct)
+		{
+			for (size_t i = 0; i < types.size(); i++)
+				types[i]->destruct(GetComponent(chunkIndex, rowIndex, i));
+		}
+
+		auto lastChunkIndex = static_cast<uint32_t>(chunks.size() - 1);
+		auto lastRowIndex = chunks.back().count - 1;
+		auto movedEntity = InvalidEntityIndex;
+
+		// Last entity fills the hole, so the chunks stay dense
+		if (chunkIndex != lastChunkIndex || rowIndex != lastRowIndex)
+		{
+			for (size_t i = 0; i < types.size(); i++)
+				types[i]->move(GetComponent(chunkIndex, rowIndex, i), GetComponent(lastChunkIndex, lastRowIndex, i));
+
+			movedEntity = GetEntities(lastChunkIndex)[lastRowIndex];
+			GetEntities(chunkIndex)[rowIndex] = movedEntity;
+
+			for (auto& chunkVersion : chunks[chunkIndex].versions)
+				chunkVersion = version;
+		}
+
+		if (--chunks.back().count == 0)
+		{
+			FreeChunk(chunks.back().data);
+			chunks.pop_back();
+		}
+
+		entityCount--;
+		return movedEntity;
+	}
+};
@@ -0,0 +1,229 @@
+
+// Copyright 2019 Nikita Fediuchin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+#include "Exceptions.hpp"
+
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+
+using namespace std;
+
+// Returns true if value is a power of two
+static bool IsPowerOfTwo(uint64_t value)
+{
+	return value != 0 && (value & (value - 1)) == 0;
+}
+// Returns smallest power of two greater or equal to the value
+static uint64_t NextPowerOfTwo(uint64_t value)
+{
+	uint64_t result = 1;
+
+	while (result < value)
+		result <<= 1;
+
+	return result;
+}
+// Returns base two logarithm of the power of two value
+static uint32_t Log2(uint64_t value)
+{
+	uint32_t result = 0;
+
+	while (value >>= 1)
+		result++;
+
+	return result;
+}
+
+// Binary buddy range allocator class (manages offsets only, no memory is owned)
+// Every block is aligned to its own power of two size
+class BuddyAllocator
+{
+protected:
+	// Invalid free list position value
+	static constexpr uint32_t InvalidPosition = UINT32_MAX;
+	// Allocated level value of the minimal block which does not start an allocation
+	static constexpr uint8_t NotAllocatedLevel = UINT8_MAX;
+
+	// Managed range size (power of two)
+	uint64_t size;
+	// Minimal block size (power of two)
+	uint64_t minBlockSize;
+	// Block level count (level zero is the whole range)
+	uint32_t levelCount;
+
+	// Free node array per level
+	vector<vector<uint32_t>> freeLists;
+	// Node position in its level free list (invalid if node is not free)
+	vector<uint32_t> freePositions;
+	// Allocated block level per minimal block index (not allocated level if no allocation starts there)
+	vector<uint8_t> allocatedLevels;
+
+	// Allocated size (sum of the block sizes)
+	uint64_t usedSize;
+	// Allocated block count
+	size_t allocationCount;
+
+	// Returns node index of the block
+	uint32_t GetNode(uint32_t level, uint64_t offset)
+	{
+		return ((1u << level) - 1) + static_cast<uint32_t>(offset / (size >> level));
+	}
+	// Returns block offset of the node
+	uint64_t GetOffset(uint32_t level, uint32_t node)
+	{
+		return static_cast<uint64_t>(node - ((1u << level) - 1)) * (size >> level);
+	}
+
+	// Adds node to its level free list
+	void PushFree(uint32_t level, uint32_t node)
+	{
+		freePositions[node] = static_cast<uint32_t>(freeLists[level].size());
+		freeLists[level].push_back(node);
+	}
+	// Removes node from its level free list
+	void RemoveFree(uint32_t level, uint32_t node)
+	{
+		auto& freeList = freeLists[level];
+		auto position = freePositions[node];
+		auto lastNode = freeList.back();
+
+		freeList[position] = lastNode;
+		freePositions[lastNode] = position;
+		freeList.pop_back();
+
+		freePositions[node] = InvalidPosition;
+	}
+
+public:
+	// Creates a new buddy allocator instance
+	BuddyAllocator(uint64_t _size, uint64_t _minBlockSize)
+	{
+		if (!IsPowerOfTwo(_size) || !IsPowerOfTwo(_minBlockSize) || _minBlockSize > _size)
+			throw ArgumentException("Buddy allocator sizes should be powers of two");
+
+		size = _size;
+		minBlockSize = _minBlockSize;
+		levelCount = Log2(_size / _minBlockSize) + 1;
+
+		if (levelCount > 31)
+			throw ArgumentOutOfRangeException("Buddy allocator has too many levels");
+
+		freeLists.resize(levelCount);
+		freePositions.resize((static_cast<size_t>(1) << levelCount) - 1, InvalidPosition);
+		allocatedLevels.resize(static_cast<size_t>(_size / _minBlockSize), NotAllocatedLevel);
+
+		usedSize = 0;
+		allocationCount = 0;
+
+		PushFree(0, 0);
+	}
+
+	// Returns managed range size
+	uint64_t GetSize() { return size; }
+	// Returns minimal block size
+	uint64_t GetMinBlockSize() { return minBlockSize; }
+	// Returns allocated size (sum of the block sizes)
+	uint64_t GetUsedSize() { return usedSize; }
+	// Returns allocated block count
+	size_t GetAllocationCount() { return allocationCount; }
+	// Returns true if there are no allocated blocks
+	bool IsEmpty() { return allocationCount == 0; }
+
+	// Returns largest free block size
+	uint64_t GetLargestFreeBlock()
+	{
+		for (uint32_t level = 0; level < levelCount; level++)
+		{
+			if (!freeLists[level].empty())
+				return size >> level;
+		}
+
+		return 0;
+	}
+
+	// Allocates a new block, returns false if there is no suitable free block
+	bool Allocate(uint64_t requestSize, uint64_t alignment, uint64_t& offset)
+	{
+		auto blockSize = NextPowerOfTwo(max(max(requestSize, alignment), minBlockSize));
+
+		if (blockSize > size)
+			return false;
+
+		auto targetLevel = Log2(size / blockSize);
+		auto level = targetLevel;
+
+		while (freeLists[level].empty())
+		{
+			if (level == 0)
+				return false;
+
+			level--;
+		}
+
+		auto node = freeLists[level].back();
+		RemoveFree(level, node);
+
+		// Split larger block, right halves become free
+		while (level < targetLevel)
+		{
+			node = node * 2 + 1;
+			level++;
+			PushFree(level, node + 1);
+		}
+
+		offset = GetOffset(level, node);
+		allocatedLevels[static_cast<size_t>(offset / minBlockSize)] = static_cast<uint8_t>(level);
+
+		usedSize += blockSize;
+		allocationCount++;
+		return true;
+	}
+
+	// Frees allocated block and merges it with the free buddies
+	// Offset should be returned by the allocate and not freed yet, otherwise free lists would be corrupted.
+	void Free(uint64_t offset)
+	{
+		if (offset >= size || offset % minBlockSize != 0)
+			throw ArgumentOutOfRangeException("Buddy allocator offset is out of range");
+
+		auto& allocatedLevel = allocatedLevels[static_cast<size_t>(offset / minBlockSize)];
+
+		if (allocatedLevel == NotAllocatedLevel)
+			throw ArgumentException("Buddy allocator offset is not allocated or already freed");
+
+		uint32_t level = allocatedLevel;
+		allocatedLevel = NotAllocatedLevel;
+		auto node = GetNode(level, offset);
+
+		usedSize -= size >> level;
+		allocationCount--;
+
+		while (level > 0)
+		{
+			auto buddy = (node & 1) ? node + 1 : node - 1;
+
+			if (freePositions[buddy] == InvalidPosition)
+				break;
+
+			RemoveFree(level, buddy);
+			node = (node - 1) / 2;
+			level--;
+		}
+
+		PushFree(level, node);
+	}
+};
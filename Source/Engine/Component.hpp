@@ -14,7 +14,239 @@
 // limitations under the License.
 
 #pragma once
+#include "Exceptions.hpp"
 
-class Component
+#include <new>
+#include <mutex>
+#include <atomic>
+#include <string>
+#include <cstdint>
+#include <utility>
+#include <type_traits>
+
+using namespace std;
+
+// Maximal component type count (component mask bit count)
+const uint32_t MaxComponentTypeCount = 128;
+
+// Component type set bit mask
+struct ComponentMask
+{
+	// Mask bits (one per component type identifier)
+	uint64_t bits[MaxComponentTypeCount / 64] = {};
+
+	// Sets component type bit
+	void Set(uint32_t id)
+	{
+		bits[id / 64] |= 1ULL << (id % 64);
+	}
+	// Clears component type bit
+	void Reset(uint32_t id)
+	{
+		bits[id / 64] &= ~(1ULL << (id % 64));
+	}
+	// Returns true if component type bit is set
+	bool Test(uint32_t id) const
+	{
+		return (bits[id / 64] & (1ULL << (id % 64))) != 0;
+	}
+
+	// Returns true if mask contains all bits of the other mask
+	bool Contains(const ComponentMask& other) const
+	{
+		for (size_t i = 0; i < MaxComponentTypeCount / 64; i++)
+		{
+			if ((bits[i] & other.bits[i]) != other.bits[i])
+				return false;
+		}
+
+		return true;
+	}
+	// Returns true if mask has any common bit with the other mask
+	bool Intersects(const ComponentMask& other) const
+	{
+		for (size_t i = 0; i < MaxComponentTypeCount / 64; i++)
+		{
+			if ((bits[i] & other.bits[i]) != 0)
+				return true;
+		}
+
+		return false;
+	}
+
+	// Returns true if masks are equal
+	bool operator==(const ComponentMask& other) const
+	{
+		for (size_t i = 0; i < MaxComponentTypeCount / 64; i++)
+		{
+			if (bits[i] != other.bits[i])
+				return false;
+		}
+
+		return true;
+	}
+	// Returns true if masks are not equal
+	bool operator!=(const ComponentMask& other) const
+	{
+		return !(*this == other);
+	}
+};
+
+// Component type set bit mask hash function
+struct ComponentMaskHash
 {
+	// Returns component mask hash
+	size_t operator()(const ComponentMask& mask) const
+	{
+		uint64_t hash = 0;
+
+		for (size_t i = 0; i < MaxComponentTypeCount / 64; i++)
+			hash = (hash ^ mask.bits[i]) * 0x9E3779B97F4A7C15ULL;
+
+		return static_cast<size_t>(hash ^ (hash >> 32));
+	}
 };
+
+// Component in place operation function
+typedef void (*ComponentFunction)(void* component);
+
+// Component type information (components are plain types stored by value in the archetype chunks)
+struct ComponentType
+{
+	// Component type identifier (assigned on the first use, differs between runs)
+	uint32_t id;
+	// Component size in bytes
+	size_t size;
+	// Component alignment in bytes
+	size_t alignment;
+	// Component type name (declared by the type, stable between builds and compilers)
+	const char* name;
+	// Component type name hash (stable type identifier for the serialization)
+	uint64_t nameHash;
+	// Can component be copied as raw bytes
+	bool isTriviallyCopyable;
+
+	// Default constructs component in place (null if type is not default constructible)
+	ComponentFunction construct;
+	// Destroys component in place
+	ComponentFunction destruct;
+	// Move constructs destination component and destroys the source one
+	void (*move)(void* destination, void* source);
+};
+
+// Returns a new unique component type identifier
+inline uint32_t CreateComponentTypeId()
+{
+	static atomic<uint32_t> counter(0);
+	auto id = counter++;
+
+	if (id >= MaxComponentTypeCount)
+		throw ArgumentOutOfRangeException("Too many component types");
+
+	return id;
+}
+
+// Returns FNV-1a hash of the component type name
+inline uint64_t HashComponentName(const char* name)
+{
+	uint64_t hash = 14695981039346656037ULL;
+
+	for (auto character = name; *character; character++)
+	{
+		hash ^= static_cast<uint8_t>(*character);
+		hash *= 1099511628211ULL;
+	}
+
+	return hash;
+}
+
+// Returns registered component type array (indexed by identifier)
+inline ComponentType* GetComponentTypes()
+{
+	static ComponentType types[MaxComponentTypeCount] = {};
+	return types;
+}
+// Returns component type registry mutex
+inline mutex& GetComponentTypeMutex()
+{
+	static mutex typeMutex;
+	return typeMutex;
+}
+// Registers component type, returns its registry instance (name should be unique)
+inline const ComponentType& RegisterComponentType(const ComponentType& type)
+{
+	lock_guard<mutex> lock(GetComponentTypeMutex());
+	auto types = GetComponentTypes();
+
+	for (uint32_t i = 0; i < MaxComponentTypeCount; i++)
+	{
+		if (types[i].name && types[i].nameHash == type.nameHash)
+			throw ArgumentException("Component type name is already registered. Name: " + string(type.name));
+	}
+
+	auto& registeredType = types[type.id];
+	registeredType = type;
+	return registeredType;
+}
+// Returns registered component type with the name hash (null if there is no such type)
+inline const ComponentType* FindComponentType(uint64_t nameHash)
+{
+	lock_guard<mutex> lock(GetComponentTypeMutex());
+	auto types = GetComponentTypes();
+
+	for (uint32_t i = 0; i < MaxComponentTypeCount; i++)
+	{
+		if (types[i].name && types[i].nameHash == nameHash)
+			return &types[i];
+	}
+
+	return nullptr;
+}
+
+// Component type name member detector
+template<class T, class = void>
+struct HasComponentName : false_type {};
+template<class T>
+struct HasComponentName<T, void_t<decltype(T::ComponentName)>> : true_type {};
+
+// Returns component type name (declared as "static constexpr const char* ComponentName" member)
+template<class T>
+constexpr const char* GetComponentName()
+{
+	static_assert(HasComponentName<T>::value, "Component type should declare static constexpr const char* ComponentName");
+	return T::ComponentName;
+}
+
+// Returns default constructor thunk of the component type (null if there is no default constructor)
+template<class T>
+ComponentFunction GetComponentConstructor()
+{
+	if constexpr (is_default_constructible<T>::value)
+		return [](void* component) { new (component) T(); };
+	else
+		return nullptr;
+}
+
+// Returns component type information of the type (identifier is assigned and type is registered on the first call)
+template<class T>
+const ComponentType& GetComponentType()
+{
+	static const ComponentType& type = RegisterComponentType(
+	{
+		CreateComponentTypeId(),
+		sizeof(T),
+		alignof(T),
+		GetComponentName<T>(),
+		HashComponentName(GetComponentName<T>()),
+		is_trivially_copyable<T>::value,
+		GetComponentConstructor<T>(),
+		[](void* component) { static_cast<T*>(component)->~T(); },
+		[](void* destination, void* source)
+		{
+			new (destination) T(move(*static_cast<T*>(source)));
+			static_cast<T*>(source)->~T();
+		},
+	});
+
+	return type;
+}
@@ -29,3 +29,9 @@ const string EngineName = "Injector Engine";
 const uint32_t EngineVersion = VK_MAKE_VERSION(0, 1, 0);
 // Vulkan API version
 const uint32_t VulkanVersion = VK_API_VERSION_1_1;
+// Vulkan pipeline cache file path
+const string PipelineCacheFilePath = "PipelineCache.bin";
+// Vulkan pipeline compiler thread count
+const size_t PipelineCompileThreadCount = 2;
+// Vulkan upload staging buffer size
+const uint64_t StagingBufferSize = 16 * 1024 * 1024;
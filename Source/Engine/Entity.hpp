@@ -14,33 +14,69 @@
 // limitations under the License.
 
 #pragma once
-#include <vector>
-#include "Component.hpp"
+#include <cstdint>
 
 using namespace std;
 
-class Entity
+class Archetype;
+
+// Entity handle (slot index and its generation, so stale handles of the reused slots are detected)
+struct Entity
 {
-protected:
-	// Entity component array
-	vector<Component*> components;
-public:
-	// Returns component from the entity component array
-	void GetComponent(const Component* component)
-	{
-		for (size_t i = 0; i < length; i++)
-		{
+	// Entity slot index
+	uint32_t index;
+	// Entity slot generation
+	uint32_t generation;
 
-		}
+	// Returns packed 64 bit entity identifier
+	uint64_t GetId() const
+	{
+		return (static_cast<uint64_t>(generation) << 32) | index;
 	}
-	// Adds a new component to the entity component array
-	void AddComponent(Component* const component)
+	// Returns entity handle of the packed identifier
+	static Entity FromId(uint64_t id)
+	{
+		Entity entity = {};
+		entity.index = static_cast<uint32_t>(id);
+		entity.generation = static_cast<uint32_t>(id >> 32);
+		return entity;
+	}
+
+	// Returns true if entity handles are equal
+	bool operator==(const Entity& other) const
 	{
-		components.push_back(component);
+		return index == other.index && generation == other.generation;
 	}
-	// Removes component from the entity component array
-	void RemoveComponent(Component* const component)
+	// Returns true if entity handles are not equal
+	bool operator!=(const Entity& other) const
 	{
-		components.erase(component);
+		return !(*this == other);
 	}
-};
\ No newline at end of file
+};
+
+// Null entity handle (never alive)
+const Entity NullEntity = { UINT32_MAX, 0 };
+// Deferred entity generation (reserved for the command buffer placeholders, never used by alive entities)
+const uint32_t DeferredEntityGeneration = UINT32_MAX;
+
+// Entity location in the archetype storage
+struct EntityLocation
+{
+	// Entity archetype (null if entity is removed)
+	Archetype* archetype;
+	// Archetype chunk index
+	uint32_t chunkIndex;
+	// Chunk row index
+	uint32_t rowIndex;
+};
+
+// Entity slot record (free slots form an intrusive list)
+struct EntityRecord
+{
+	// Entity location (archetype is null if slot is free)
+	EntityLocation location;
+	// Current slot generation (incremented on each remove)
+	uint32_t generation;
+	// Next free slot index (valid if slot is free)
+	uint32_t nextFree;
+};
@@ -0,0 +1,320 @@
+
+// Copyright 2019 Nikita Fediuchin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+#include "Exceptions.hpp"
+#include "Engine/System.hpp"
+
+#include <new>
+#include <vector>
+#include <cstdint>
+#include <utility>
+
+using namespace std;
+
+// Entity command buffer value page size
+const size_t EntityCommandPageSize = 16 * 1024;
+
+// Entity command type
+enum class EntityCommandType : uint8_t
+{
+	Create,
+	Destroy,
+	AddComponent,
+	RemoveComponent,
+};
+
+// Recorded entity command
+struct EntityCommand
+{
+	// Command type
+	EntityCommandType type;
+	// Target entity (deferred placeholder or alive entity handle)
+	Entity entity;
+	// Component type (null for create and destroy)
+	const ComponentType* componentType;
+	// Constructed component value to move (null if there is no value or it is already moved)
+	void* component;
+};
+
+// Deferred entity command buffer class (records structural changes during the parallel iteration)
+// Each task records into its own buffer, buffers are played back on the sync point in a fixed order
+class EntityCommandBuffer
+{
+protected:
+	// Recorded command array
+	vector<EntityCommand> commands;
+	// Component value page array (values never move, so they can be non trivially relocatable)
+	vector<uint8_t*> pages;
+	// Current value page index
+	size_t pageIndex;
+	// Current value page offset
+	size_t pageOffset;
+	// Dedicated component value array (larger than a page or overaligned)
+	vector<pair<uint8_t*, size_t>> dedicatedValues;
+	// Deferred entity count
+	uint32_t createCount;
+	// Created entity array of the last playback (indexed by the deferred placeholder index)
+	vector<Entity> createdEntities;
+
+	// Allocates component value memory
+	void* AllocateValue(size_t size, size_t alignment)
+	{
+		if (size > EntityCommandPageSize || alignment > ArchetypeColumnAlignment)
+		{
+			auto data = static_cast<uint8_t*>(operator new(size, align_val_t(alignment)));
+			dedicatedValues.emplace_back(data, alignment);
+			return data;
+		}
+
+		auto offset = (pageOffset + alignment - 1) / alignment * alignment;
+
+		if (pageIndex == pages.size() || offset + size > EntityCommandPageSize)
+		{
+			if (pageIndex < pages.size())
+				pageIndex++;
+
+			if (pageIndex == pages.size())
+				pages.push_back(static_cast<uint8_t*>(operator new(EntityCommandPageSize, align_val_t(ArchetypeColumnAlignment))));
+
+			offset = 0;
+		}
+
+		pageOffset = offset + size;
+		return pages[pageIndex] + offset;
+	}
+
+	// Returns alive entity of the command target (resolves deferred placeholder)
+	Entity Resolve(Entity entity)
+	{
+		if (entity.generation != DeferredEntityGeneration)
+			return entity;
+
+		return entity.index < createdEntities.size() ? createdEntities[entity.index] : NullEntity;
+	}
+	// Moves command component value into the entity component memory
+	static void MoveValue(EntityCommand& command, void* destination)
+	{
+		command.componentType->move(destination, command.component);
+		command.component = nullptr;
+	}
+
+	// Links add commands of each deferred entity which can be merged into its creation (single pass)
+	// Merging stops at the first removal, destruction or repeated add, those are applied in the recorded order
+	void LinkMergedCommands(vector<size_t>& nextMerged)
+	{
+		vector<ComponentMask> masks(createCount);
+		vector<size_t> lastMerged(createCount, SIZE_MAX);
+
+		for (size_t i = 0; i < commands.size(); i++)
+		{
+			auto& command = commands[i];
+
+			if (!IsDeferred(command.entity) || command.entity.index >= createCount)
+				continue;
+
+			auto index = command.entity.index;
+
+			if (command.type == EntityCommandType::Create)
+			{
+				lastMerged[index] = i;
+				continue;
+			}
+
+			if (lastMerged[index] == SIZE_MAX)
+				continue;
+
+			if (command.type == EntityCommandType::AddComponent && !masks[index].Test(command.componentType->id))
+			{
+				masks[index].Set(command.componentType->id);
+				nextMerged[lastMerged[index]] = i;
+				lastMerged[index] = i;
+			}
+			else
+			{
+				lastMerged[index] = SIZE_MAX;
+			}
+		}
+	}
+	// Creates deferred entity directly in its final archetype (with the merged add command values)
+	void PlaybackCreate(System& system, size_t commandIndex, const vector<size_t>& nextMerged, vector<uint8_t>& isMerged)
+	{
+		vector<const ComponentType*> types;
+
+		for (auto i = nextMerged[commandIndex]; i != SIZE_MAX; i = nextMerged[i])
+			types.push_back(commands[i].componentType);
+
+		auto entity = system.AddUninitialized(types);
+
+		for (auto i = nextMerged[commandIndex]; i != SIZE_MAX; i = nextMerged[i])
+		{
+			auto& command = commands[i];
+			MoveValue(command, system.GetComponent(entity, *command.componentType));
+			isMerged[i] = 1;
+		}
+
+		createdEntities[commands[commandIndex].entity.index] = entity;
+	}
+	// Adds component to the entity (replaces existing component value)
+	void PlaybackAddComponent(System& system, EntityCommand& command)
+	{
+		auto entity = Resolve(command.entity);
+
+		if (!system.Contains(entity))
+			return;
+
+		auto& type = *command.componentType;
+		auto component = system.GetComponent(entity, type);
+
+		if (component)
+			type.destruct(component);
+		else
+			component = system.AddUninitializedComponent(entity, type);
+
+		MoveValue(command, component);
+	}
+
+public:
+	// Creates a new entity command buffer instance
+	EntityCommandBuffer()
+	{
+		pageIndex = 0;
+		pageOffset = 0;
+		createCount = 0;
+	}
+	// Destroys entity command buffer instance (and not played back component values)
+	~EntityCommandBuffer()
+	{
+		Clear();
+
+		for (auto page : pages)
+			operator delete(page, align_val_t(ArchetypeColumnAlignment));
+	}
+
+	EntityCommandBuffer(const EntityCommandBuffer&) = delete;
+	EntityCommandBuffer& operator=(const EntityCommandBuffer&) = delete;
+
+	// Returns recorded command count
+	size_t GetCommandCount() { return commands.size(); }
+	// Returns true if there are no recorded commands
+	bool IsEmpty() { return commands.empty(); }
+	// Returns created entity of the deferred placeholder (valid after the playback, null if placeholder is unknown)
+	Entity GetCreatedEntity(Entity placeholder)
+	{
+		return Resolve(placeholder);
+	}
+
+	// Returns true if entity handle is a deferred placeholder
+	static bool IsDeferred(Entity entity)
+	{
+		return entity.generation == DeferredEntityGeneration;
+	}
+
+	// Records entity creation, returns placeholder handle (usable only within this buffer commands)
+	Entity Create()
+	{
+		if (createCount == DeferredEntityGeneration)
+			throw ArgumentOutOfRangeException("Too many deferred entities");
+
+		Entity entity = { createCount++, DeferredEntityGeneration };
+		commands.push_back({ EntityCommandType::Create, entity, nullptr, nullptr });
+		return entity;
+	}
+	// Records entity destruction (ignored on playback if entity is not alive)
+	void Destroy(Entity entity)
+	{
+		commands.push_back({ EntityCommandType::Destroy, entity, nullptr, nullptr });
+	}
+	// Records component addition, value is constructed now and moved into the entity on playback
+	template<class T, class... Args>
+	void AddComponent(Entity entity, Args&&... args)
+	{
+		auto& type = GetComponentType<T>();
+		auto component = AllocateValue(sizeof(T), alignof(T));
+		new (component) T(forward<Args>(args)...);
+		commands.push_back({ EntityCommandType::AddComponent, entity, &type, component });
+	}
+	// Records component removal (ignored on playback if entity does not have it)
+	template<class T>
+	void RemoveComponent(Entity entity)
+	{
+		commands.push_back({ EntityCommandType::RemoveComponent, entity, &GetComponentType<T>(), nullptr });
+	}
+
+	// Destroys recorded commands and their component values (page memory is kept for reuse)
+	void Clear()
+	{
+		for (auto& command : commands)
+		{
+			if (command.component)
+				command.componentType->destruct(command.component);
+		}
+
+		for (auto& value : dedicatedValues)
+			operator delete(value.first, align_val_t(value.second));
+
+		commands.clear();
+		dedicatedValues.clear();
+		pageIndex = 0;
+		pageOffset = 0;
+		createCount = 0;
+	}
+
+	// Applies recorded commands to the system in the recorded order, then clears buffer
+	// Commands targeting not alive entities are skipped, so concurrent destroys of the same entity are valid
+	void Playback(System& system)
+	{
+		createdEntities.assign(createCount, NullEntity);
+		vector<uint8_t> isMerged(commands.size(), 0);
+		vector<size_t> nextMerged(commands.size(), SIZE_MAX);
+		LinkMergedCommands(nextMerged);
+
+		for (size_t i = 0; i < commands.size(); i++)
+		{
+			if (isMerged[i])
+				continue;
+
+			auto& command = commands[i];
+
+			switch (command.type)
+			{
+			case EntityCommandType::Create:
+				PlaybackCreate(system, i, nextMerged, isMerged);
+				break;
+			case EntityCommandType::Destroy:
+			{
+				auto entity = Resolve(command.entity);
+
+				if (system.Contains(entity))
+					system.Remove(entity);
+				break;
+			}
+			case EntityCommandType::AddComponent:
+				PlaybackAddComponent(system, command);
+				break;
+			case EntityCommandType::RemoveComponent:
+			{
+				auto entity = Resolve(command.entity);
+
+				if (system.Contains(entity) && system.HasComponent(entity, *command.componentType))
+					system.RemoveComponent(entity, *command.componentType);
+				break;
+			}
+			}
+		}
+
+		Clear();
+	}
+};
@@ -50,6 +50,16 @@ public:
 	ArgumentOutOfRangeException(const char* message) : runtime_error(message) { }
 };
 
+// Input output exception container class
+class IOException : public runtime_error
+{
+public:
+	// Creates a new input output exception class instance
+	IOException(const string& message) : runtime_error(message) { }
+	// Creates a new input output exception class instance
+	IOException(const char* message) : runtime_error(message) { }
+};
+
 // Graphics exception container class
 class GraphicsException : public runtime_error
 {
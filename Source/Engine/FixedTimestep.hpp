@@ -0,0 +1,92 @@
+
+// Copyright 2019 Nikita Fediuchin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+#include "Exceptions.hpp"
+
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+
+using namespace std;
+
+// Default maximal simulation tick count per frame
+const uint32_t DefaultMaxFrameTickCount = 8;
+
+// Fixed timestep simulation clock class
+// Time is accumulated in integer nanoseconds, so the tick sequence does not drift and replays are deterministic.
+// Ticks above the per frame limit are dropped, so a slow simulation can not spiral.
+class FixedTimestep
+{
+protected:
+	// Tick duration in nanoseconds
+	int64_t tickDuration;
+	// Accumulated not simulated time in nanoseconds
+	int64_t accumulator;
+	// Maximal tick count per frame
+	uint32_t maxFrameTickCount;
+	// Total simulated tick count
+	uint64_t tickCount;
+	// Total dropped tick count
+	uint64_t droppedTickCount;
+
+public:
+	// Creates a new fixed timestep instance
+	FixedTimestep(double tickRate, uint32_t _maxFrameTickCount)
+	{
+		if (!(tickRate > 0.0) || tickRate > 1e9)
+			throw ArgumentOutOfRangeException("Fixed timestep tick rate is out of range");
+		if (_maxFrameTickCount == 0)
+			throw ArgumentOutOfRangeException("Fixed timestep tick count per frame can not be zero");
+
+		tickDuration = llround(1e9 / tickRate);
+		accumulator = 0;
+		maxFrameTickCount = _maxFrameTickCount;
+		tickCount = 0;
+		droppedTickCount = 0;
+	}
+
+	// Returns tick duration in seconds
+	double GetTickTime() { return tickDuration * 1e-9; }
+	// Returns total simulated tick count
+	uint64_t GetTickCount() { return tickCount; }
+	// Returns total dropped tick count (simulation was slower than real time)
+	uint64_t GetDroppedTickCount() { return droppedTickCount; }
+	// Returns interpolation factor between the previous and the current tick states [0, 1)
+	double GetAlpha() { return static_cast<double>(accumulator) / tickDuration; }
+
+	// Accumulates frame time in seconds, returns tick count to simulate in this frame
+	uint32_t Advance(double frameTime)
+	{
+		accumulator += max(llround(frameTime * 1e9), 0ll);
+
+		auto count = static_cast<uint64_t>(accumulator / tickDuration);
+		accumulator -= static_cast<int64_t>(count) * tickDuration;
+
+		if (count > maxFrameTickCount)
+		{
+			droppedTickCount += count - maxFrameTickCount;
+			count = maxFrameTickCount;
+		}
+
+		tickCount += count;
+		return static_cast<uint32_t>(count);
+	}
+	// Removes accumulated time (for example after a loading pause)
+	void Reset()
+	{
+		accumulator = 0;
+	}
+};
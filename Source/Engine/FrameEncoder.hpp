@@ -0,0 +1,266 @@
+
+// Copyright 2019 Nikita Fediuchin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+#include "ImageFile.hpp"
+
+#include <mutex>
+#include <deque>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+#include <exception>
+#include <condition_variable>
+
+using namespace std;
+
+// Default captured frame count waiting for the encoder threads
+const size_t DefaultCaptureQueueCapacity = 8;
+
+// Captured frame pixels waiting for the encoding
+struct CapturedFrame
+{
+	// Captured frame sequence number
+	uint64_t frameIndex;
+	// Frame width in pixels
+	uint32_t width;
+	// Frame height in pixels
+	uint32_t height;
+	// Are pixels in the BGRA8 order (swapchain images), otherwise RGBA8
+	bool isBgra;
+	// Tightly packed frame pixels (top row first)
+	vector<uint8_t> pixels;
+};
+
+// Background frame encoder class (captured frames are encoded and written to the disk on its own threads)
+// Frame buffers are preallocated by the queue capacity, frame is dropped instead of blocking the caller if all of them are busy.
+class FrameEncoder
+{
+protected:
+	// Image file path prefix (frame index and extension are appended)
+	string filePrefix;
+	// Image file format
+	ImageFileFormat format;
+
+	// Captured frame array (owned frame buffers)
+	vector<CapturedFrame*> frames;
+	// Free captured frame array
+	vector<CapturedFrame*> freeFrames;
+	// Captured frame queue (oldest first)
+	deque<CapturedFrame*> queuedFrames;
+	// Encoder thread array
+	vector<thread> encoderThreads;
+	// Frame queue mutex
+	mutex queueMutex;
+	// Frame queue condition variable (new frame, finished frame or close)
+	condition_variable queueCondition;
+	// Is encoder closed (threads exit after the queue is empty)
+	bool isClosed;
+
+	// First encoder thread exception (rethrown on the submitting thread)
+	exception_ptr encoderException;
+	// Written frame count
+	uint64_t encodedFrameCount;
+	// Dropped frame count (all frame buffers were busy)
+	uint64_t droppedFrameCount;
+	// Sum of the frame encode and write times in seconds
+	double totalEncodeTime;
+
+	// Rethrows and clears encoder thread exception (queue mutex should be locked)
+	void RethrowEncoderException()
+	{
+		if (!encoderException)
+			return;
+
+		auto exception = encoderException;
+		encoderException = nullptr;
+		rethrow_exception(exception);
+	}
+
+	// Encodes and writes queued frames until the encoder is closed (encoder thread)
+	void EncodeLoop()
+	{
+		vector<uint8_t> data;
+
+		while (true)
+		{
+			CapturedFrame* frame;
+
+			{
+				unique_lock<mutex> lock(queueMutex);
+				queueCondition.wait(lock, [&] { return isClosed || !queuedFrames.empty(); });
+
+				if (queuedFrames.empty())
+					return;
+
+				frame = queuedFrames.front();
+				queuedFrames.pop_front();
+			}
+
+			auto encodeStartTime = chrono::high_resolution_clock::now();
+			auto isEncoded = false;
+
+			try
+			{
+				EncodeImage(format, frame->width, frame->height, frame->isBgra, frame->pixels.data(), data);
+				WriteImageFile(GetFilePath(frame->frameIndex), data);
+				isEncoded = true;
+			}
+			catch (...)
+			{
+				lock_guard<mutex> lock(queueMutex);
+
+				if (!encoderException)
+					encoderException = current_exception();
+			}
+
+			auto encodeTime = chrono::duration<double>(chrono::high_resolution_clock::now() - encodeStartTime).count();
+
+			{
+				lock_guard<mutex> lock(queueMutex);
+				freeFrames.push_back(frame);
+
+				if (isEncoded)
+				{
+					encodedFrameCount++;
+					totalEncodeTime += encodeTime;
+				}
+			}
+
+			queueCondition.notify_all();
+		}
+	}
+
+public:
+	// Creates a new frame encoder instance and starts its threads
+	FrameEncoder(const string& _filePrefix, ImageFileFormat _format, size_t queueCapacity, size_t threadCount)
+	{
+		if (queueCapacity == 0)
+			throw ArgumentOutOfRangeException("Frame encoder queue capacity can not be zero");
+		if (threadCount == 0)
+			throw ArgumentOutOfRangeException("Frame encoder thread count can not be zero");
+
+		GetImageFileExtension(_format);
+
+		filePrefix = _filePrefix;
+		format = _format;
+		isClosed = false;
+		encodedFrameCount = 0;
+		droppedFrameCount = 0;
+		totalEncodeTime = 0.0;
+
+		frames.resize(queueCapacity);
+
+		for (size_t i = 0; i < queueCapacity; i++)
+		{
+			frames[i] = new CapturedFrame();
+			freeFrames.push_back(frames[i]);
+		}
+
+		for (size_t i = 0; i < threadCount; i++)
+			encoderThreads.push_back(thread(&FrameEncoder::EncodeLoop, this));
+	}
+	// Destroys frame encoder instance (queued frames are written first)
+	~FrameEncoder()
+	{
+		{
+			lock_guard<mutex> lock(queueMutex);
+			isClosed = true;
+		}
+
+		queueCondition.notify_all();
+
+		for (auto& encoderThread : encoderThreads)
+			encoderThread.join();
+
+		for (auto frame : frames)
+			delete frame;
+	}
+
+	// Returns image file format
+	ImageFileFormat GetFormat() { return format; }
+	// Returns image file path of the frame
+	string GetFilePath(uint64_t frameIndex)
+	{
+		ostringstream path;
+		path << filePrefix << setw(6) << setfill('0') << frameIndex << GetImageFileExtension(format);
+		return path.str();
+	}
+
+	// Returns written frame count
+	uint64_t GetEncodedFrameCount()
+	{
+		lock_guard<mutex> lock(queueMutex);
+		return encodedFrameCount;
+	}
+	// Returns dropped frame count (encoder was slower than the capture)
+	uint64_t GetDroppedFrameCount()
+	{
+		lock_guard<mutex> lock(queueMutex);
+		return droppedFrameCount;
+	}
+	// Returns average frame encode and write time in seconds
+	double GetAverageEncodeTime()
+	{
+		lock_guard<mutex> lock(queueMutex);
+		return encodedFrameCount > 0 ? totalEncodeTime / encodedFrameCount : 0.0;
+	}
+
+	// Copies frame pixels to the free frame buffer and queues it for the encoding (never waits for the encoder)
+	// Returns false if the frame was dropped, rethrows the encoder thread exception.
+	bool Submit(uint64_t frameIndex, uint32_t width, uint32_t height, bool isBgra, const void* pixels)
+	{
+		CapturedFrame* frame;
+
+		{
+			lock_guard<mutex> lock(queueMutex);
+			RethrowEncoderException();
+
+			if (freeFrames.empty())
+			{
+				droppedFrameCount++;
+				return false;
+			}
+
+			frame = freeFrames.back();
+			freeFrames.pop_back();
+		}
+
+		frame->frameIndex = frameIndex;
+		frame->width = width;
+		frame->height = height;
+		frame->isBgra = isBgra;
+		frame->pixels.resize(static_cast<size_t>(width) * height * 4);
+		memcpy(frame->pixels.data(), pixels, frame->pixels.size());
+
+		{
+			lock_guard<mutex> lock(queueMutex);
+			queuedFrames.push_back(frame);
+		}
+
+		queueCondition.notify_all();
+		return true;
+	}
+	// Waits until all queued frames are written, rethrows the encoder thread exception
+	void Wait()
+	{
+		unique_lock<mutex> lock(queueMutex);
+		queueCondition.wait(lock, [&] { return freeFrames.size() == frames.size(); });
+		RethrowEncoderException();
+	}
+};
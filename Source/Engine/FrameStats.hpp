@@ -0,0 +1,121 @@
+
+// Copyright 2019 Nikita Fediuchin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+#include "Exceptions.hpp"
+
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+
+using namespace std;
+
+// Default frame time sample window size
+const size_t DefaultFrameSampleCount = 1024;
+
+// Frame time statistics summary (seconds, over the sample window)
+struct FrameTimeSummary
+{
+	// Sample count in the window
+	size_t sampleCount;
+	// Minimal frame time
+	double minTime;
+	// Average frame time
+	double averageTime;
+	// 99th percentile frame time
+	double p99Time;
+	// Maximal frame time
+	double maxTime;
+};
+
+// Frame time statistics class (keeps the last samples in a ring)
+class FrameStats
+{
+protected:
+	// Frame time sample ring
+	vector<double> samples;
+	// Percentile selection buffer (reused between summaries)
+	vector<double> sortedSamples;
+	// Next sample ring index
+	size_t nextSample;
+	// Sample count in the ring
+	size_t sampleCount;
+	// Total recorded frame count
+	uint64_t frameCount;
+
+public:
+	// Creates a new frame statistics instance
+	FrameStats(size_t _sampleCount)
+	{
+		if (_sampleCount == 0)
+			throw ArgumentOutOfRangeException("Frame statistics sample count can not be zero");
+
+		samples.resize(_sampleCount);
+		sortedSamples.reserve(_sampleCount);
+		nextSample = 0;
+		sampleCount = 0;
+		frameCount = 0;
+	}
+
+	// Returns total recorded frame count
+	uint64_t GetFrameCount() { return frameCount; }
+
+	// Adds a new frame time sample in seconds (oldest sample is replaced if window is full)
+	void AddSample(double frameTime)
+	{
+		samples[nextSample] = frameTime;
+		nextSample = (nextSample + 1) % samples.size();
+		sampleCount = min(sampleCount + 1, samples.size());
+		frameCount++;
+	}
+	// Removes all samples
+	void Clear()
+	{
+		nextSample = 0;
+		sampleCount = 0;
+		frameCount = 0;
+	}
+
+	// Returns frame time summary of the sample window
+	FrameTimeSummary GetSummary()
+	{
+		FrameTimeSummary summary = {};
+		summary.sampleCount = sampleCount;
+
+		if (sampleCount == 0)
+			return summary;
+
+		sortedSamples.assign(samples.begin(), samples.begin() + sampleCount);
+
+		auto total = 0.0;
+		summary.minTime = sortedSamples[0];
+		summary.maxTime = sortedSamples[0];
+
+		for (auto sample : sortedSamples)
+		{
+			total += sample;
+			summary.minTime = min(summary.minTime, sample);
+			summary.maxTime = max(summary.maxTime, sample);
+		}
+
+		summary.averageTime = total / sampleCount;
+
+		// Nearest rank percentile, selection is linear
+		auto rank = (sampleCount * 99 + 99) / 100 - 1;
+		nth_element(sortedSamples.begin(), sortedSamples.begin() + rank, sortedSamples.end());
+		summary.p99Time = sortedSamples[rank];
+		return summary;
+	}
+};
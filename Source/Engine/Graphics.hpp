@@ -15,49 +15,449 @@
 
 #pragma once
 #include "Vulkan/Window.hpp"
+#include "Vulkan/Headless.hpp"
+#include "RenderQueue.hpp"
+#include "FrameStats.hpp"
+#include "FixedTimestep.hpp"
+#include "FrameEncoder.hpp"
+
+#include <thread>
+#include <exception>
+#include <functional>
 
 using namespace Vulkan;
 
+// Render packet queue capacity (simulation can run one frame ahead of the render thread)
+const uint64_t RenderQueueCapacity = 1;
+
 class Graphics
 {
 protected:
-	// GLFW window instance
+	// GLFW window instance (null if headless)
 	GlfwWindow glfwWindow;
-	// Vulkan window instance
+	// Vulkan window instance (null if headless)
 	Window vulkanWindow;
-	
+	// Vulkan headless render target instance (null if windowed)
+	Headless vulkanHeadless;
+	// Vulkan renderer instance (window or headless render target)
+	Renderer renderer;
+	// Command record job system (null if headless)
+	JobSystem* jobSystem;
+
+	// Are frames recorded and submitted on the dedicated render thread
+	bool isRenderThreaded;
+	// Render packet queue (null if loop is not running on the render thread)
+	RenderQueue* renderQueue;
+	// Render thread (records and submits frames from the queued render packets)
+	thread renderThread;
+	// Render thread exception (rethrown on the loop thread)
+	exception_ptr renderException;
+	// Next frame sequence number
+	uint64_t frameIndex;
+	// Loop frame time statistics
+	FrameStats* frameStats;
+	// Simulation fixed timestep (null if loop has no fixed timestep)
+	FixedTimestep* timestep;
+	// Captured frame encoder (null if capture is disabled)
+	FrameEncoder* frameEncoder;
+
+	// GLFW framebuffer resize callback
+	static void OnFramebufferResize(GlfwWindow window, int width, int height)
+	{
+		auto graphics = static_cast<Graphics*>(glfwGetWindowUserPointer(window));
+		graphics->vulkanWindow->OnFramebufferResize();
+	}
+
+	// Draws frames from the render packet queue until it is closed (render thread)
+	void RenderLoop()
+	{
+		try
+		{
+			RenderPacket packet;
+
+			while (renderQueue->Pop(packet))
+				renderer->DrawFrame(packet);
+		}
+		catch (...)
+		{
+			renderException = current_exception();
+			renderQueue->Close();
+		}
+	}
+	// Stops render thread and destroys render packet queue
+	void StopRenderThread()
+	{
+		if (!renderThread.joinable())
+			return;
+
+		renderQueue->Close();
+		renderThread.join();
+
+		delete renderQueue;
+		renderQueue = nullptr;
+	}
+
+	// Runs program graphics loop until the window is closed or the frame count is drawn
+	// Ticks are simulated only if there is a fixed timestep, headless loop has no window events.
+	void RunLoop(uint64_t frameCount, const function<void(double, uint64_t)>& tick, const function<void(RenderPacket&)>& update)
+	{
+		if (isRenderThreaded)
+		{
+			renderQueue = new RenderQueue(RenderQueueCapacity);
+			renderThread = thread(&Graphics::RenderLoop, this);
+		}
+
+		frameStats->Clear();
+
+		try
+		{
+			auto lastFrameTime = chrono::high_resolution_clock::now();
+			auto extent = renderer->GetExtent();
+
+			// Minimized window frames are not drawn, so they do not count
+			uint64_t drawnFrameCount = 0;
+
+			while (drawnFrameCount < frameCount)
+			{
+				int width = static_cast<int>(extent.width), height = static_cast<int>(extent.height);
+
+				if (glfwWindow)
+				{
+					if (glfwWindowShouldClose(glfwWindow))
+						break;
+
+					glfwPollEvents();
+					glfwGetFramebufferSize(glfwWindow, &width, &height);
+				}
+
+				// Window is minimized, wait until it is restored (headless extent is never zero)
+				if (glfwWindow && (width == 0 || height == 0))
+				{
+					glfwWaitEvents();
+					lastFrameTime = chrono::high_resolution_clock::now();
+
+					if (timestep)
+						timestep->Reset();
+
+					continue;
+				}
+
+				auto inputTime = chrono::high_resolution_clock::now();
+				auto frameTime = chrono::duration<double>(inputTime - lastFrameTime).count();
+				lastFrameTime = inputTime;
+				frameStats->AddSample(frameTime);
+
+				RenderPacket packet = {};
+				packet.frameIndex = frameIndex++;
+				packet.inputTime = inputTime;
+				packet.frameTime = frameTime;
+				packet.framebufferWidth = static_cast<uint32_t>(width);
+				packet.framebufferHeight = static_cast<uint32_t>(height);
+				packet.clearColor[3] = 1.0f;
+				packet.isCaptured = frameEncoder != nullptr;
+
+				if (timestep)
+				{
+					auto tickCount = timestep->Advance(frameTime);
+					auto tickTime = timestep->GetTickTime();
+					auto firstTick = timestep->GetTickCount() - tickCount;
+
+					for (uint32_t tickOffset = 0; tickOffset < tickCount; tickOffset++)
+						tick(tickTime, firstTick + tickOffset);
+
+					packet.tickCount = timestep->GetTickCount();
+					packet.interpolationAlpha = static_cast<float>(timestep->GetAlpha());
+				}
+
+				if (update)
+					update(packet);
+
+				if (!isRenderThreaded)
+					renderer->DrawFrame(packet);
+				else if (!renderQueue->Push(packet))
+					break;
+
+				drawnFrameCount++;
+			}
+		}
+		catch (...)
+		{
+			StopRenderThread();
+			throw;
+		}
+
+		StopRenderThread();
+
+		if (renderException)
+		{
+			auto exception = renderException;
+			renderException = nullptr;
+			rethrow_exception(exception);
+		}
+
+		// Captured frames are on the disk when the loop returns
+		if (frameEncoder)
+		{
+			renderer->FlushCaptures();
+			frameEncoder->Wait();
+		}
+	}
+
+	// Creates a new headless graphics class instance (use CreateHeadless, the signature is close to the windowed one)
+	Graphics(VkExtent2D frameSize, string appName, uint32_t appVersion, const vector<const char*>& vulkanExtensions, const vector<const char*>& validationLayers, const vector<const char*>& deviceExtensions, uint32_t inFlightFrameCount, bool _isRenderThreaded)
+	{
+		isRenderThreaded = _isRenderThreaded;
+		renderQueue = nullptr;
+		frameIndex = 0;
+		timestep = nullptr;
+		frameEncoder = nullptr;
+		glfwWindow = nullptr;
+		vulkanWindow = nullptr;
+		jobSystem = nullptr;
+
+		vulkanHeadless = CreateHeadlessInstance(frameSize, appName, appVersion, vulkanExtensions, validationLayers, deviceExtensions, inFlightFrameCount);
+		renderer = vulkanHeadless;
+
+		// Created after the last throwing call, destructor does not run if constructor throws
+		frameStats = new FrameStats(DefaultFrameSampleCount);
+	}
+
 public:
 	// Creates a new graphics class instance
-	Graphics(VkExtent2D windowSize, string appName, uint32_t appVersion, const vector<const char*>& vulkanExtensions, const vector<const char*>& validationLayers, const vector<const char*>& deviceExtensions)
+	Graphics(VkExtent2D windowSize, string appName, uint32_t appVersion, const vector<const char*>& vulkanExtensions, const vector<const char*>& validationLayers, const vector<const char*>& deviceExtensions, uint32_t inFlightFrameCount, uint32_t recordThreadCount, bool _isRenderThreaded)
 	{
+		if (recordThreadCount == 0)
+			throw ArgumentOutOfRangeException("Graphics record thread count can not be zero");
+
+		isRenderThreaded = _isRenderThreaded;
+		renderQueue = nullptr;
+		frameIndex = 0;
+		timestep = nullptr;
+		frameEncoder = nullptr;
+		vulkanHeadless = nullptr;
+		jobSystem = nullptr;
+
 		if (glfwInit() == GLFW_FALSE)
 			throw GraphicsException("Failed to initialize GLFW");
 
 		glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
-		glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
+		glfwWindowHint(GLFW_RESIZABLE, GLFW_TRUE);
 
 		glfwWindow = glfwCreateWindow(windowSize.width, windowSize.height, appName.c_str(), nullptr, nullptr);
 
-		if (glfwVulkanSupported() == GLFW_FALSE)
-			throw VulkanException("Vulkan is not supported on this machine");
+		// Destructor does not run if constructor throws, so the created objects are released here
+		try
+		{
+			if (glfwVulkanSupported() == GLFW_FALSE)
+				throw VulkanException("Vulkan is not supported on this machine");
+
+			// Creating thread is the worker zero, render thread schedules record jobs as a non worker thread
+			jobSystem = new JobSystem(recordThreadCount - 1);
+			vulkanWindow = CreateWindowInstance(glfwWindow, windowSize, appName, appVersion, vulkanExtensions, validationLayers, deviceExtensions, inFlightFrameCount, jobSystem);
+		}
+		catch (...)
+		{
+			delete jobSystem;
+
+			if (glfwWindow)
+				glfwDestroyWindow(glfwWindow);
+
+			glfwTerminate();
+			throw;
+		}
 
-		vulkanWindow = CreateWindowInstance(glfwWindow, windowSize, appName, appVersion, vulkanExtensions, validationLayers, deviceExtensions);
+		renderer = vulkanWindow;
+		frameStats = new FrameStats(DefaultFrameSampleCount);
+
+		glfwSetWindowUserPointer(glfwWindow, this);
+		glfwSetFramebufferSizeCallback(glfwWindow, OnFramebufferResize);
 	}
 	// Disposes graphic class instance
 	~Graphics()
 	{
-		DestroyWindowInstance(vulkanWindow);
-		glfwDestroyWindow(glfwWindow);
-		glfwTerminate();
+		delete timestep;
+		delete frameStats;
+
+		if (vulkanHeadless)
+			DestroyHeadlessInstance(vulkanHeadless);
+		else
+			DestroyWindowInstance(vulkanWindow);
+
+		// Renderer is destroyed first, it can not submit frames to the encoder anymore
+		delete frameEncoder;
+		delete jobSystem;
+
+		if (glfwWindow)
+		{
+			glfwDestroyWindow(glfwWindow);
+			glfwTerminate();
+		}
 	}
 
-	// Enters program graphics loop
-	void EnterLoop()
+	Graphics(const Graphics&) = delete;
+	Graphics& operator=(const Graphics&) = delete;
+
+	// Creates a new headless graphics class instance (GLFW is not initialized, frames are drawn to the offscreen images)
+	static Graphics CreateHeadless(VkExtent2D frameSize, string appName, uint32_t appVersion, const vector<const char*>& vulkanExtensions, const vector<const char*>& validationLayers, const vector<const char*>& deviceExtensions, uint32_t inFlightFrameCount, bool isRenderThreaded)
+	{
+		return Graphics(frameSize, appName, appVersion, vulkanExtensions, validationLayers, deviceExtensions, inFlightFrameCount, isRenderThreaded);
+	}
+
+	// Returns true if frames are drawn to the offscreen images without a window
+	bool IsHeadless() { return vulkanHeadless != nullptr; }
+	// Returns command record job system, can be shared by the update jobs (null if headless)
+	JobSystem* GetJobSystem() { return jobSystem; }
+	// Returns drawn frame extent (window swapchain or headless render target)
+	VkExtent2D GetFrameExtent() { return renderer->GetExtent(); }
+
+	// Returns vulkan swapchain recreation count (zero if headless)
+	size_t GetSwapchainRecreateCount() { return vulkanWindow ? vulkanWindow->GetSwapchainRecreateCount() : 0; }
+	// Returns last vulkan swapchain recreation time in seconds (zero if headless)
+	double GetSwapchainRecreateTime() { return vulkanWindow ? vulkanWindow->GetSwapchainRecreateTime() : 0.0; }
+
+	// Returns vulkan device memory usage statistics per memory heap
+	vector<MemoryHeapStats> GetMemoryHeapStats() { return renderer->GetMemoryHeapStats(); }
+
+	// Returns vulkan renderer frames in flight count
+	uint32_t GetInFlightFrameCount() { return renderer->GetInFlightFrameCount(); }
+	// Returns last frame CPU wait time in seconds
+	double GetFrameWaitTime() { return renderer->GetFrameWaitTime(); }
+	// Returns true if vulkan pipeline cache was loaded from the disk (warm start)
+	bool IsPipelineCacheLoaded() { return renderer->IsPipelineCacheLoaded(); }
+	// Returns true if vulkan graphics pipeline compilation is finished
+	bool IsPipelineReady() { return renderer->IsPipelineReady(); }
+	// Returns vulkan graphics pipeline creation time in seconds
+	double GetPipelineCreationTime() { return renderer->GetPipelineCreationTime(); }
+	// Returns vulkan pipeline registry lookup statistics
+	PipelineRegistryStats GetPipelineRegistryStats() { return renderer->GetPipelineRegistryStats(); }
+	// Returns vulkan window command record thread count (one if headless)
+	uint32_t GetRecordThreadCount() { return vulkanWindow ? vulkanWindow->GetRecordThreadCount() : 1; }
+	// Returns last frame command record time in seconds
+	double GetFrameRecordTime() { return renderer->GetFrameRecordTime(); }
+	// Returns true if frames are recorded and submitted on the dedicated render thread
+	bool IsRenderThreaded() { return isRenderThreaded; }
+	// Returns average frame input to submit latency in seconds
+	double GetAverageSubmitLatency() { return renderer->GetAverageSubmitLatency(); }
+	// Returns maximal frame input to submit latency in seconds
+	double GetMaxSubmitLatency() { return renderer->GetMaxSubmitLatency(); }
+	// Returns submitted frame count
+	uint64_t GetSubmittedFrameCount() { return renderer->GetSubmittedFrameCount(); }
+	// Returns loop frame time statistics over the last frames
+	FrameTimeSummary GetFrameTimeSummary() { return frameStats->GetSummary(); }
+	// Returns simulated fixed tick count (zero if loop has no fixed timestep)
+	uint64_t GetSimulatedTickCount() { return timestep ? timestep->GetTickCount() : 0; }
+	// Returns dropped fixed tick count (simulation was slower than real time)
+	uint64_t GetDroppedTickCount() { return timestep ? timestep->GetDroppedTickCount() : 0; }
+	// Returns true if loop frames are captured to the image files
+	bool IsCapturing() { return frameEncoder != nullptr; }
+	// Returns written captured frame count (zero if capture is disabled)
+	uint64_t GetCapturedFrameCount() { return frameEncoder ? frameEncoder->GetEncodedFrameCount() : 0; }
+	// Returns dropped captured frame count (encoder was slower than the loop)
+	uint64_t GetDroppedCaptureCount() { return frameEncoder ? frameEncoder->GetDroppedFrameCount() : 0; }
+	// Returns average captured frame encode and write time in seconds
+	double GetAverageCaptureTime() { return frameEncoder ? frameEncoder->GetAverageEncodeTime() : 0.0; }
+
+	// Starts capturing loop frames to the image files ("<prefix><frame index><extension>")
+	// Every frame is captured unless the update clears the render packet capture flag, the GPU copy is read back
+	// frames in flight later and encoded on the background threads, so the loop never waits for the encoding.
+	// Should be called outside of the loop.
+	void StartCapture(const string& filePrefix, ImageFileFormat format, size_t queueCapacity, size_t threadCount)
+	{
+		StopCapture();
+
+		frameEncoder = new FrameEncoder(filePrefix, format, queueCapacity, threadCount);
+
+		try
+		{
+			renderer->SetFrameEncoder(frameEncoder);
+		}
+		catch (...)
+		{
+			delete frameEncoder;
+			frameEncoder = nullptr;
+			throw;
+		}
+	}
+	// Starts capturing loop frames with the default queue capacity and encoder thread count
+	void StartCapture(const string& filePrefix, ImageFileFormat format)
+	{
+		auto threadCount = max(thread::hardware_concurrency() / 2, 1u);
+		StartCapture(filePrefix, format, DefaultCaptureQueueCapacity, threadCount);
+	}
+	// Stops capturing loop frames, waits until the captured frames are written
+	void StopCapture()
 	{
-		while (!glfwWindowShouldClose(glfwWindow))
+		if (!frameEncoder)
+			return;
+
+		renderer->SetFrameEncoder(nullptr);
+
+		auto encoder = frameEncoder;
+		frameEncoder = nullptr;
+
+		try
 		{
-			glfwPollEvents();
-			vulkanWindow->DrawFrame();
+			encoder->Wait();
 		}
+		catch (...)
+		{
+			delete encoder;
+			throw;
+		}
+
+		delete encoder;
+	}
+
+	// Enters program graphics loop (update fills the frame render packet, can be empty)
+	// With the render thread frame N is drawn while frame N + 1 is updated,
+	// vulkan window should not be used by the update while the loop is running.
+	void EnterLoop(const function<void(RenderPacket&)>& update)
+	{
+		if (vulkanHeadless)
+			throw GraphicsException("Headless graphics has no window to close, use RenderFrames instead");
+
+		delete timestep;
+		timestep = nullptr;
+
+		RunLoop(UINT64_MAX, nullptr, update);
+	}
+	// Enters program graphics loop with the fixed rate simulation (tick rate in Hz)
+	// Tick receives the fixed tick time in seconds and the tick index, frames are drawn at the display rate
+	// and the render packet interpolation alpha blends the last two simulated states.
+	void EnterLoop(double tickRate, const function<void(double, uint64_t)>& tick, const function<void(RenderPacket&)>& update)
+	{
+		if (vulkanHeadless)
+			throw GraphicsException("Headless graphics has no window to close, use RenderFrames instead");
+		if (!tick)
+			throw ArgumentNullException("Simulation tick function is null");
+
+		delete timestep;
+		timestep = new FixedTimestep(tickRate, DefaultMaxFrameTickCount);
+
+		RunLoop(UINT64_MAX, tick, update);
+	}
+	// Enters program graphics loop without the frame update
+	void EnterLoop()
+	{
+		EnterLoop(nullptr);
+	}
+
+	// Draws frames back to back without the fixed timestep (stops early if the window is closed)
+	// Returns after the last frame is submitted, headless frames are read back with ReadFrame.
+	void RenderFrames(uint64_t frameCount, const function<void(RenderPacket&)>& update)
+	{
+		delete timestep;
+		timestep = nullptr;
+
+		RunLoop(frameCount, nullptr, update);
+	}
+	// Waits for the last drawn headless frame and copies its RGBA8 pixels (GetFrameExtent sized, top row first)
+	void ReadFrame(vector<uint8_t>& pixels)
+	{
+		if (!vulkanHeadless)
+			throw GraphicsException("Only headless graphics frames can be read");
+
+		pixels.resize(vulkanHeadless->GetFrameSize());
+		vulkanHeadless->ReadFrame(pixels.data());
 	}
 };
\ No newline at end of file
@@ -0,0 +1,305 @@
+
+// Copyright 2019 Nikita Fediuchin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+#include "Exceptions.hpp"
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <algorithm>
+
+using namespace std;
+
+// Maximal stored deflate block size
+const size_t StoredDeflateBlockSize = 65535;
+
+// Image file format
+enum class ImageFileFormat : uint8_t
+{
+	// Tightly packed RGBA8 rows without a header
+	Raw,
+	// Binary portable pixmap (RGB8)
+	Ppm,
+	// Portable network graphics (RGB8, stored deflate blocks)
+	Png,
+};
+
+// Returns image file format extension (with the dot)
+static const char* GetImageFileExtension(ImageFileFormat format)
+{
+	switch (format)
+	{
+	case ImageFileFormat::Raw:
+		return ".raw";
+	case ImageFileFormat::Ppm:
+		return ".ppm";
+	case ImageFileFormat::Png:
+		return ".png";
+	default:
+		throw ArgumentOutOfRangeException("Unknown image file format");
+	}
+}
+
+// Returns CRC-32 (ISO 3309) of the data continuing from the previous CRC value
+// Four table lookups per four bytes (slicing by four), PNG chunks are checksummed on every captured frame.
+static uint32_t UpdateCrc32(uint32_t crc, const uint8_t* data, size_t size)
+{
+	static const auto tables = []()
+	{
+		vector<uint32_t> values(4 * 256);
+
+		for (uint32_t i = 0; i < 256; i++)
+		{
+			auto value = i;
+
+			for (int j = 0; j < 8; j++)
+				value = (value & 1) ? 0xEDB88320u ^ (value >> 1) : value >> 1;
+
+			values[i] = value;
+		}
+
+		for (uint32_t i = 0; i < 256; i++)
+		{
+			for (uint32_t j = 1; j < 4; j++)
+				values[j * 256 + i] = values[(j - 1) * 256 + i] >> 8 ^ values[values[(j - 1) * 256 + i] & 0xFF];
+		}
+
+		return values;
+	}();
+
+	auto table = tables.data();
+	crc = ~crc;
+
+	while (size >= 4)
+	{
+		crc ^= static_cast<uint32_t>(data[0]) | static_cast<uint32_t>(data[1]) << 8 |
+			static_cast<uint32_t>(data[2]) << 16 | static_cast<uint32_t>(data[3]) << 24;
+		crc = table[3 * 256 + (crc & 0xFF)] ^ table[2 * 256 + (crc >> 8 & 0xFF)] ^
+			table[256 + (crc >> 16 & 0xFF)] ^ table[crc >> 24];
+
+		data += 4;
+		size -= 4;
+	}
+
+	for (size_t i = 0; i < size; i++)
+		crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+
+	return ~crc;
+}
+// Returns Adler-32 of the data continuing from the previous Adler value
+static uint32_t UpdateAdler32(uint32_t adler, const uint8_t* data, size_t size)
+{
+	uint32_t a = adler & 0xFFFF, b = adler >> 16;
+
+	// 5552 is the largest count before the 32 bit sums can overflow
+	while (size > 0)
+	{
+		auto count = size < 5552 ? size : 5552;
+		size -= count;
+
+		// Sixteen byte groups add their weighted sum at once, so the inner loop has no serial dependency
+		for (; count >= 16; count -= 16, data += 16)
+		{
+			uint32_t groupSum = 0, weightedSum = 0;
+
+			for (uint32_t i = 0; i < 16; i++)
+			{
+				groupSum += data[i];
+				weightedSum += (16 - i) * data[i];
+			}
+
+			b += 16 * a + weightedSum;
+			a += groupSum;
+		}
+
+		for (; count > 0; count--, data++)
+		{
+			a += *data;
+			b += a;
+		}
+
+		a %= 65521;
+		b %= 65521;
+	}
+
+	return (b << 16) | a;
+}
+
+// Appends big endian 32 bit value to the data
+static void WriteBigEndian32(vector<uint8_t>& data, uint32_t value)
+{
+	data.push_back(static_cast<uint8_t>(value >> 24));
+	data.push_back(static_cast<uint8_t>(value >> 16));
+	data.push_back(static_cast<uint8_t>(value >> 8));
+	data.push_back(static_cast<uint8_t>(value));
+}
+// Appends PNG chunk with its length and CRC to the data
+static void WritePngChunk(vector<uint8_t>& data, const char type[4], const uint8_t* chunkData, size_t size)
+{
+	WriteBigEndian32(data, static_cast<uint32_t>(size));
+
+	auto typeOffset = data.size();
+	data.insert(data.end(), type, type + 4);
+	data.insert(data.end(), chunkData, chunkData + size);
+
+	WriteBigEndian32(data, UpdateCrc32(0, data.data() + typeOffset, size + 4));
+}
+
+// Encodes RGBA8 or BGRA8 pixels (top row first) to the image file data
+static void EncodeImage(ImageFileFormat format, uint32_t width, uint32_t height, bool isBgra, const uint8_t* pixels, vector<uint8_t>& data)
+{
+	auto red = isBgra ? 2 : 0, blue = isBgra ? 0 : 2;
+	auto pixelCount = static_cast<size_t>(width) * height;
+
+	data.clear();
+
+	if (format == ImageFileFormat::Raw)
+	{
+		data.resize(pixelCount * 4);
+
+		for (size_t i = 0; i < pixelCount; i++)
+		{
+			data[i * 4 + 0] = pixels[i * 4 + red];
+			data[i * 4 + 1] = pixels[i * 4 + 1];
+			data[i * 4 + 2] = pixels[i * 4 + blue];
+			data[i * 4 + 3] = pixels[i * 4 + 3];
+		}
+	}
+	else if (format == ImageFileFormat::Ppm)
+	{
+		auto header = "P6\n" + to_string(width) + " " + to_string(height) + "\n255\n";
+		data.resize(header.size() + pixelCount * 3);
+		copy(header.begin(), header.end(), data.begin());
+
+		auto rgb = data.data() + header.size();
+
+		for (size_t i = 0; i < pixelCount; i++)
+		{
+			rgb[i * 3 + 0] = pixels[i * 4 + red];
+			rgb[i * 3 + 1] = pixels[i * 4 + 1];
+			rgb[i * 3 + 2] = pixels[i * 4 + blue];
+		}
+	}
+	else if (format == ImageFileFormat::Png)
+	{
+		// Scanlines with the filter type byte (none) are written as stored deflate blocks straight into the IDAT chunk,
+		// so encoding is bound by the copy and checksums instead of the compression.
+		auto rowSize = static_cast<size_t>(width) * 3 + 1;
+		auto scanlineSize = rowSize * height;
+		auto blockCount = (scanlineSize + StoredDeflateBlockSize - 1) / StoredDeflateBlockSize;
+		auto streamSize = 2 + scanlineSize + blockCount * 5 + 4;
+
+		if (streamSize > UINT32_MAX)
+			throw ArgumentOutOfRangeException("Image is too large for the single PNG chunk");
+
+		// 8 bit depth, truecolor, deflate, adaptive filtering, no interlace
+		vector<uint8_t> header;
+		WriteBigEndian32(header, width);
+		WriteBigEndian32(header, height);
+		header.insert(header.end(), { 8, 2, 0, 0, 0 });
+
+		const uint8_t signature[] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+		data.reserve(sizeof(signature) + header.size() + streamSize + 36);
+		data.insert(data.end(), signature, signature + sizeof(signature));
+		WritePngChunk(data, "IHDR", header.data(), header.size());
+
+		WriteBigEndian32(data, static_cast<uint32_t>(streamSize));
+		auto chunkOffset = data.size();
+		data.insert(data.end(), { 'I', 'D', 'A', 'T' });
+
+		// Zlib header, deflate with the 32K window and no preset dictionary
+		data.push_back(0x78);
+		data.push_back(0x01);
+
+		auto streamOffset = data.size();
+		data.resize(streamOffset + streamSize - 6);
+
+		auto destination = data.data() + streamOffset;
+		size_t blockRemaining = 0, scanlineRemaining = scanlineSize;
+		uint32_t adler = 1;
+
+		// Writes scanline bytes, starting a new stored block header at every block boundary
+		auto write = [&](const uint8_t* values, size_t count)
+		{
+			while (count > 0)
+			{
+				if (blockRemaining == 0)
+				{
+					auto size = static_cast<uint16_t>(min(StoredDeflateBlockSize, scanlineRemaining));
+					destination[0] = size == scanlineRemaining ? 1 : 0;
+					destination[1] = static_cast<uint8_t>(size);
+					destination[2] = static_cast<uint8_t>(size >> 8);
+					destination[3] = static_cast<uint8_t>(~size);
+					destination[4] = static_cast<uint8_t>(~size >> 8);
+					destination += 5;
+					blockRemaining = size;
+				}
+
+				auto writeCount = min(count, blockRemaining);
+				memcpy(destination, values, writeCount);
+				adler = UpdateAdler32(adler, values, writeCount);
+
+				destination += writeCount;
+				values += writeCount;
+				count -= writeCount;
+				blockRemaining -= writeCount;
+				scanlineRemaining -= writeCount;
+			}
+		};
+
+		vector<uint8_t> row(rowSize);
+
+		for (size_t y = 0; y < height; y++)
+		{
+			auto source = pixels + y * width * 4;
+			row[0] = 0;
+
+			for (size_t x = 0; x < width; x++)
+			{
+				row[1 + x * 3 + 0] = source[x * 4 + red];
+				row[1 + x * 3 + 1] = source[x * 4 + 1];
+				row[1 + x * 3 + 2] = source[x * 4 + blue];
+			}
+
+			write(row.data(), rowSize);
+		}
+
+		WriteBigEndian32(data, adler);
+		WriteBigEndian32(data, UpdateCrc32(0, data.data() + chunkOffset, data.size() - chunkOffset));
+
+		WritePngChunk(data, "IEND", nullptr, 0);
+	}
+	else
+	{
+		throw ArgumentOutOfRangeException("Unknown image file format");
+	}
+}
+
+// Writes image file data to the disk (throws if file can not be written)
+static void WriteImageFile(const string& filePath, const vector<uint8_t>& data)
+{
+	ofstream file(filePath, ios::binary | ios::trunc);
+
+	if (!file.is_open())
+		throw IOException("Failed to open image file. Path: " + filePath);
+
+	file.write(reinterpret_cast<const char*>(data.data()), data.size());
+
+	if (!file)
+		throw IOException("Failed to write image file. Path: " + filePath);
+}
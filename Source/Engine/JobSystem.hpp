@@ -0,0 +1,550 @@
+
+// Copyright 2019 Nikita Fediuchin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+#include "Exceptions.hpp"
+
+#include <new>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <cstdint>
+#include <exception>
+#include <utility>
+#include <algorithm>
+#include <type_traits>
+#include <condition_variable>
+
+using namespace std;
+
+// Job inline function storage size in bytes
+const size_t JobDataSize = 48;
+// Job count per worker ring (and worker deque capacity, power of two)
+const size_t WorkerJobCount = 4096;
+// Idle worker spin iteration count before sleeping
+const uint32_t JobIdleSpinCount = 64;
+
+// Job completion counter (incremented on schedule, decremented when job is finished or failed)
+struct JobCounter
+{
+	// Unfinished job count
+	atomic<uint32_t> value{ 0 };
+	// Is first job exception stored
+	atomic<bool> isFailed{ false };
+	// First counted job exception (rethrown by the wait, valid when all jobs are finished)
+	exception_ptr exception;
+
+	// Returns true if all counted jobs are finished
+	bool IsDone() { return value.load(memory_order_acquire) == 0; }
+};
+
+// Job (function is stored inline, jobs are reused from the worker rings)
+struct Job
+{
+	// Invokes and destroys stored function
+	void (*execute)(Job* job);
+	// Completion counter (can be null)
+	JobCounter* counter;
+	// Is job slot free for reuse
+	atomic<bool> isFree{ true };
+	// Is job allocated on the heap (scheduled from the non worker thread or worker ring is busy)
+	bool isHeap;
+	// Inline function storage
+	alignas(16) uint8_t data[JobDataSize];
+};
+
+// Chase-Lev work stealing deque class (fixed capacity)
+// Owner pushes and pops at the bottom, other threads steal from the top.
+class JobDeque
+{
+protected:
+	// Top index (steal side)
+	alignas(64) atomic<int64_t> top;
+	// Bottom index (owner side)
+	alignas(64) atomic<int64_t> bottom;
+	// Circular job buffer
+	atomic<Job*>* buffer;
+	// Buffer capacity (power of two)
+	int64_t capacity;
+
+public:
+	// Creates a new job deque instance
+	JobDeque(size_t _capacity)
+	{
+		top = 0;
+		bottom = 0;
+		capacity = static_cast<int64_t>(_capacity);
+		buffer = new atomic<Job*>[_capacity];
+	}
+	// Destroys job deque instance
+	~JobDeque()
+	{
+		delete[] buffer;
+	}
+
+	JobDeque(const JobDeque&) = delete;
+	JobDeque& operator=(const JobDeque&) = delete;
+
+	// Pushes job to the bottom, returns false if deque is full (owner thread only)
+	bool Push(Job* job)
+	{
+		auto b = bottom.load(memory_order_relaxed);
+		auto t = top.load(memory_order_acquire);
+
+		if (b - t >= capacity)
+			return false;
+
+		// Release store instead of a standalone fence, thread sanitizer does not model fences
+		buffer[b & (capacity - 1)].store(job, memory_order_relaxed);
+		bottom.store(b + 1, memory_order_release);
+		return true;
+	}
+	// Pops job from the bottom, returns null if deque is empty (owner thread only)
+	Job* Pop()
+	{
+		auto b = bottom.load(memory_order_relaxed) - 1;
+		bottom.store(b, memory_order_relaxed);
+		atomic_thread_fence(memory_order_seq_cst);
+		auto t = top.load(memory_order_relaxed);
+
+		if (t > b)
+		{
+			bottom.store(b + 1, memory_order_relaxed);
+			return nullptr;
+		}
+
+		auto job = buffer[b & (capacity - 1)].load(memory_order_relaxed);
+
+		// Last job can be stolen concurrently, the top race decides the owner
+		if (t == b)
+		{
+			if (!top.compare_exchange_strong(t, t + 1, memory_order_seq_cst, memory_order_relaxed))
+				job = nullptr;
+
+			bottom.store(b + 1, memory_order_relaxed);
+		}
+
+		return job;
+	}
+	// Steals job from the top, returns null if deque is empty or steal race is lost (any thread)
+	Job* Steal()
+	{
+		auto t = top.load(memory_order_acquire);
+		atomic_thread_fence(memory_order_seq_cst);
+		auto b = bottom.load(memory_order_acquire);
+
+		if (t >= b)
+			return nullptr;
+
+		auto job = buffer[t & (capacity - 1)].load(memory_order_relaxed);
+
+		if (!top.compare_exchange_strong(t, t + 1, memory_order_seq_cst, memory_order_relaxed))
+			return nullptr;
+
+		return job;
+	}
+};
+
+// Work stealing job system class
+// Each worker owns a job ring and a deque, idle workers steal from the random others.
+// Thread which creates the job system is the worker zero, its waits execute jobs too.
+class JobSystem
+{
+protected:
+	// Job system worker state
+	struct Worker
+	{
+		// Worker job deque
+		JobDeque deque;
+		// Worker job ring
+		vector<Job> jobs;
+		// Next job ring index
+		size_t nextJob;
+		// Steal victim random state
+		uint32_t random;
+
+		// Creates a new worker state
+		Worker(uint32_t seed) : deque(WorkerJobCount), jobs(WorkerJobCount)
+		{
+			nextJob = 0;
+			random = seed;
+		}
+	};
+	// Current thread worker binding
+	struct ThreadBinding
+	{
+		// Job system of the worker (null if thread is not a worker)
+		JobSystem* jobSystem;
+		// Worker index
+		size_t index;
+	};
+
+	// Worker state array (worker zero is the creating thread)
+	vector<Worker*> workers;
+	// Worker thread array
+	vector<thread> threads;
+	// Jobs scheduled from the non worker threads
+	vector<Job*> injectedJobs;
+	// Injected job array mutex
+	mutex injectedMutex;
+
+	// Queued job count (scheduled but not taken yet)
+	atomic<size_t> queuedCount;
+	// Sleeping worker count
+	atomic<size_t> sleepingCount;
+	// Worker sleep mutex
+	mutex sleepMutex;
+	// Worker sleep condition variable
+	condition_variable sleepCondition;
+	// Are workers running
+	atomic<bool> isRunning;
+
+	// Returns current thread worker binding
+	static ThreadBinding& GetBinding()
+	{
+		static thread_local ThreadBinding binding = { nullptr, 0 };
+		return binding;
+	}
+	// Returns current thread worker (null if thread is not a worker of this job system)
+	Worker* GetCurrentWorker()
+	{
+		auto& binding = GetBinding();
+		return binding.jobSystem == this ? workers[binding.index] : nullptr;
+	}
+
+	// Returns a free job slot of the worker ring
+	// Busy slots are skipped (their jobs can be running lower on this stack), heap is used if whole ring is busy.
+	Job* AllocateJob(Worker* worker)
+	{
+		for (size_t i = 0; i < WorkerJobCount; i++)
+		{
+			auto job = &worker->jobs[worker->nextJob++ & (WorkerJobCount - 1)];
+
+			if (job->isFree.load(memory_order_acquire))
+			{
+				job->isFree.store(false, memory_order_relaxed);
+				job->isHeap = false;
+				return job;
+			}
+		}
+
+		auto job = new Job();
+		job->isFree = false;
+		job->isHeap = true;
+		return job;
+	}
+	// Adds job to the current worker deque or to the injected job array, wakes a sleeping worker
+	void Push(Worker* worker, Job* job)
+	{
+		queuedCount.fetch_add(1);
+
+		if (!worker || !worker->deque.Push(job))
+		{
+			lock_guard<mutex> lock(injectedMutex);
+			injectedJobs.push_back(job);
+		}
+
+		// Lock pairs with the sleeping worker predicate check, so the wake up is not lost
+		if (sleepingCount.load() > 0)
+		{
+			{
+				lock_guard<mutex> lock(sleepMutex);
+			}
+
+			sleepCondition.notify_one();
+		}
+	}
+	// Executes job and releases its slot (job exception is stored on its counter)
+	void Execute(Job* job)
+	{
+		queuedCount.fetch_sub(1, memory_order_relaxed);
+		auto counter = job->counter;
+
+		// Exception is published by the counter decrement below, waiter reads it only when count is zero
+		try
+		{
+			job->execute(job);
+		}
+		catch (...)
+		{
+			// Nobody waits for the job without a counter, same as an exception leaving a detached thread
+			if (!counter)
+				terminate();
+
+			if (!counter->isFailed.exchange(true, memory_order_relaxed))
+				counter->exception = current_exception();
+		}
+
+		if (job->isHeap)
+			delete job;
+		else
+			job->isFree.store(true, memory_order_release);
+
+		if (counter)
+			counter->value.fetch_sub(1, memory_order_release);
+	}
+	// Takes next job (own, stolen or injected), returns null if there are no jobs
+	Job* Take(Worker* worker)
+	{
+		if (worker)
+		{
+			auto job = worker->deque.Pop();
+
+			if (job)
+				return job;
+		}
+
+		auto workerCount = workers.size();
+		uint32_t random;
+
+		if (worker)
+		{
+			worker->random ^= worker->random << 13;
+			worker->random ^= worker->random >> 17;
+			worker->random ^= worker->random << 5;
+			random = worker->random;
+		}
+		else
+		{
+			random = static_cast<uint32_t>(hash<thread::id>()(this_thread::get_id()));
+		}
+
+		for (size_t i = 0; i < workerCount; i++)
+		{
+			auto victim = workers[(random + i) % workerCount];
+
+			if (victim == worker)
+				continue;
+
+			auto job = victim->deque.Steal();
+
+			if (job)
+				return job;
+		}
+
+		lock_guard<mutex> lock(injectedMutex);
+
+		if (injectedJobs.empty())
+			return nullptr;
+
+		auto job = injectedJobs.back();
+		injectedJobs.pop_back();
+		return job;
+	}
+	// Waits until the counter jobs are finished without rethrowing their exception
+	void WaitDone(JobCounter& counter)
+	{
+		auto worker = GetCurrentWorker();
+
+		while (!counter.IsDone())
+		{
+			if (!ExecuteNext(worker))
+				this_thread::yield();
+		}
+	}
+	// Executes next available job, returns false if there are no jobs
+	bool ExecuteNext(Worker* worker)
+	{
+		auto job = Take(worker);
+
+		if (!job)
+			return false;
+
+		Execute(job);
+		return true;
+	}
+
+	// Executes jobs until job system is destroyed
+	void WorkerLoop(size_t index)
+	{
+		GetBinding() = { this, index };
+		auto worker = workers[index];
+
+		while (isRunning.load(memory_order_relaxed))
+		{
+			if (ExecuteNext(worker))
+				continue;
+
+			uint32_t spin = 0;
+
+			while (spin < JobIdleSpinCount && queuedCount.load(memory_order_relaxed) == 0 && isRunning.load(memory_order_relaxed))
+			{
+				this_thread::yield();
+				spin++;
+			}
+
+			if (spin < JobIdleSpinCount)
+				continue;
+
+			unique_lock<mutex> lock(sleepMutex);
+			sleepingCount.fetch_add(1);
+			sleepCondition.wait(lock, [this]() { return queuedCount.load() > 0 || !isRunning.load(); });
+			sleepingCount.fetch_sub(1);
+		}
+	}
+
+public:
+	// Creates a new job system instance (calling thread becomes the worker zero)
+	JobSystem(size_t workerThreadCount)
+	{
+		queuedCount = 0;
+		sleepingCount = 0;
+		isRunning = true;
+
+		for (size_t i = 0; i <= workerThreadCount; i++)
+			workers.push_back(new Worker(static_cast<uint32_t>(i * 2654435761u + 1)));
+
+		GetBinding() = { this, 0 };
+		threads.reserve(workerThreadCount);
+
+		for (size_t i = 1; i <= workerThreadCount; i++)
+			threads.emplace_back(&JobSystem::WorkerLoop, this, i);
+	}
+	// Destroys job system instance (all scheduled jobs should be already waited)
+	~JobSystem()
+	{
+		{
+			lock_guard<mutex> lock(sleepMutex);
+			isRunning = false;
+		}
+
+		sleepCondition.notify_all();
+
+		for (auto& thread : threads)
+			thread.join();
+
+		if (GetBinding().jobSystem == this)
+			GetBinding() = { nullptr, 0 };
+
+		for (auto job : injectedJobs)
+			delete job;
+
+		for (auto worker : workers)
+			delete worker;
+	}
+
+	JobSystem(const JobSystem&) = delete;
+	JobSystem& operator=(const JobSystem&) = delete;
+
+	// Returns thread count (worker threads and the creating thread)
+	size_t GetThreadCount() { return workers.size(); }
+	// Returns current thread worker index (SIZE_MAX if thread is not a worker)
+	size_t GetCurrentThreadIndex()
+	{
+		auto& binding = GetBinding();
+		return binding.jobSystem == this ? binding.index : SIZE_MAX;
+	}
+
+	// Schedules a new job (counter can be null), function should fit into the job storage
+	// Exception of the counted job is rethrown by the counter wait, job without a counter should not throw.
+	template<class Function>
+	void Schedule(Function&& function, JobCounter* counter)
+	{
+		typedef typename decay<Function>::type FunctionType;
+		static_assert(sizeof(FunctionType) <= JobDataSize && alignof(FunctionType) <= 16, "Job function captures are too big");
+
+		auto worker = GetCurrentWorker();
+		Job* job;
+
+		if (worker)
+		{
+			job = AllocateJob(worker);
+		}
+		else
+		{
+			job = new Job();
+			job->isFree = false;
+			job->isHeap = true;
+		}
+
+		new (job->data) FunctionType(forward<Function>(function));
+		job->execute = [](Job* job)
+		{
+			auto stored = reinterpret_cast<FunctionType*>(job->data);
+
+			try
+			{
+				(*stored)();
+			}
+			catch (...)
+			{
+				stored->~FunctionType();
+				throw;
+			}
+
+			stored->~FunctionType();
+		};
+		job->counter = counter;
+
+		if (counter)
+			counter->value.fetch_add(1, memory_order_relaxed);
+
+		Push(worker, job);
+	}
+	// Waits for the counter jobs, executes other jobs while waiting
+	// Rethrows the first counted job exception (counter is reset and can be reused).
+	void Wait(JobCounter& counter)
+	{
+		WaitDone(counter);
+
+		if (!counter.isFailed.load(memory_order_relaxed))
+			return;
+
+		auto exception = counter.exception;
+		counter.exception = nullptr;
+		counter.isFailed.store(false, memory_order_relaxed);
+		rethrow_exception(exception);
+	}
+
+	// Calls function for the index ranges of the batch size in parallel and waits for them
+	// Function receives range begin and end indices. Scheduled ranges reference this stack frame,
+	// so all of them are finished before the first range exception is rethrown.
+	template<class Function>
+	void ParallelFor(size_t count, size_t batchSize, const Function& function)
+	{
+		if (batchSize == 0)
+			throw ArgumentOutOfRangeException("Parallel for batch size is zero");
+
+		if (count <= batchSize)
+		{
+			if (count > 0)
+				function(static_cast<size_t>(0), count);
+			return;
+		}
+
+		JobCounter counter;
+		auto functionPointer = &function;
+
+		// First batch is executed on the calling thread
+		for (auto begin = batchSize; begin < count; begin += batchSize)
+		{
+			auto end = min(begin + batchSize, count);
+			Schedule([functionPointer, begin, end]() { (*functionPointer)(begin, end); }, &counter);
+		}
+
+		try
+		{
+			function(static_cast<size_t>(0), batchSize);
+		}
+		catch (...)
+		{
+			WaitDone(counter);
+			throw;
+		}
+
+		Wait(counter);
+	}
+};
@@ -0,0 +1,155 @@
+
+// Copyright 2019 Nikita Fediuchin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+#include "Exceptions.hpp"
+
+#include <string>
+#include <cstdint>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+using namespace std;
+
+// Read only memory mapped file class
+class MappedFile
+{
+protected:
+#if defined(_WIN32)
+	// File handle
+	HANDLE file;
+	// File mapping handle (null if file is empty)
+	HANDLE mapping;
+#else
+	// File descriptor
+	int file;
+#endif
+
+	// Mapped file data (null if file is empty)
+	const uint8_t* data;
+	// File size in bytes
+	size_t size;
+
+public:
+	// Maps a new file into the memory (throws if file can not be opened)
+	MappedFile(const string& filePath)
+	{
+		data = nullptr;
+		size = 0;
+
+#if defined(_WIN32)
+		mapping = nullptr;
+		file = CreateFileA(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+
+		if (file == INVALID_HANDLE_VALUE)
+			throw IOException("Failed to open file. Path: " + filePath);
+
+		LARGE_INTEGER fileSize;
+
+		if (!GetFileSizeEx(file, &fileSize))
+		{
+			CloseHandle(file);
+			throw IOException("Failed to get file size. Path: " + filePath);
+		}
+
+		size = static_cast<size_t>(fileSize.QuadPart);
+
+		if (size == 0)
+			return;
+
+		mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+		if (mapping)
+			data = static_cast<const uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+
+		if (!data)
+		{
+			if (mapping)
+				CloseHandle(mapping);
+
+			CloseHandle(file);
+			throw IOException("Failed to map file. Path: " + filePath);
+		}
+#else
+		file = open(filePath.c_str(), O_RDONLY);
+
+		if (file < 0)
+			throw IOException("Failed to open file. Path: " + filePath);
+
+		struct stat fileStat;
+
+		if (fstat(file, &fileStat) != 0)
+		{
+			close(file);
+			throw IOException("Failed to get file size. Path: " + filePath);
+		}
+
+		size = static_cast<size_t>(fileStat.st_size);
+
+		if (size == 0)
+			return;
+
+		auto mappedData = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file, 0);
+
+		if (mappedData == MAP_FAILED)
+		{
+			close(file);
+			throw IOException("Failed to map file. Path: " + filePath);
+		}
+
+		// File is usually read once from the beginning to the end
+		madvise(mappedData, size, MADV_SEQUENTIAL);
+		data = static_cast<const uint8_t*>(mappedData);
+#endif
+	}
+	// Unmaps file from the memory
+	~MappedFile()
+	{
+#if defined(_WIN32)
+		if (data)
+			UnmapViewOfFile(data);
+		if (mapping)
+			CloseHandle(mapping);
+
+		CloseHandle(file);
+#else
+		if (data)
+			munmap(const_cast<uint8_t*>(data), size);
+
+		close(file);
+#endif
+	}
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	// Returns mapped file data (null if file is empty)
+	const uint8_t* GetData() { return data; }
+	// Returns file size in bytes
+	size_t GetSize() { return size; }
+};
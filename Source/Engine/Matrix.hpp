@@ -0,0 +1,258 @@
+
+// Copyright 2019 Nikita Fediuchin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define MATRIX_USE_SSE
+#include <xmmintrin.h>
+#endif
+
+#if defined(MATRIX_USE_SSE) && defined(__AVX__)
+#define MATRIX_USE_AVX
+#include <immintrin.h>
+#endif
+
+#include <cstddef>
+
+using namespace std;
+
+// Column major 4x4 float matrix (16 byte aligned for the SIMD loads)
+struct alignas(16) Matrix4
+{
+	// Matrix elements (column * 4 + row)
+	float m[16];
+
+	// Returns identity matrix
+	static Matrix4 Identity()
+	{
+		Matrix4 matrix = {};
+		matrix.m[0] = 1.0f;
+		matrix.m[5] = 1.0f;
+		matrix.m[10] = 1.0f;
+		matrix.m[15] = 1.0f;
+		return matrix;
+	}
+};
+
+// Multiplies matrices (result = a * b, result should not alias the arguments)
+inline void MultiplyMatrix(const Matrix4& a, const Matrix4& b, Matrix4& result)
+{
+#if defined(MATRIX_USE_SSE)
+	auto a0 = _mm_load_ps(a.m);
+	auto a1 = _mm_load_ps(a.m + 4);
+	auto a2 = _mm_load_ps(a.m + 8);
+	auto a3 = _mm_load_ps(a.m + 12);
+
+	for (int j = 0; j < 4; j++)
+	{
+		auto column = b.m + j * 4;
+		auto value = _mm_mul_ps(a0, _mm_set1_ps(column[0]));
+		value = _mm_add_ps(value, _mm_mul_ps(a1, _mm_set1_ps(column[1])));
+		value = _mm_add_ps(value, _mm_mul_ps(a2, _mm_set1_ps(column[2])));
+		value = _mm_add_ps(value, _mm_mul_ps(a3, _mm_set1_ps(column[3])));
+		_mm_store_ps(result.m + j * 4, value);
+	}
+#else
+	for (int j = 0; j < 4; j++)
+	{
+		for (int i = 0; i < 4; i++)
+		{
+			result.m[j * 4 + i] =
+				a.m[i] * b.m[j * 4] +
+				a.m[4 + i] * b.m[j * 4 + 1] +
+				a.m[8 + i] * b.m[j * 4 + 2] +
+				a.m[12 + i] * b.m[j * 4 + 3];
+		}
+	}
+#endif
+}
+
+#if defined(MATRIX_USE_AVX)
+// Matrix batch kernel lane count (one matrix per lane)
+const size_t MatrixBatchSize = 8;
+// Matrix batch kernel lane vector
+typedef __m256 MatrixLanes;
+#elif defined(MATRIX_USE_SSE)
+// Matrix batch kernel lane count (one matrix per lane)
+const size_t MatrixBatchSize = 4;
+// Matrix batch kernel lane vector
+typedef __m128 MatrixLanes;
+#else
+// Matrix batch kernel lane count (one matrix per lane)
+const size_t MatrixBatchSize = 1;
+// Matrix batch kernel lane vector
+typedef float MatrixLanes;
+#endif
+
+// Returns lanes filled with the value
+inline MatrixLanes SetLanes(float value)
+{
+#if defined(MATRIX_USE_AVX)
+	return _mm256_set1_ps(value);
+#elif defined(MATRIX_USE_SSE)
+	return _mm_set1_ps(value);
+#else
+	return value;
+#endif
+}
+// Returns lane sums
+inline MatrixLanes AddLanes(MatrixLanes a, MatrixLanes b)
+{
+#if defined(MATRIX_USE_AVX)
+	return _mm256_add_ps(a, b);
+#elif defined(MATRIX_USE_SSE)
+	return _mm_add_ps(a, b);
+#else
+	return a + b;
+#endif
+}
+// Returns lane differences
+inline MatrixLanes SubtractLanes(MatrixLanes a, MatrixLanes b)
+{
+#if defined(MATRIX_USE_AVX)
+	return _mm256_sub_ps(a, b);
+#elif defined(MATRIX_USE_SSE)
+	return _mm_sub_ps(a, b);
+#else
+	return a - b;
+#endif
+}
+// Returns lane products
+inline MatrixLanes MultiplyLanes(MatrixLanes a, MatrixLanes b)
+{
+#if defined(MATRIX_USE_AVX)
+	return _mm256_mul_ps(a, b);
+#elif defined(MATRIX_USE_SSE)
+	return _mm_mul_ps(a, b);
+#else
+	return a * b;
+#endif
+}
+#if defined(MATRIX_USE_SSE)
+// Transposes four transforms (position, rotation quaternion, scale floats) to the ten component vectors
+inline void LoadTransformQuad(const float* const transforms[4], __m128 values[10])
+{
+	auto a0 = _mm_loadu_ps(transforms[0]), a1 = _mm_loadu_ps(transforms[1]), a2 = _mm_loadu_ps(transforms[2]), a3 = _mm_loadu_ps(transforms[3]);
+	auto b0 = _mm_loadu_ps(transforms[0] + 4), b1 = _mm_loadu_ps(transforms[1] + 4), b2 = _mm_loadu_ps(transforms[2] + 4), b3 = _mm_loadu_ps(transforms[3] + 4);
+	auto c0 = _mm_loadu_ps(transforms[0] + 6), c1 = _mm_loadu_ps(transforms[1] + 6), c2 = _mm_loadu_ps(transforms[2] + 6), c3 = _mm_loadu_ps(transforms[3] + 6);
+
+	_MM_TRANSPOSE4_PS(a0, a1, a2, a3);
+	_MM_TRANSPOSE4_PS(b0, b1, b2, b3);
+	_MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+
+	values[0] = a0; values[1] = a1; values[2] = a2; values[3] = a3;
+	values[4] = b0; values[5] = b1; values[6] = b2; values[7] = b3;
+	values[8] = c2; values[9] = c3;
+}
+#endif
+
+// Loads batch transforms (position, rotation quaternion, scale floats) to the ten component lanes
+inline void LoadTransformLanes(const float* const transforms[MatrixBatchSize], MatrixLanes values[10])
+{
+#if defined(MATRIX_USE_AVX)
+	__m128 low[10], high[10];
+	LoadTransformQuad(transforms, low);
+	LoadTransformQuad(transforms + 4, high);
+
+	for (int i = 0; i < 10; i++)
+		values[i] = _mm256_insertf128_ps(_mm256_castps128_ps256(low[i]), high[i], 1);
+#elif defined(MATRIX_USE_SSE)
+	LoadTransformQuad(transforms, values);
+#else
+	for (int i = 0; i < 10; i++)
+		values[i] = transforms[0][i];
+#endif
+}
+// Stores lanes to the aligned lane count sized float array
+inline void StoreLanes(float* destination, MatrixLanes values)
+{
+#if defined(MATRIX_USE_AVX)
+	_mm256_store_ps(destination, values);
+#elif defined(MATRIX_USE_SSE)
+	_mm_store_ps(destination, values);
+#else
+	*destination = values;
+#endif
+}
+
+// Returns identity matrix (parent of the root batch lanes)
+inline const Matrix4& GetIdentityMatrix()
+{
+	static const Matrix4 identity = Matrix4::Identity();
+	return identity;
+}
+
+// Composes world matrices of the transform batch (world = parent * translation * rotation * scale)
+// Local matrices are composed across the lanes, then each parent multiply uses the parent columns directly,
+// so parent and world matrices are not transposed. Transforms are position, rotation quaternion and scale floats,
+// parents should be affine. Partial batches repeat their last element, repeated lanes store the same matrix again.
+inline void ComposeWorldMatrices(const float* const transforms[MatrixBatchSize], const Matrix4* const parents[MatrixBatchSize], Matrix4* const worlds[MatrixBatchSize])
+{
+	MatrixLanes transform[10];
+	LoadTransformLanes(transforms, transform);
+
+	auto x = transform[3], y = transform[4], z = transform[5], w = transform[6];
+	auto x2 = AddLanes(x, x), y2 = AddLanes(y, y), z2 = AddLanes(z, z);
+	auto xx = MultiplyLanes(x, x2), yy = MultiplyLanes(y, y2), zz = MultiplyLanes(z, z2);
+	auto xy = MultiplyLanes(x, y2), xz = MultiplyLanes(x, z2), yz = MultiplyLanes(y, z2);
+	auto wx = MultiplyLanes(w, x2), wy = MultiplyLanes(w, y2), wz = MultiplyLanes(w, z2);
+	auto one = SetLanes(1.0f);
+
+	// Local affine columns per lane (column * 3 + row, translation is the last column)
+	alignas(32) float locals[12][MatrixBatchSize];
+	StoreLanes(locals[0], MultiplyLanes(SubtractLanes(one, AddLanes(yy, zz)), transform[7]));
+	StoreLanes(locals[1], MultiplyLanes(AddLanes(xy, wz), transform[7]));
+	StoreLanes(locals[2], MultiplyLanes(SubtractLanes(xz, wy), transform[7]));
+	StoreLanes(locals[3], MultiplyLanes(SubtractLanes(xy, wz), transform[8]));
+	StoreLanes(locals[4], MultiplyLanes(SubtractLanes(one, AddLanes(xx, zz)), transform[8]));
+	StoreLanes(locals[5], MultiplyLanes(AddLanes(yz, wx), transform[8]));
+	StoreLanes(locals[6], MultiplyLanes(AddLanes(xz, wy), transform[9]));
+	StoreLanes(locals[7], MultiplyLanes(SubtractLanes(yz, wx), transform[9]));
+	StoreLanes(locals[8], MultiplyLanes(SubtractLanes(one, AddLanes(xx, yy)), transform[9]));
+	StoreLanes(locals[9], transform[0]);
+	StoreLanes(locals[10], transform[1]);
+	StoreLanes(locals[11], transform[2]);
+
+	for (size_t i = 0; i < MatrixBatchSize; i++)
+	{
+		auto parent = parents[i]->m;
+		auto world = worlds[i]->m;
+
+#if defined(MATRIX_USE_SSE)
+		auto p0 = _mm_load_ps(parent), p1 = _mm_load_ps(parent + 4), p2 = _mm_load_ps(parent + 8);
+
+		for (int j = 0; j < 4; j++)
+		{
+			auto value = j == 3 ? _mm_load_ps(parent + 12) : _mm_setzero_ps();
+			value = _mm_add_ps(value, _mm_mul_ps(p0, _mm_set1_ps(locals[j * 3][i])));
+			value = _mm_add_ps(value, _mm_mul_ps(p1, _mm_set1_ps(locals[j * 3 + 1][i])));
+			value = _mm_add_ps(value, _mm_mul_ps(p2, _mm_set1_ps(locals[j * 3 + 2][i])));
+			_mm_store_ps(world + j * 4, value);
+		}
+#else
+		for (int j = 0; j < 4; j++)
+		{
+			for (int k = 0; k < 4; k++)
+			{
+				world[j * 4 + k] = (j == 3 ? parent[12 + k] : 0.0f) +
+					parent[k] * locals[j * 3][i] +
+					parent[4 + k] * locals[j * 3 + 1][i] +
+					parent[8 + k] * locals[j * 3 + 2][i];
+			}
+		}
+#endif
+	}
+}
@@ -0,0 +1,126 @@
+
+// Copyright 2019 Nikita Fediuchin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+#include "Exceptions.hpp"
+#include "Engine/BuddyAllocator.hpp"
+
+#include <new>
+#include <vector>
+#include <cstdint>
+
+using namespace std;
+
+// Memory page size (slab backing alignment)
+const size_t PoolPageSize = 4096;
+
+// Fixed size block pool allocator class (not locked)
+// Blocks are carved from the large slabs by a pointer bump, freed blocks form an intrusive list.
+// Slabs are kept until the pool is destroyed, so the pool memory equals the peak usage.
+class PoolAllocator
+{
+protected:
+	// Block size in bytes
+	size_t blockSize;
+	// Block count per slab
+	size_t slabBlockCount;
+	// Slab and block alignment
+	size_t alignment;
+
+	// Slab memory array
+	vector<uint8_t*> slabs;
+	// First free block (next free block pointer is stored in the block)
+	void* freeHead;
+	// Next unused block in the last slab
+	uint8_t* bumpPointer;
+	// End of the last slab
+	uint8_t* bumpEnd;
+	// Allocated block count
+	size_t allocationCount;
+
+public:
+	// Creates a new pool allocator instance
+	PoolAllocator(size_t _blockSize, size_t _slabBlockCount, size_t _alignment)
+	{
+		if (!IsPowerOfTwo(_alignment))
+			throw ArgumentException("Pool allocator alignment should be power of two");
+		if (_blockSize < sizeof(void*) || _blockSize % _alignment != 0)
+			throw ArgumentException("Pool allocator block size should be aligned and fit a pointer");
+		if (_slabBlockCount == 0)
+			throw ArgumentOutOfRangeException("Pool allocator slab block count is zero");
+
+		blockSize = _blockSize;
+		slabBlockCount = _slabBlockCount;
+		alignment = _alignment;
+
+		freeHead = nullptr;
+		bumpPointer = nullptr;
+		bumpEnd = nullptr;
+		allocationCount = 0;
+	}
+	// Destroys pool allocator instance (frees all slabs, blocks should be already freed)
+	~PoolAllocator()
+	{
+		for (auto slab : slabs)
+			operator delete(slab, align_val_t(alignment));
+	}
+
+	PoolAllocator(const PoolAllocator&) = delete;
+	PoolAllocator& operator=(const PoolAllocator&) = delete;
+
+	// Returns block size in bytes
+	size_t GetBlockSize() { return blockSize; }
+	// Returns allocated block count
+	size_t GetAllocationCount() { return allocationCount; }
+	// Returns slab count
+	size_t GetSlabCount() { return slabs.size(); }
+	// Returns reserved memory size in bytes
+	size_t GetReservedSize() { return slabs.size() * slabBlockCount * blockSize; }
+
+	// Allocates a new block (reuses the last freed one if there is one)
+	void* Allocate()
+	{
+		void* block;
+
+		if (freeHead)
+		{
+			block = freeHead;
+			freeHead = *static_cast<void**>(freeHead);
+		}
+		else
+		{
+			if (bumpPointer == bumpEnd)
+			{
+				auto slab = static_cast<uint8_t*>(operator new(blockSize * slabBlockCount, align_val_t(alignment)));
+				slabs.push_back(slab);
+				bumpPointer = slab;
+				bumpEnd = slab + blockSize * slabBlockCount;
+			}
+
+			block = bumpPointer;
+			bumpPointer += blockSize;
+		}
+
+		allocationCount++;
+		return block;
+	}
+	// Frees block (it is reused by the next allocation)
+	void Free(void* block)
+	{
+		*static_cast<void**>(block) = freeHead;
+		freeHead = block;
+		allocationCount--;
+	}
+};
@@ -0,0 +1,194 @@
+
+// Copyright 2019 Nikita Fediuchin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+#include "Engine/Archetype.hpp"
+#include "Engine/Component.hpp"
+
+#include <atomic>
+#include <vector>
+#include <cstdint>
+
+using namespace std;
+
+// Entity query description (component type sets)
+struct QueryDescription
+{
+	// Components which entity should have
+	ComponentMask required;
+	// Components which entity should not have
+	ComponentMask excluded;
+	// Components which entity can have (accessed if present)
+	ComponentMask optional;
+	// Components which chunk should have changed since the last query iteration (empty to iterate all chunks)
+	ComponentMask changed;
+
+	// Adds required component type
+	template<class T>
+	QueryDescription& Require()
+	{
+		required.Set(GetComponentType<T>().id);
+		return *this;
+	}
+	// Adds excluded component type
+	template<class T>
+	QueryDescription& Exclude()
+	{
+		excluded.Set(GetComponentType<T>().id);
+		return *this;
+	}
+	// Adds optional component type
+	template<class T>
+	QueryDescription& Optional()
+	{
+		optional.Set(GetComponentType<T>().id);
+		return *this;
+	}
+
+	// Adds required component type which should be changed since the last query iteration
+	template<class T>
+	QueryDescription& Changed()
+	{
+		required.Set(GetComponentType<T>().id);
+		changed.Set(GetComponentType<T>().id);
+		return *this;
+	}
+
+	// Returns true if archetype matches the description
+	bool IsMatching(Archetype* archetype) const
+	{
+		return archetype->GetMask().Contains(required) && !archetype->GetMask().Intersects(excluded);
+	}
+};
+
+// Entity query chunk view (passed to the chunk iteration callback)
+struct QueryChunk
+{
+	// Chunk archetype
+	Archetype* archetype;
+	// Archetype chunk index
+	uint32_t chunkIndex;
+	// Chunk entity count
+	uint32_t count;
+	// Query iteration change version
+	uint64_t version;
+
+	// Returns chunk entity index array
+	uint32_t* GetEntityIndices()
+	{
+		return archetype->GetEntities(chunkIndex);
+	}
+	// Returns mutable chunk component array and marks it as changed (null if optional component is not present)
+	template<class T>
+	T* Get()
+	{
+		size_t typeIndex;
+
+		if (!archetype->FindType(GetComponentType<T>().id, typeIndex))
+			return nullptr;
+
+		archetype->SetChunkVersion(chunkIndex, typeIndex, version);
+		return reinterpret_cast<T*>(archetype->GetColumn(chunkIndex, typeIndex));
+	}
+	// Returns read only chunk component array (null if optional component is not present)
+	template<class T>
+	const T* GetConst()
+	{
+		size_t typeIndex;
+
+		if (!archetype->FindType(GetComponentType<T>().id, typeIndex))
+			return nullptr;
+
+		return reinterpret_cast<const T*>(archetype->GetColumn(chunkIndex, typeIndex));
+	}
+};
+
+// Cached entity query class (matching archetypes are added when they are created)
+// Each iteration takes a new system change version, so a query should be iterated by one task only
+class Query
+{
+protected:
+	// Query description
+	QueryDescription description;
+	// Matching archetype array
+	vector<Archetype*> archetypes;
+	// System change version counter
+	atomic<uint64_t>* systemVersion;
+	// Change version of the last iteration (zero if query was never iterated)
+	uint64_t lastVersion;
+
+public:
+	// Creates a new query instance
+	Query(const QueryDescription& _description, atomic<uint64_t>* _systemVersion)
+	{
+		description = _description;
+		systemVersion = _systemVersion;
+		lastVersion = 0;
+	}
+
+	// Returns query description
+	const QueryDescription& GetDescription() { return description; }
+	// Returns matching archetype array
+	const vector<Archetype*>& GetArchetypes() { return archetypes; }
+	// Returns change version of the last iteration
+	uint64_t GetLastVersion() { return lastVersion; }
+
+	// Adds archetype to the cache if it is matching (called by the system on archetype creation)
+	void OnArchetypeCreate(Archetype* archetype)
+	{
+		if (description.IsMatching(archetype))
+			archetypes.push_back(archetype);
+	}
+
+	// Returns matching entity count
+	size_t GetEntityCount()
+	{
+		size_t count = 0;
+
+		for (auto archetype : archetypes)
+			count += archetype->GetEntityCount();
+
+		return count;
+	}
+
+	// Calls function for each matching non empty chunk (function receives QueryChunk&)
+	// If description has changed components, chunks without changes since the last iteration are skipped
+	template<class Function>
+	void ForEachChunk(Function function)
+	{
+		auto version = ++(*systemVersion);
+		auto previousVersion = lastVersion;
+		auto isFiltered = description.changed != ComponentMask();
+		lastVersion = version;
+
+		for (auto archetype : archetypes)
+		{
+			auto chunkCount = archetype->GetChunkCount();
+
+			for (uint32_t i = 0; i < chunkCount; i++)
+			{
+				if (isFiltered && !archetype->IsChunkChanged(i, description.changed, previousVersion))
+					continue;
+
+				QueryChunk chunk = {};
+				chunk.archetype = archetype;
+				chunk.chunkIndex = i;
+				chunk.count = archetype->GetChunkEntityCount(i);
+				chunk.version = version;
+				function(chunk);
+			}
+		}
+	}
+};
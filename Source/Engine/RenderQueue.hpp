@@ -0,0 +1,220 @@
+
+// Copyright 2019 Nikita Fediuchin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+#include "Exceptions.hpp"
+
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <cstdint>
+#include <condition_variable>
+
+using namespace std;
+
+// Render queue spin iteration count before the waiting thread sleeps
+const uint32_t RenderQueueSpinCount = 256;
+
+// Immutable per-frame render data (produced by the simulation, consumed by the render thread)
+struct RenderPacket
+{
+	// Frame sequence number
+	uint64_t frameIndex;
+	// Time when frame input was polled (input to submit latency origin)
+	chrono::high_resolution_clock::time_point inputTime;
+	// Previous frame duration in seconds
+	double frameTime;
+	// Simulated fixed tick count (zero if loop has no fixed timestep)
+	uint64_t tickCount;
+	// Interpolation factor between the previous and the current tick states [0, 1)
+	float interpolationAlpha;
+	// Window framebuffer width in pixels
+	uint32_t framebufferWidth;
+	// Window framebuffer height in pixels
+	uint32_t framebufferHeight;
+	// Frame clear color (RGBA)
+	float clearColor[4];
+	// Is frame read back and passed to the frame encoder (if capture is enabled)
+	bool isCaptured;
+};
+
+// Bounded single producer single consumer render packet queue class
+// Push and pop are lock free, mutex is used only to sleep on the full or empty queue.
+class RenderQueue
+{
+protected:
+	// Next pop position (consumer side)
+	alignas(64) atomic<uint64_t> head;
+	// Last tail position seen by the consumer
+	uint64_t cachedTail;
+	// Next push position (producer side)
+	alignas(64) atomic<uint64_t> tail;
+	// Last head position seen by the producer
+	uint64_t cachedHead;
+
+	// Circular packet buffer
+	alignas(64) RenderPacket* packets;
+	// Packet buffer capacity (power of two)
+	uint64_t capacity;
+
+	// Is queue closed (no more packets will be pushed or popped)
+	atomic<bool> isClosed;
+	// Sleeping thread count (producer and consumer)
+	atomic<uint32_t> sleepingCount;
+	// Sleep mutex
+	mutex sleepMutex;
+	// Sleep condition variable
+	condition_variable sleepCondition;
+
+	// Wakes the other side if it is sleeping
+	void Notify()
+	{
+		// Fence orders the position store before the sleeping count load,
+		// lock pairs with the sleeping thread predicate check, so the wake up is not lost
+		atomic_thread_fence(memory_order_seq_cst);
+
+		if (sleepingCount.load(memory_order_relaxed) > 0)
+		{
+			{
+				lock_guard<mutex> lock(sleepMutex);
+			}
+
+			sleepCondition.notify_all();
+		}
+	}
+	// Spins and then sleeps until the condition is true
+	template<class Condition>
+	void WaitFor(const Condition& condition)
+	{
+		for (uint32_t i = 0; i < RenderQueueSpinCount; i++)
+		{
+			if (condition())
+				return;
+
+			this_thread::yield();
+		}
+
+		unique_lock<mutex> lock(sleepMutex);
+		sleepingCount.fetch_add(1);
+		sleepCondition.wait(lock, condition);
+		sleepingCount.fetch_sub(1);
+	}
+
+public:
+	// Creates a new render queue instance
+	RenderQueue(uint64_t _capacity)
+	{
+		if (_capacity == 0 || (_capacity & (_capacity - 1)) != 0)
+			throw ArgumentException("Render queue capacity should be power of two");
+
+		head = 0;
+		cachedTail = 0;
+		tail = 0;
+		cachedHead = 0;
+		capacity = _capacity;
+		packets = new RenderPacket[_capacity];
+		isClosed = false;
+		sleepingCount = 0;
+	}
+	// Destroys render queue instance
+	~RenderQueue()
+	{
+		delete[] packets;
+	}
+
+	RenderQueue(const RenderQueue&) = delete;
+	RenderQueue& operator=(const RenderQueue&) = delete;
+
+	// Returns packet buffer capacity
+	uint64_t GetCapacity() { return capacity; }
+	// Returns true if queue is closed
+	bool IsClosed() { return isClosed.load(memory_order_acquire); }
+
+	// Pushes a new packet, returns false if queue is full (producer thread only)
+	bool TryPush(const RenderPacket& packet)
+	{
+		auto position = tail.load(memory_order_relaxed);
+
+		if (position - cachedHead >= capacity)
+		{
+			cachedHead = head.load(memory_order_acquire);
+
+			if (position - cachedHead >= capacity)
+				return false;
+		}
+
+		packets[position & (capacity - 1)] = packet;
+		tail.store(position + 1, memory_order_release);
+		Notify();
+		return true;
+	}
+	// Pops next packet, returns false if queue is empty (consumer thread only)
+	bool TryPop(RenderPacket& packet)
+	{
+		auto position = head.load(memory_order_relaxed);
+
+		if (position == cachedTail)
+		{
+			cachedTail = tail.load(memory_order_acquire);
+
+			if (position == cachedTail)
+				return false;
+		}
+
+		packet = packets[position & (capacity - 1)];
+		head.store(position + 1, memory_order_release);
+		Notify();
+		return true;
+	}
+
+	// Pushes a new packet, waits while queue is full, returns false if queue is closed (producer thread only)
+	bool Push(const RenderPacket& packet)
+	{
+		while (!TryPush(packet))
+		{
+			if (IsClosed())
+				return false;
+
+			WaitFor([this]() { return IsClosed() || tail.load(memory_order_relaxed) - head.load(memory_order_acquire) < capacity; });
+		}
+
+		return !IsClosed();
+	}
+	// Pops next packet, waits while queue is empty, returns false if queue is closed (consumer thread only)
+	bool Pop(RenderPacket& packet)
+	{
+		while (!TryPop(packet))
+		{
+			if (IsClosed())
+				return false;
+
+			WaitFor([this]() { return IsClosed() || head.load(memory_order_relaxed) != tail.load(memory_order_acquire); });
+		}
+
+		return !IsClosed();
+	}
+
+	// Closes queue and wakes waiting threads (pending packets are dropped)
+	void Close()
+	{
+		{
+			lock_guard<mutex> lock(sleepMutex);
+			isClosed = true;
+		}
+
+		sleepCondition.notify_all();
+	}
+};
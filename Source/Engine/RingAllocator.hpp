@@ -0,0 +1,95 @@
+
+// Copyright 2019 Nikita Fediuchin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+#include "Exceptions.hpp"
+
+#include <cstdint>
+
+using namespace std;
+
+// Ring range allocator class (manages offsets only, no memory is owned)
+// Positions grow monotonically, so the range is released in the allocation order by position
+class RingAllocator
+{
+protected:
+	// Managed range size
+	uint64_t size;
+	// Next allocation position
+	uint64_t head;
+	// Oldest not released position
+	uint64_t tail;
+
+public:
+	// Creates a new ring allocator instance
+	RingAllocator(uint64_t _size)
+	{
+		if (_size == 0)
+			throw ArgumentOutOfRangeException("Ring allocator size can not be zero");
+
+		size = _size;
+		head = 0;
+		tail = 0;
+	}
+
+	// Returns managed range size
+	uint64_t GetSize() { return size; }
+	// Returns allocated size (including alignment and wrap gaps)
+	uint64_t GetUsedSize() { return head - tail; }
+	// Returns current head position (release it when all earlier allocations are no longer used)
+	uint64_t GetHead() { return head; }
+
+	// Allocates a new contiguous range, returns false if there is not enough free space
+	bool Allocate(uint64_t requestSize, uint64_t alignment, uint64_t& offset)
+	{
+		if (requestSize == 0 || requestSize > size || alignment == 0)
+			return false;
+
+		// Empty ring starts from the beginning, so any fitting range can be allocated
+		if (head == tail && head % size != 0)
+		{
+			head += size - head % size;
+			tail = head;
+		}
+
+		auto headOffset = head % size;
+		auto alignedOffset = (headOffset + alignment - 1) / alignment * alignment;
+		auto position = head + (alignedOffset - headOffset);
+
+		// Range can not be split, skip the end of the ring
+		if (alignedOffset + requestSize > size)
+		{
+			position = head + (size - headOffset);
+			alignedOffset = 0;
+		}
+
+		if (position + requestSize - tail > size)
+			return false;
+
+		head = position + requestSize;
+		offset = alignedOffset;
+		return true;
+	}
+
+	// Releases all ranges allocated before the position (already released positions are ignored)
+	void Release(uint64_t position)
+	{
+		if (position > head)
+			throw ArgumentOutOfRangeException("Ring allocator position is out of range");
+
+		if (position > tail)
+			tail = position;
+	}
+};
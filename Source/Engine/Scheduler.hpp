@@ -0,0 +1,306 @@
+
+// Copyright 2019 Nikita Fediuchin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+#include "Exceptions.hpp"
+#include "Engine/System.hpp"
+#include "Engine/EntityCommandBuffer.hpp"
+#include "Engine/JobSystem.hpp"
+
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <exception>
+#include <functional>
+
+using namespace std;
+
+// System task description (function with declared component access)
+struct SystemTask
+{
+	// Task name (for the statistics)
+	string name;
+	// Task execution function (structural changes are recorded into the task command buffer)
+	function<void(System&, EntityCommandBuffer&)> execute;
+	// Components which task reads
+	ComponentMask reads;
+	// Components which task writes
+	ComponentMask writes;
+	// Is task changing system structure (runs alone, ordered with every other task)
+	bool isExclusive = false;
+
+	// Adds read component type
+	template<class T>
+	SystemTask& Read()
+	{
+		reads.Set(GetComponentType<T>().id);
+		return *this;
+	}
+	// Adds written component type
+	template<class T>
+	SystemTask& Write()
+	{
+		writes.Set(GetComponentType<T>().id);
+		return *this;
+	}
+
+	// Returns true if tasks can not run concurrently
+	bool IsConflicting(const SystemTask& other) const
+	{
+		return isExclusive || other.isExclusive ||
+			writes.Intersects(other.writes) ||
+			writes.Intersects(other.reads) ||
+			reads.Intersects(other.writes);
+	}
+};
+
+// System task run statistics
+struct SystemTaskStats
+{
+	// Task execution time in seconds
+	double time;
+	// Task start time in seconds (since the run start)
+	double startTime;
+	// Task thread index (zero is the calling thread)
+	size_t threadIndex;
+	// Is task on the critical path
+	bool isCritical;
+};
+
+// Parallel system task scheduler class
+// Each run builds the dependency graph: conflicting tasks are ordered by their add order, others run concurrently.
+// Tasks are job system jobs, finished task schedules its ready dependents.
+class Scheduler
+{
+protected:
+	// Job system (calling thread executes tasks too)
+	JobSystem* jobSystem;
+	// System task array
+	vector<SystemTask> tasks;
+	// Entity command buffer array per task (played back in the task add order after the run)
+	vector<EntityCommandBuffer*> commandBuffers;
+
+	// Dependent task index array per task
+	vector<vector<size_t>> dependents;
+	// Dependency task index array per task
+	vector<vector<size_t>> dependencies;
+	// Unfinished dependency count per task
+	vector<atomic<size_t>> dependencyCounts;
+	// Running task job counter
+	JobCounter taskCounter;
+	// First task exception
+	exception_ptr taskException;
+	// Task exception mutex
+	mutex exceptionMutex;
+
+	// Task statistics array (of the last run)
+	vector<SystemTaskStats> taskStats;
+	// Critical path task index array (of the last run)
+	vector<size_t> criticalPath;
+	// Critical path time in seconds (of the last run)
+	double criticalPathTime;
+	// Last run time in seconds
+	double runTime;
+
+	// Builds task dependency graph
+	void BuildGraph()
+	{
+		auto count = tasks.size();
+		dependents.assign(count, {});
+		dependencies.assign(count, {});
+		dependencyCounts = vector<atomic<size_t>>(count);
+
+		for (auto& dependencyCount : dependencyCounts)
+			dependencyCount = 0;
+
+		for (size_t j = 0; j < count; j++)
+		{
+			for (size_t i = 0; i < j; i++)
+			{
+				if (!tasks[i].IsConflicting(tasks[j]))
+					continue;
+
+				dependents[i].push_back(j);
+				dependencies[j].push_back(i);
+				dependencyCounts[j]++;
+			}
+		}
+	}
+	// Schedules task job
+	void ScheduleTask(System& system, size_t index, chrono::high_resolution_clock::time_point runStartTime)
+	{
+		auto systemPointer = &system;
+
+		jobSystem->Schedule([this, systemPointer, index, runStartTime]()
+		{
+			ExecuteTask(*systemPointer, index, runStartTime);
+		}, &taskCounter);
+	}
+	// Executes task and schedules its dependents which became ready
+	void ExecuteTask(System& system, size_t index, chrono::high_resolution_clock::time_point runStartTime)
+	{
+		auto startTime = chrono::high_resolution_clock::now();
+
+		try
+		{
+			tasks[index].execute(system, *commandBuffers[index]);
+		}
+		catch (...)
+		{
+			lock_guard<mutex> lock(exceptionMutex);
+
+			if (!taskException)
+				taskException = current_exception();
+		}
+
+		auto endTime = chrono::high_resolution_clock::now();
+
+		auto& stats = taskStats[index];
+		stats.time = chrono::duration<double>(endTime - startTime).count();
+		stats.startTime = chrono::duration<double>(startTime - runStartTime).count();
+		stats.threadIndex = jobSystem->GetCurrentThreadIndex();
+
+		for (auto dependent : dependents[index])
+		{
+			if (dependencyCounts[dependent].fetch_sub(1) == 1)
+				ScheduleTask(system, dependent, runStartTime);
+		}
+	}
+	// Finds the longest dependency chain by the measured task times
+	void UpdateCriticalPath()
+	{
+		auto count = tasks.size();
+		vector<double> finishTimes(count);
+		vector<size_t> previous(count, SIZE_MAX);
+
+		criticalPath.clear();
+		criticalPathTime = 0.0;
+
+		if (count == 0)
+			return;
+
+		size_t last = 0;
+
+		// Dependencies always have lower indices, so add order is a topological order
+		for (size_t i = 0; i < count; i++)
+		{
+			auto startTime = 0.0;
+
+			for (auto dependency : dependencies[i])
+			{
+				if (finishTimes[dependency] > startTime)
+				{
+					startTime = finishTimes[dependency];
+					previous[i] = dependency;
+				}
+			}
+
+			finishTimes[i] = startTime + taskStats[i].time;
+			taskStats[i].isCritical = false;
+
+			if (finishTimes[i] > finishTimes[last])
+				last = i;
+		}
+
+		criticalPathTime = finishTimes[last];
+
+		for (auto i = last; i != SIZE_MAX; i = previous[i])
+		{
+			criticalPath.insert(criticalPath.begin(), i);
+			taskStats[i].isCritical = true;
+		}
+	}
+
+public:
+	// Creates a new scheduler instance (job system is not owned)
+	Scheduler(JobSystem* _jobSystem)
+	{
+		if (!_jobSystem)
+			throw ArgumentNullException("Scheduler job system is null");
+
+		jobSystem = _jobSystem;
+		criticalPathTime = 0.0;
+		runTime = 0.0;
+	}
+	// Destroys scheduler instance
+	~Scheduler()
+	{
+		for (auto commandBuffer : commandBuffers)
+			delete commandBuffer;
+	}
+
+	// Returns system task count
+	size_t GetTaskCount() { return tasks.size(); }
+	// Returns system task
+	const SystemTask& GetTask(size_t index) { return tasks.at(index); }
+	// Returns task statistics of the last run
+	const vector<SystemTaskStats>& GetTaskStats() { return taskStats; }
+	// Returns critical path task index array of the last run
+	const vector<size_t>& GetCriticalPath() { return criticalPath; }
+	// Returns critical path time in seconds of the last run (lower bound of the run time)
+	double GetCriticalPathTime() { return criticalPathTime; }
+	// Returns last run time in seconds
+	double GetRunTime() { return runTime; }
+
+	// Adds a new system task, returns its index
+	size_t Add(const SystemTask& task)
+	{
+		if (!task.execute)
+			throw ArgumentNullException("System task function is null");
+
+		tasks.push_back(task);
+		commandBuffers.push_back(new EntityCommandBuffer());
+		return tasks.size() - 1;
+	}
+
+	// Runs all tasks once and waits for them, then plays back task command buffers (rethrows the first task exception)
+	// Playback order does not depend on the thread timing, so structural changes are deterministic
+	void Run(System& system)
+	{
+		auto runStartTime = chrono::high_resolution_clock::now();
+
+		BuildGraph();
+		taskStats.assign(tasks.size(), {});
+		taskException = nullptr;
+
+		for (size_t i = 0; i < tasks.size(); i++)
+		{
+			if (dependencyCounts[i] == 0)
+				ScheduleTask(system, i, runStartTime);
+		}
+
+		jobSystem->Wait(taskCounter);
+
+		if (taskException)
+		{
+			// Failed run does not apply partially recorded structural changes
+			for (auto commandBuffer : commandBuffers)
+				commandBuffer->Clear();
+		}
+		else
+		{
+			for (auto commandBuffer : commandBuffers)
+				commandBuffer->Playback(system);
+		}
+
+		runTime = chrono::duration<double>(chrono::high_resolution_clock::now() - runStartTime).count();
+		UpdateCriticalPath();
+
+		if (taskException)
+			rethrow_exception(taskException);
+	}
+};
@@ -0,0 +1,438 @@
+
+// Copyright 2019 Nikita Fediuchin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+#include "Exceptions.hpp"
+#include "Engine/System.hpp"
+#include "Engine/MappedFile.hpp"
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <filesystem>
+
+using namespace std;
+
+// Snapshot file magic number ("IJSN")
+const uint32_t SnapshotMagic = 0x4E534A49;
+// Snapshot file format version
+const uint32_t SnapshotFormatVersion = 2;
+// Snapshot blob alignment in bytes
+const size_t SnapshotAlignment = 16;
+
+// Snapshot file header
+struct SnapshotHeader
+{
+	// Magic number
+	uint32_t magic;
+	// Format version
+	uint32_t version;
+	// Component type count
+	uint32_t typeCount;
+	// Archetype count
+	uint32_t archetypeCount;
+	// Entity slot count
+	uint32_t slotCount;
+	// First free entity slot index
+	uint32_t freeHead;
+	// Alive entity count
+	uint64_t entityCount;
+};
+
+// Snapshot component type record
+struct SnapshotType
+{
+	// Component type name hash
+	uint64_t nameHash;
+	// Component size in bytes
+	uint32_t size;
+	// Component alignment in bytes
+	uint32_t alignment;
+};
+
+// Snapshot entity slot record
+struct SnapshotSlot
+{
+	// Slot generation
+	uint32_t generation;
+	// Next free slot index
+	uint32_t nextFree;
+};
+
+// Snapshot archetype record (followed by the snapshot type indices)
+struct SnapshotArchetype
+{
+	// Component type count
+	uint32_t typeCount;
+	// Chunk count
+	uint32_t chunkCount;
+};
+
+// Snapshot chunk record (followed by the entity index array and component arrays)
+struct SnapshotChunk
+{
+	// Chunk entity count
+	uint32_t count;
+	// Explicit padding (always zero)
+	uint32_t padding[3];
+};
+
+// Entity system binary snapshot class
+// Component arrays are stored as raw aligned blobs, so loading is a file mapping and one copy per array.
+// Only trivially copyable components can be stored, types are matched by the declared name hash.
+class Snapshot
+{
+protected:
+	// Snapshot chunk view (arrays point into the mapped file)
+	struct ChunkView
+	{
+		// Chunk entity count
+		uint32_t count;
+		// Entity index array
+		const uint32_t* entities;
+		// Component array per archetype type
+		vector<const uint8_t*> columns;
+	};
+	// Snapshot archetype view
+	struct ArchetypeView
+	{
+		// Component type array
+		vector<const ComponentType*> types;
+		// Chunk view array
+		vector<ChunkView> chunks;
+	};
+
+	// Bounds checked snapshot data reader
+	struct Reader
+	{
+		// Snapshot data
+		const uint8_t* data;
+		// Snapshot data size
+		size_t size;
+		// Current read offset
+		size_t offset;
+
+		// Returns pointer to the next bytes and skips them
+		const uint8_t* Read(size_t count)
+		{
+			if (count > size - offset)
+				throw IOException("Snapshot file is truncated");
+
+			auto result = data + offset;
+			offset += count;
+			return result;
+		}
+		// Reads next record
+		template<class T>
+		T Read()
+		{
+			T value;
+			memcpy(&value, Read(sizeof(T)), sizeof(T));
+			return value;
+		}
+		// Skips padding to the blob alignment
+		void Align()
+		{
+			Read((SnapshotAlignment - offset % SnapshotAlignment) % SnapshotAlignment);
+		}
+	};
+
+	// Writes bytes to the snapshot file
+	static void Write(ofstream& file, uint64_t& offset, const void* data, size_t size)
+	{
+		file.write(static_cast<const char*>(data), size);
+		offset += size;
+	}
+	// Writes zero padding to the blob alignment
+	static void Align(ofstream& file, uint64_t& offset)
+	{
+		const char padding[SnapshotAlignment] = {};
+		Write(file, offset, padding, static_cast<size_t>((SnapshotAlignment - offset % SnapshotAlignment) % SnapshotAlignment));
+	}
+
+public:
+	// Writes system entities to the snapshot file (replaces existing file only if write succeeded)
+	static void Save(System& system, const string& filePath)
+	{
+		vector<Archetype*> archetypes;
+		vector<const ComponentType*> types;
+		uint32_t typeIndices[MaxComponentTypeCount];
+		ComponentMask typeMask = {};
+
+		for (auto archetype : system.archetypes)
+		{
+			if (archetype->GetEntityCount() == 0)
+				continue;
+
+			for (auto type : archetype->GetTypes())
+			{
+				if (!type->isTriviallyCopyable)
+					throw ArgumentException("Snapshot component type is not trivially copyable. Type: " + string(type->name));
+
+				if (!typeMask.Test(type->id))
+				{
+					typeMask.Set(type->id);
+					typeIndices[type->id] = static_cast<uint32_t>(types.size());
+					types.push_back(type);
+				}
+			}
+
+			archetypes.push_back(archetype);
+		}
+
+		auto tempFilePath = filePath + ".tmp";
+
+		{
+			ofstream file(tempFilePath, ios::binary | ios::trunc);
+
+			if (!file.is_open())
+				throw IOException("Failed to open snapshot file. Path: " + tempFilePath);
+
+			uint64_t offset = 0;
+
+			SnapshotHeader header = {};
+			header.magic = SnapshotMagic;
+			header.version = SnapshotFormatVersion;
+			header.typeCount = static_cast<uint32_t>(types.size());
+			header.archetypeCount = static_cast<uint32_t>(archetypes.size());
+			header.slotCount = static_cast<uint32_t>(system.entities.size());
+			header.freeHead = system.freeHead;
+			header.entityCount = system.entityCount;
+			Write(file, offset, &header, sizeof(SnapshotHeader));
+
+			for (auto type : types)
+			{
+				SnapshotType snapshotType = {};
+				snapshotType.nameHash = type->nameHash;
+				snapshotType.size = static_cast<uint32_t>(type->size);
+				snapshotType.alignment = static_cast<uint32_t>(type->alignment);
+				Write(file, offset, &snapshotType, sizeof(SnapshotType));
+			}
+
+			vector<SnapshotSlot> slots(system.entities.size());
+
+			for (size_t i = 0; i < slots.size(); i++)
+			{
+				slots[i].generation = system.entities[i].generation;
+				slots[i].nextFree = system.entities[i].nextFree;
+			}
+
+			Write(file, offset, slots.data(), slots.size() * sizeof(SnapshotSlot));
+			Align(file, offset);
+
+			for (auto archetype : archetypes)
+			{
+				auto& archetypeTypes = archetype->GetTypes();
+
+				SnapshotArchetype snapshotArchetype = {};
+				snapshotArchetype.typeCount = static_cast<uint32_t>(archetypeTypes.size());
+				snapshotArchetype.chunkCount = archetype->GetChunkCount();
+				Write(file, offset, &snapshotArchetype, sizeof(SnapshotArchetype));
+
+				for (auto type : archetypeTypes)
+					Write(file, offset, &typeIndices[type->id], sizeof(uint32_t));
+
+				Align(file, offset);
+
+				for (uint32_t i = 0; i < snapshotArchetype.chunkCount; i++)
+				{
+					SnapshotChunk chunk = {};
+					chunk.count = archetype->GetChunkEntityCount(i);
+					Write(file, offset, &chunk, sizeof(SnapshotChunk));
+
+					Write(file, offset, archetype->GetEntities(i), chunk.count * sizeof(uint32_t));
+					Align(file, offset);
+
+					for (size_t j = 0; j < archetypeTypes.size(); j++)
+					{
+						Write(file, offset, archetype->GetColumn(i, j), chunk.count * archetypeTypes[j]->size);
+						Align(file, offset);
+					}
+				}
+			}
+
+			if (!file)
+				throw IOException("Failed to write snapshot file. Path: " + tempFilePath);
+		}
+
+		error_code errorCode;
+		filesystem::rename(tempFilePath, filePath, errorCode);
+
+		if (errorCode)
+			throw IOException("Failed to rename snapshot file. Path: " + filePath);
+	}
+
+	// Reads system entities from the snapshot file (system should not have alive entities)
+	// Snapshot is validated before the system is changed, entity handles stay valid between save and load
+	static void Load(System& system, const string& filePath)
+	{
+		if (system.entityCount != 0)
+			throw ArgumentException("Snapshot can be loaded only into the system without entities");
+
+		MappedFile file(filePath);
+		Reader reader = { file.GetData(), file.GetSize(), 0 };
+
+		auto header = reader.Read<SnapshotHeader>();
+
+		if (header.magic != SnapshotMagic || header.version != SnapshotFormatVersion)
+			throw IOException("Invalid snapshot file header. Path: " + filePath);
+		if (header.slotCount == InvalidEntityIndex)
+			throw IOException("Invalid snapshot entity slot count. Path: " + filePath);
+
+		vector<const ComponentType*> types(header.typeCount);
+
+		for (auto& type : types)
+		{
+			auto snapshotType = reader.Read<SnapshotType>();
+			type = FindComponentType(snapshotType.nameHash);
+
+			if (!type)
+				throw ArgumentException("Snapshot component type is not registered");
+			if (type->size != snapshotType.size || type->alignment != snapshotType.alignment || !type->isTriviallyCopyable)
+				throw ArgumentException("Snapshot component type layout is changed. Type: " + string(type->name));
+		}
+
+		auto slots = reader.Read(static_cast<size_t>(header.slotCount) * sizeof(SnapshotSlot));
+		reader.Align();
+
+		vector<ArchetypeView> archetypes(header.archetypeCount);
+		// Is slot taken by an entity or the free list
+		vector<uint8_t> isLocated(header.slotCount, 0);
+		uint64_t entityCount = 0;
+
+		for (auto& archetype : archetypes)
+		{
+			auto snapshotArchetype = reader.Read<SnapshotArchetype>();
+			ComponentMask typeMask = {};
+
+			for (uint32_t i = 0; i < snapshotArchetype.typeCount; i++)
+			{
+				auto typeIndex = reader.Read<uint32_t>();
+
+				if (typeIndex >= types.size() || typeMask.Test(types[typeIndex]->id))
+					throw IOException("Invalid snapshot archetype type. Path: " + filePath);
+
+				typeMask.Set(types[typeIndex]->id);
+				archetype.types.push_back(types[typeIndex]);
+			}
+
+			reader.Align();
+			archetype.chunks.resize(snapshotArchetype.chunkCount);
+
+			for (auto& chunk : archetype.chunks)
+			{
+				chunk.count = reader.Read<SnapshotChunk>().count;
+				chunk.entities = reinterpret_cast<const uint32_t*>(reader.Read(chunk.count * sizeof(uint32_t)));
+				reader.Align();
+
+				for (uint32_t i = 0; i < chunk.count; i++)
+				{
+					auto entity = chunk.entities[i];
+
+					if (entity >= header.slotCount || isLocated[entity])
+						throw IOException("Invalid snapshot entity index. Path: " + filePath);
+
+					isLocated[entity] = 1;
+				}
+
+				for (auto type : archetype.types)
+				{
+					chunk.columns.push_back(reader.Read(chunk.count * type->size));
+					reader.Align();
+				}
+
+				entityCount += chunk.count;
+			}
+		}
+
+		if (entityCount != header.entityCount)
+			throw IOException("Invalid snapshot entity count. Path: " + filePath);
+
+		// Free list should visit every slot without an entity exactly once, otherwise add would reuse a live slot
+		uint64_t freeCount = 0;
+
+		for (auto index = header.freeHead; index != InvalidEntityIndex; freeCount++)
+		{
+			if (index >= header.slotCount || isLocated[index])
+				throw IOException("Invalid snapshot entity free list. Path: " + filePath);
+
+			isLocated[index] = 1;
+
+			SnapshotSlot slot;
+			memcpy(&slot, slots + index * sizeof(SnapshotSlot), sizeof(SnapshotSlot));
+			index = slot.nextFree;
+		}
+
+		if (entityCount + freeCount != header.slotCount)
+			throw IOException("Invalid snapshot entity free list. Path: " + filePath);
+
+		system.entities.resize(header.slotCount);
+
+		for (uint32_t i = 0; i < header.slotCount; i++)
+		{
+			SnapshotSlot slot;
+			memcpy(&slot, slots + i * sizeof(SnapshotSlot), sizeof(SnapshotSlot));
+
+			auto& record = system.entities[i];
+			record.location = {};
+			record.generation = slot.generation;
+			record.nextFree = slot.nextFree;
+		}
+
+		system.freeHead = header.freeHead;
+		system.entityCount = static_cast<size_t>(header.entityCount);
+		system.structureVersion++;
+
+		auto version = system.GetWriteVersion();
+
+		for (auto& archetypeView : archetypes)
+		{
+			auto archetype = system.GetArchetype(archetypeView.types);
+			vector<size_t> typeIndices;
+
+			for (auto type : archetypeView.types)
+				typeIndices.push_back(archetype->GetTypeIndex(type->id));
+
+			for (auto& chunk : archetypeView.chunks)
+			{
+				uint32_t offset = 0;
+
+				while (offset < chunk.count)
+				{
+					uint32_t chunkIndex, rowIndex;
+					auto rowCount = archetype->AllocateRows(chunk.entities + offset, chunk.count - offset, chunkIndex, rowIndex, version);
+
+					for (size_t i = 0; i < typeIndices.size(); i++)
+					{
+						auto size = archetypeView.types[i]->size;
+						memcpy(archetype->GetComponent(chunkIndex, rowIndex, typeIndices[i]), chunk.columns[i] + offset * size, rowCount * size);
+					}
+
+					for (uint32_t i = 0; i < rowCount; i++)
+					{
+						auto& location = system.entities[chunk.entities[offset + i]].location;
+						location.archetype = archetype;
+						location.chunkIndex = chunkIndex;
+						location.rowIndex = rowIndex + i;
+					}
+
+					offset += rowCount;
+				}
+			}
+		}
+	}
+};
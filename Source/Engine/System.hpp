@@ -14,88 +14,364 @@
 // limitations under the License.
 
 #pragma once
-#include "Exception.hpp"
+#include "Exceptions.hpp"
 #include "Engine/Entity.hpp"
+#include "Engine/Archetype.hpp"
+#include "Engine/Query.hpp"
+#include "Engine/PoolAllocator.hpp"
 
+#include <atomic>
+#include <vector>
+#include <cstdint>
+#include <utility>
+#include <unordered_map>
+
+using namespace std;
+
+// Entity component system container class (archetype chunked storage)
+// Not locked: component access from the parallel tasks is ordered by the scheduler, structural changes are recorded into the entity command buffers
 class System
 {
+	// Snapshot restores entity slots and archetype rows directly
+	friend class Snapshot;
+
 protected:
-	// System entity array size
-	size_t size;
-	// System entity array expand size
-	size_t expandSize;
-	// System entity array
-	Entity** entities;
+	// Archetype chunk memory pool (page aligned slabs)
+	PoolAllocator* chunkPool;
+	// Archetype array
+	vector<Archetype*> archetypes;
+	// Archetype map (key is the component type set mask)
+	unordered_map<ComponentMask, Archetype*, ComponentMaskHash> archetypeMap;
+	// Empty archetype (entities without components)
+	Archetype* emptyArchetype;
+	// Cached query array (owned by the system)
+	vector<Query*> queries;
 
-public:
-	// Default entity array expand size
-	const int DefaultExpandSize = 64;
+	// Entity slot array
+	vector<EntityRecord> entities;
+	// First free entity slot index
+	uint32_t freeHead;
+	// Alive entity count
+	size_t entityCount;
+	// Change version counter (incremented by each query iteration)
+	atomic<uint64_t> version;
+	// Structure version (incremented by each entity add, remove or archetype move)
+	uint64_t structureVersion;
+
+	// Returns change version of the writes outside of the query iteration
+	// It is greater than the version of any started iteration, so the change is visible to all of them
+	uint64_t GetWriteVersion()
+	{
+		return version.load(memory_order_relaxed) + 1;
+	}
+
+	// Returns archetype with the component types (creates a new one if required)
+	Archetype* GetArchetype(const vector<const ComponentType*>& types)
+	{
+		ComponentMask key = {};
+
+		for (auto type : types)
+			key.Set(type->id);
+
+		auto iterator = archetypeMap.find(key);
+
+		if (iterator != archetypeMap.end())
+			return iterator->second;
+
+		auto archetype = new Archetype(types, chunkPool);
+		archetypes.push_back(archetype);
+		archetypeMap.emplace(key, archetype);
+
+		for (auto query : queries)
+			query->OnArchetypeCreate(archetype);
+
+		return archetype;
+	}
+
+	// Removes entity row from its archetype and updates location of the moved entity
+	void RemoveRow(const EntityLocation& location, bool isDestruct)
+	{
+		auto movedEntity = location.archetype->Remove(location.chunkIndex, location.rowIndex, isDestruct, GetWriteVersion());
+
+		if (movedEntity != InvalidEntityIndex)
+		{
+			entities[movedEntity].location.chunkIndex = location.chunkIndex;
+			entities[movedEntity].location.rowIndex = location.rowIndex;
+		}
+	}
+	// Moves entity to the other archetype (new components are default constructed, missing are destroyed)
+	// Added component is left unconstructed, so the caller can construct it with arguments
+	void MoveEntity(uint32_t index, Archetype* destination, const ComponentType* addedType)
+	{
+		auto location = entities[index].location;
+		auto source = location.archetype;
 
+		uint32_t chunkIndex;
+		auto rowIndex = destination->Allocate(index, chunkIndex, GetWriteVersion());
+		auto& destinationTypes = destination->GetTypes();
+
+		for (size_t i = 0; i < destinationTypes.size(); i++)
+		{
+			auto component = destination->GetComponent(chunkIndex, rowIndex, i);
+			size_t sourceIndex;
+
+			if (source->FindType(destinationTypes[i]->id, sourceIndex))
+				destinationTypes[i]->move(component, source->GetComponent(location.chunkIndex, location.rowIndex, sourceIndex));
+			else if (destinationTypes[i] != addedType)
+				destinationTypes[i]->construct(component);
+		}
+
+		auto& sourceTypes = source->GetTypes();
+
+		for (size_t i = 0; i < sourceTypes.size(); i++)
+		{
+			if (!destination->HasType(sourceTypes[i]->id))
+				sourceTypes[i]->destruct(source->GetComponent(location.chunkIndex, location.rowIndex, i));
+		}
+
+		RemoveRow(location, false);
+
+		entities[index].location.archetype = destination;
+		entities[index].location.chunkIndex = chunkIndex;
+		entities[index].location.rowIndex = rowIndex;
+		structureVersion++;
+	}
+
+	// Returns alive entity location
+	EntityLocation& GetLocation(Entity entity)
+	{
+		if (!Contains(entity))
+			throw ArgumentException("Entity is not alive");
+
+		return entities[entity.index].location;
+	}
+
+public:
 	// Creates a new system instance
 	System()
 	{
-		size = expandSize = DefaultExpandSize;
-		entities = new Entity * [DefaultExpandSize];
+		chunkPool = new PoolAllocator(ArchetypeChunkSize, ArchetypeChunkSlabSize, PoolPageSize);
+		entityCount = 0;
+		version = 0;
+		structureVersion = 0;
+		freeHead = InvalidEntityIndex;
+		emptyArchetype = GetArchetype({});
+	}
+	// Destroys system instance (and all its entities)
+	~System()
+	{
+		for (auto query : queries)
+			delete query;
+
+		for (auto archetype : archetypes)
+			delete archetype;
 
-		/*for (size_t i = 0; i < DefaultExpandSize; i++)
-			entities[i] = nullptr;*/
+		delete chunkPool;
 	}
-	// Creates a new system instance
-	System(size_t _expandSize)
+
+	// Returns archetype array
+	const vector<Archetype*>& GetArchetypes() { return archetypes; }
+	// Returns alive entity count
+	size_t GetEntityCount() { return entityCount; }
+	// Returns archetype chunk memory pool
+	PoolAllocator* GetChunkPool() { return chunkPool; }
+	// Returns current change version
+	uint64_t GetVersion() { return version.load(); }
+	// Returns structure version (changed if any entity was added, removed or moved between archetypes)
+	uint64_t GetStructureVersion() { return structureVersion; }
+	// Returns entity slot count (upper bound of the entity indices)
+	size_t GetEntitySlotCount() { return entities.size(); }
+
+	// Creates a new cached query (matches existing and all future archetypes)
+	Query* CreateQuery(const QueryDescription& description)
 	{
-		size = expandSize = _expandSize;
-		entities = new Entity * [_expandSize];
+		auto query = new Query(description, &version);
+
+		for (auto archetype : archetypes)
+			query->OnArchetypeCreate(archetype);
 
-		/*for (size_t i = 0; i < _expandSize; i++)
-			entities[i] = nullptr;*/
+		queries.push_back(query);
+		return query;
 	}
+	// Destroys cached query
+	void DestroyQuery(Query* query)
+	{
+		for (size_t i = 0; i < queries.size(); i++)
+		{
+			if (queries[i] == query)
+			{
+				queries[i] = queries.back();
+				queries.pop_back();
+				break;
+			}
+		}
 
-	// Adds a new entity to the system
-	size_t Add(Entity* entity)
+		delete query;
+	}
+
+	// Adds a new entity with unconstructed components to the system (reuses free slot if there is one)
+	// Entity is placed directly into its final archetype, caller should construct all components
+	Entity AddUninitialized(const vector<const ComponentType*>& types)
 	{
-		if (!entity)
-			throw ArgumentNullException();
+		auto archetype = types.empty() ? emptyArchetype : GetArchetype(types);
+		uint32_t index;
 
-		for (size_t i = 0; i < size; i++)
+		if (freeHead != InvalidEntityIndex)
+		{
+			index = freeHead;
+			freeHead = entities[index].nextFree;
+		}
+		else
 		{
-			if (entities[i])
-				continue;
+			if (entities.size() >= InvalidEntityIndex)
+				throw ArgumentOutOfRangeException("Too many system entities");
 
-			entities[i] = entity;
-			return i;
+			index = static_cast<uint32_t>(entities.size());
+			entities.push_back({});
 		}
 
-		auto newEntities = new Entity * [size + expandSize];
-		memcpy(newEntities, entities, size * sizeof(Entity*));
+		auto& record = entities[index];
+		record.location.archetype = archetype;
+		record.location.rowIndex = archetype->Allocate(index, record.location.chunkIndex, GetWriteVersion());
+		record.nextFree = InvalidEntityIndex;
+
+		entityCount++;
+		structureVersion++;
+		return { index, record.generation };
+	}
+	// Adds a new entity without components to the system
+	Entity Add()
+	{
+		return AddUninitialized({});
+	}
+	// Removes entity from the system (and destroys its components)
+	void Remove(Entity entity)
+	{
+		auto location = GetLocation(entity);
+		RemoveRow(location, true);
+
+		// Slot generation is changed, so all existing handles become stale
+		auto& record = entities[entity.index];
+		record.location.archetype = nullptr;
+		record.generation++;
+
+		// Deferred generation is reserved for the command buffer placeholders
+		if (record.generation == DeferredEntityGeneration)
+			record.generation = 0;
+
+		record.nextFree = freeHead;
+		freeHead = entity.index;
+
+		entityCount--;
+		structureVersion++;
+	}
+	// Returns true if entity is alive (false for stale handles)
+	bool Contains(Entity entity)
+	{
+		return entity.index < entities.size() &&
+			entities[entity.index].generation == entity.generation &&
+			entities[entity.index].location.archetype;
+	}
+
+	// Adds a new unconstructed component to the entity, returns its memory
+	void* AddUninitializedComponent(Entity entity, const ComponentType& type)
+	{
+		auto& location = GetLocation(entity);
 
-		delete[] entities;
-		entities = newEntities;
+		if (location.archetype->HasType(type.id))
+			throw ArgumentException("Entity already has the component");
 
-		entities[size] = entity;
-		size += expandSize;
+		auto types = location.archetype->GetTypes();
+		types.push_back(&type);
 
-		return size - expandSize;
+		auto destination = GetArchetype(types);
+		MoveEntity(entity.index, destination, &type);
+		return destination->GetComponent(location.chunkIndex, location.rowIndex, destination->GetTypeIndex(type.id));
 	}
+	// Adds a new default constructed component to the entity, returns it
+	void* AddComponent(Entity entity, const ComponentType& type)
+	{
+		if (!type.construct)
+			throw ArgumentException("Component type is not default constructible");
 
-	// Removes entity from the system
-	Entity* Remove(size_t index)
+		auto component = AddUninitializedComponent(entity, type);
+		type.construct(component);
+		return component;
+	}
+	// Removes component from the entity (and destroys it)
+	void RemoveComponent(Entity entity, const ComponentType& type)
 	{
-		if (index >= size)
-			throw ArgumentOutOfRangeException();
+		auto& location = GetLocation(entity);
 
-		auto entity = entities[index];
-		entities[index] = nullptr;
-		return entity;
+		if (!location.archetype->HasType(type.id))
+			throw ArgumentException("Entity does not have the component");
+
+		auto types = location.archetype->GetTypes();
+		types.erase(types.begin() + location.archetype->GetTypeIndex(type.id));
+
+		MoveEntity(entity.index, GetArchetype(types), nullptr);
 	}
+	// Returns mutable entity component and marks its chunk array as changed (null if entity does not have it)
+	void* GetComponent(Entity entity, const ComponentType& type)
+	{
+		auto& location = GetLocation(entity);
+		size_t typeIndex;
 
-	// Removes entity from the system
-	Entity* Get(size_t index)
+		if (!location.archetype->FindType(type.id, typeIndex))
+			return nullptr;
+
+		location.archetype->SetChunkVersion(location.chunkIndex, typeIndex, GetWriteVersion());
+		return location.archetype->GetComponent(location.chunkIndex, location.rowIndex, typeIndex);
+	}
+	// Returns read only entity component (null if entity does not have it)
+	const void* GetConstComponent(Entity entity, const ComponentType& type)
 	{
-		if (index >= size)
-			throw ArgumentOutOfRangeException();
+		auto& location = GetLocation(entity);
+		size_t typeIndex;
+
+		if (!location.archetype->FindType(type.id, typeIndex))
+			return nullptr;
+
+		return location.archetype->GetComponent(location.chunkIndex, location.rowIndex, typeIndex);
+	}
 
-		return entities[index];
+	// Returns true if entity has the component
+	bool HasComponent(Entity entity, const ComponentType& type)
+	{
+		return GetLocation(entity).archetype->HasType(type.id);
 	}
 
-	// TODO: Add mutex thread lock on entity add/get/remove. Add mutex lock on work with specified entity.
-};
\ No newline at end of file
+	// Adds a new component constructed from the arguments to the entity, returns it
+	template<class T, class... Args>
+	T& AddComponent(Entity entity, Args&&... args)
+	{
+		// Component is constructed before the entity is moved, so constructor exception leaves it unchanged
+		T value(forward<Args>(args)...);
+		auto component = AddUninitializedComponent(entity, GetComponentType<T>());
+		return *new (component) T(move(value));
+	}
+	// Removes component from the entity (and destroys it)
+	template<class T>
+	void RemoveComponent(Entity entity)
+	{
+		RemoveComponent(entity, GetComponentType<T>());
+	}
+	// Returns mutable entity component and marks it as changed (null if entity does not have it)
+	template<class T>
+	T* GetComponent(Entity entity)
+	{
+		return static_cast<T*>(GetComponent(entity, GetComponentType<T>()));
+	}
+	// Returns read only entity component (null if entity does not have it)
+	template<class T>
+	const T* GetConstComponent(Entity entity)
+	{
+		return static_cast<const T*>(GetConstComponent(entity, GetComponentType<T>()));
+	}
+	// Returns true if entity has the component
+	template<class T>
+	bool HasComponent(Entity entity)
+	{
+		return HasComponent(entity, GetComponentType<T>());
+	}
+};
@@ -0,0 +1,102 @@
+
+// Copyright 2019 Nikita Fediuchin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+#include <mutex>
+#include <queue>
+#include <vector>
+#include <thread>
+#include <functional>
+#include <condition_variable>
+
+using namespace std;
+
+// Fixed size worker thread pool class
+// Runs long blocking tasks (pipeline compilation) off the frame threads. Short frame work uses the job system,
+// a blocking task there would hold a worker which other jobs wait for.
+class ThreadPool
+{
+protected:
+	// Worker thread array
+	vector<thread> threads;
+	// Pending task queue
+	queue<function<void()>> tasks;
+	// Task queue mutex
+	mutex tasksMutex;
+	// Task queue condition variable
+	condition_variable tasksCondition;
+	// Is thread pool accepting and executing tasks
+	bool isRunning;
+
+	// Executes queued tasks until thread pool is stopped
+	void WorkerLoop()
+	{
+		while (true)
+		{
+			function<void()> task;
+
+			{
+				unique_lock<mutex> lock(tasksMutex);
+				tasksCondition.wait(lock, [this]() { return !isRunning || !tasks.empty(); });
+
+				if (!isRunning && tasks.empty())
+					return;
+
+				task = move(tasks.front());
+				tasks.pop();
+			}
+
+			task();
+		}
+	}
+
+public:
+	// Creates a new thread pool instance
+	ThreadPool(size_t threadCount)
+	{
+		isRunning = true;
+		threads.reserve(threadCount);
+
+		for (size_t i = 0; i < threadCount; i++)
+			threads.emplace_back(&ThreadPool::WorkerLoop, this);
+	}
+	// Destroys thread pool instance (waits for the queued tasks)
+	~ThreadPool()
+	{
+		{
+			lock_guard<mutex> lock(tasksMutex);
+			isRunning = false;
+		}
+
+		tasksCondition.notify_all();
+
+		for (auto& thread : threads)
+			thread.join();
+	}
+
+	// Returns worker thread count
+	size_t GetThreadCount() { return threads.size(); }
+
+	// Adds a new task to the thread pool queue
+	void Enqueue(const function<void()>& task)
+	{
+		{
+			lock_guard<mutex> lock(tasksMutex);
+			tasks.push(task);
+		}
+
+		tasksCondition.notify_one();
+	}
+};
@@ -0,0 +1,468 @@
+
+// Copyright 2019 Nikita Fediuchin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+#include "Exceptions.hpp"
+#include "Engine/Matrix.hpp"
+#include "Engine/System.hpp"
+#include "Engine/JobSystem.hpp"
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+
+using namespace std;
+
+// Transform hierarchy node batch size of the parallel propagation
+const size_t TransformParallelBatchSize = 4096;
+// Transform hierarchy node count the parent world matrix prefetch runs ahead of the propagation
+const size_t TransformPrefetchDistance = 8;
+// Invalid transform node index value
+const uint32_t InvalidTransformNode = UINT32_MAX;
+
+// Entity local transform component (relative to the parent world transform)
+struct Transform
+{
+	// Component type name (snapshot type identifier)
+	static constexpr const char* ComponentName = "Transform";
+
+	// Local position
+	float position[3];
+	// Local rotation quaternion (x, y, z, w)
+	float rotation[4];
+	// Local scale
+	float scale[3];
+
+	// Creates a new identity transform
+	Transform()
+	{
+		position[0] = position[1] = position[2] = 0.0f;
+		rotation[0] = rotation[1] = rotation[2] = 0.0f;
+		rotation[3] = 1.0f;
+		scale[0] = scale[1] = scale[2] = 1.0f;
+	}
+};
+
+// World matrix batch kernel reads transforms as ten consecutive floats
+static_assert(sizeof(Transform) == 10 * sizeof(float) && offsetof(Transform, rotation) == 3 * sizeof(float) &&
+	offsetof(Transform, scale) == 7 * sizeof(float), "Transform should be position, rotation and scale floats");
+
+// Entity parent component (parent should have transform and world transform, otherwise entity is a root)
+struct Parent
+{
+	// Component type name (snapshot type identifier)
+	static constexpr const char* ComponentName = "Parent";
+
+	// Parent entity
+	Entity entity;
+
+	// Creates a new parent component without parent
+	Parent()
+	{
+		entity = NullEntity;
+	}
+	// Creates a new parent component
+	Parent(Entity _entity)
+	{
+		entity = _entity;
+	}
+};
+
+// Entity world transform component (computed by the transform hierarchy)
+struct WorldTransform
+{
+	// Component type name (snapshot type identifier)
+	static constexpr const char* ComponentName = "WorldTransform";
+
+	// Local to world matrix
+	Matrix4 matrix;
+
+	// Creates a new identity world transform
+	WorldTransform()
+	{
+		matrix = Matrix4::Identity();
+	}
+};
+
+// Transform hierarchy class (computes world transforms of the entities with Transform and WorldTransform)
+// Nodes are sorted breadth first, so each level depends only on the previous one and is split into jobs.
+// Level nodes are sorted by their chunk position, dirty nodes are composed in SIMD batches directly into the components.
+// Only chunks with the changed transforms and their subtrees are recomputed.
+class TransformHierarchy
+{
+protected:
+	// Entity system
+	System* system;
+	// Job system for the level propagation (can be null)
+	JobSystem* jobSystem;
+	// Hierarchy entity query
+	Query* query;
+	// Transform component mask
+	ComponentMask transformMask;
+	// Parent component mask
+	ComponentMask parentMask;
+
+	// Is hierarchy sorted at least once
+	bool isBuilt;
+	// System structure version of the last sort
+	uint64_t structureVersion;
+
+	// Entity index array per node (sorted breadth first)
+	vector<uint32_t> nodeEntities;
+	// Parent node index array per node (invalid for the roots)
+	vector<uint32_t> parentNodes;
+	// Level first node index array (and node count at the end)
+	vector<size_t> levelOffsets;
+	// Node index array per entity slot (invalid if entity is not in the hierarchy)
+	vector<uint32_t> entityNodes;
+	// Transform component array per node (valid until the system structure changes)
+	vector<const float*> nodeTransforms;
+	// World transform matrix array per node (valid until the system structure changes)
+	vector<Matrix4*> nodeWorlds;
+	// Dirty flag array per node
+	vector<uint8_t> dirtyNodes;
+	// World transform count updated by the last update
+	size_t updatedCount;
+
+	// Returns true if any hierarchy chunk parent component changed after the version
+	bool IsParentChanged(uint64_t version)
+	{
+		for (auto archetype : query->GetArchetypes())
+		{
+			if (!archetype->GetMask().Intersects(parentMask))
+				continue;
+
+			auto chunkCount = archetype->GetChunkCount();
+
+			for (uint32_t i = 0; i < chunkCount; i++)
+			{
+				if (archetype->IsChunkChanged(i, parentMask, version))
+					return true;
+			}
+		}
+
+		return false;
+	}
+
+	// Sorts hierarchy nodes breadth first (parents before children)
+	void Sort()
+	{
+		entityNodes.assign(system->GetEntitySlotCount(), InvalidTransformNode);
+
+		vector<uint32_t> entities;
+		vector<uint32_t> parentEntities;
+		vector<const float*> transforms;
+		vector<Matrix4*> worlds;
+
+		// Every world transform is written after the sort, so all chunks are marked as changed
+		query->ForEachChunk([&](QueryChunk& chunk)
+		{
+			auto indices = chunk.GetEntityIndices();
+			auto parents = chunk.GetConst<Parent>();
+			auto localTransforms = chunk.GetConst<Transform>();
+			auto worldTransforms = chunk.Get<WorldTransform>();
+
+			for (uint32_t i = 0; i < chunk.count; i++)
+			{
+				entityNodes[indices[i]] = static_cast<uint32_t>(entities.size());
+				entities.push_back(indices[i]);
+				parentEntities.push_back(parents && system->Contains(parents[i].entity) ? parents[i].entity.index : InvalidEntityIndex);
+				transforms.push_back(localTransforms[i].position);
+				worlds.push_back(&worldTransforms[i].matrix);
+			}
+		});
+
+		auto count = entities.size();
+		vector<uint32_t> parents(count);
+		vector<uint32_t> childOffsets(count + 1, 0);
+
+		for (size_t i = 0; i < count; i++)
+		{
+			auto parent = parentEntities[i] != InvalidEntityIndex ? entityNodes[parentEntities[i]] : InvalidTransformNode;
+			parents[i] = parent != i ? parent : InvalidTransformNode;
+
+			if (parents[i] != InvalidTransformNode)
+				childOffsets[parents[i] + 1]++;
+		}
+
+		for (size_t i = 0; i < count; i++)
+			childOffsets[i + 1] += childOffsets[i];
+
+		vector<uint32_t> children(childOffsets[count]);
+		vector<uint32_t> childPositions(childOffsets.begin(), childOffsets.end() - 1);
+
+		for (size_t i = 0; i < count; i++)
+		{
+			if (parents[i] != InvalidTransformNode)
+				children[childPositions[parents[i]]++] = static_cast<uint32_t>(i);
+		}
+
+		vector<uint32_t> order;
+		order.reserve(count);
+		levelOffsets.clear();
+		levelOffsets.push_back(0);
+
+		for (size_t i = 0; i < count; i++)
+		{
+			if (parents[i] == InvalidTransformNode)
+				order.push_back(static_cast<uint32_t>(i));
+		}
+
+		size_t levelBegin = 0;
+
+		while (levelBegin < order.size())
+		{
+			auto levelEnd = order.size();
+			levelOffsets.push_back(levelEnd);
+
+			for (auto i = levelBegin; i < levelEnd; i++)
+			{
+				auto node = order[i];
+
+				for (auto j = childOffsets[node]; j < childOffsets[node + 1]; j++)
+					order.push_back(children[j]);
+			}
+
+			levelBegin = levelEnd;
+		}
+
+		// Nodes are in the query order inside each level, so the component accesses go forward through the chunks
+		for (size_t level = 0; level + 1 < levelOffsets.size(); level++)
+			sort(order.begin() + levelOffsets[level], order.begin() + levelOffsets[level + 1]);
+
+		// Nodes of the parent cycles are never reached, they are treated as roots
+		vector<uint32_t> sortedIndices(count, InvalidTransformNode);
+
+		for (size_t i = 0; i < order.size(); i++)
+			sortedIndices[order[i]] = static_cast<uint32_t>(i);
+
+		if (order.size() < count)
+		{
+			for (size_t i = 0; i < count; i++)
+			{
+				if (sortedIndices[i] == InvalidTransformNode)
+				{
+					sortedIndices[i] = static_cast<uint32_t>(order.size());
+					parents[i] = InvalidTransformNode;
+					order.push_back(static_cast<uint32_t>(i));
+				}
+			}
+
+			levelOffsets.push_back(count);
+		}
+
+		nodeEntities.resize(count);
+		parentNodes.resize(count);
+		nodeTransforms.resize(count);
+		nodeWorlds.resize(count);
+
+		for (size_t i = 0; i < count; i++)
+		{
+			auto node = order[i];
+			nodeEntities[i] = entities[node];
+			parentNodes[i] = parents[node] != InvalidTransformNode ? sortedIndices[parents[node]] : InvalidTransformNode;
+			entityNodes[entities[node]] = static_cast<uint32_t>(i);
+			nodeTransforms[i] = transforms[node];
+			nodeWorlds[i] = worlds[node];
+		}
+
+		dirtyNodes.assign(count, 0);
+
+		isBuilt = true;
+		structureVersion = system->GetStructureVersion();
+	}
+
+	// Marks nodes of the changed transforms as dirty
+	void MarkChangedNodes(uint64_t version, bool isAll)
+	{
+		if (isAll)
+		{
+			fill(dirtyNodes.begin(), dirtyNodes.end(), 1);
+			return;
+		}
+
+		// Array pointers are kept in locals, dirty flag stores could alias them otherwise
+		auto nodes = entityNodes.data();
+		auto dirty = dirtyNodes.data();
+
+		query->ForEachChunk([&](QueryChunk& chunk)
+		{
+			if (!chunk.archetype->IsChunkChanged(chunk.chunkIndex, transformMask, version))
+				return;
+
+			auto indices = chunk.GetEntityIndices();
+			auto count = chunk.count;
+
+			for (uint32_t i = 0; i < count; i++)
+				dirty[nodes[indices[i]]] = 1;
+		});
+	}
+	// Computes world matrices of the dirty nodes in the range (parents should be already computed)
+	// Dirty nodes are gathered into the batches of the SIMD kernel, the last batch repeats its last node.
+	void UpdateWorldMatrices(size_t begin, size_t end)
+	{
+		auto parentIndices = parentNodes.data();
+		auto transforms = nodeTransforms.data();
+		auto worlds = nodeWorlds.data();
+		auto dirty = dirtyNodes.data();
+		auto identity = &GetIdentityMatrix();
+
+		const float* batchTransforms[MatrixBatchSize];
+		const Matrix4* batchParents[MatrixBatchSize];
+		Matrix4* batchWorlds[MatrixBatchSize];
+		size_t batchCount = 0;
+
+		for (auto i = begin; i < end; i++)
+		{
+			auto parent = parentIndices[i];
+
+#if defined(MATRIX_USE_SSE)
+			// Parent world matrices are scattered over the previous level, so they are fetched ahead
+			if (i + TransformPrefetchDistance < end && parentIndices[i + TransformPrefetchDistance] != InvalidTransformNode)
+				_mm_prefetch(reinterpret_cast<const char*>(worlds[parentIndices[i + TransformPrefetchDistance]]), _MM_HINT_T0);
+#endif
+
+			if (parent != InvalidTransformNode && dirty[parent])
+				dirty[i] = 1;
+
+			if (!dirty[i])
+				continue;
+
+			batchTransforms[batchCount] = transforms[i];
+			batchParents[batchCount] = parent != InvalidTransformNode ? worlds[parent] : identity;
+			batchWorlds[batchCount] = worlds[i];
+
+			if (++batchCount == MatrixBatchSize)
+			{
+				ComposeWorldMatrices(batchTransforms, batchParents, batchWorlds);
+				batchCount = 0;
+			}
+		}
+
+		if (batchCount == 0)
+			return;
+
+		for (auto i = batchCount; i < MatrixBatchSize; i++)
+		{
+			batchTransforms[i] = batchTransforms[batchCount - 1];
+			batchParents[i] = batchParents[batchCount - 1];
+			batchWorlds[i] = batchWorlds[batchCount - 1];
+		}
+
+		ComposeWorldMatrices(batchTransforms, batchParents, batchWorlds);
+	}
+	// Propagates world matrices level by level (large levels are split into jobs)
+	void PropagateWorldMatrices()
+	{
+		for (size_t level = 0; level + 1 < levelOffsets.size(); level++)
+		{
+			auto begin = levelOffsets[level];
+			auto end = levelOffsets[level + 1];
+
+			if (!jobSystem)
+			{
+				UpdateWorldMatrices(begin, end);
+				continue;
+			}
+
+			jobSystem->ParallelFor(end - begin, TransformParallelBatchSize, [this, begin](size_t batchBegin, size_t batchEnd)
+			{
+				UpdateWorldMatrices(begin + batchBegin, begin + batchEnd);
+			});
+		}
+	}
+	// Marks world transform chunks of the dirty nodes as changed and counts the updated nodes
+	void MarkWorldTransforms()
+	{
+		auto nodes = entityNodes.data();
+		auto dirty = dirtyNodes.data();
+		size_t count = 0;
+
+		query->ForEachChunk([&](QueryChunk& chunk)
+		{
+			auto indices = chunk.GetEntityIndices();
+			auto chunkCount = chunk.count;
+			uint32_t first = 0;
+
+			while (first < chunkCount && !dirty[nodes[indices[first]]])
+				first++;
+
+			// Clean chunks are not accessed, so their world transforms are not marked as changed
+			if (first == chunkCount)
+				return;
+
+			chunk.Get<WorldTransform>();
+
+			for (auto i = first; i < chunkCount; i++)
+				count += dirty[nodes[indices[i]]];
+		});
+
+		updatedCount = count;
+
+		fill(dirtyNodes.begin(), dirtyNodes.end(), 0);
+	}
+
+public:
+	// Creates a new transform hierarchy instance (job system can be null)
+	TransformHierarchy(System* _system, JobSystem* _jobSystem)
+	{
+		if (!_system)
+			throw ArgumentNullException("Transform hierarchy system is null");
+
+		system = _system;
+		jobSystem = _jobSystem;
+		query = _system->CreateQuery(QueryDescription().Require<Transform>().Require<WorldTransform>().Optional<Parent>());
+
+		transformMask = {};
+		transformMask.Set(GetComponentType<Transform>().id);
+		parentMask = {};
+		parentMask.Set(GetComponentType<Parent>().id);
+
+		isBuilt = false;
+		structureVersion = 0;
+		updatedCount = 0;
+	}
+	// Destroys transform hierarchy instance
+	~TransformHierarchy()
+	{
+		system->DestroyQuery(query);
+	}
+
+	TransformHierarchy(const TransformHierarchy&) = delete;
+	TransformHierarchy& operator=(const TransformHierarchy&) = delete;
+
+	// Returns hierarchy node count
+	size_t GetNodeCount() { return nodeEntities.size(); }
+	// Returns hierarchy level count
+	size_t GetLevelCount() { return levelOffsets.empty() ? 0 : levelOffsets.size() - 1; }
+	// Returns world transform count updated by the last update
+	size_t GetUpdatedCount() { return updatedCount; }
+
+	// Updates world transforms of the changed transforms and their subtrees
+	// Hierarchy is sorted again if system structure or any parent component changed
+	void Update()
+	{
+		auto version = query->GetLastVersion();
+		auto isSort = !isBuilt || structureVersion != system->GetStructureVersion() || IsParentChanged(version);
+
+		if (isSort)
+			Sort();
+
+		MarkChangedNodes(version, isSort);
+		PropagateWorldMatrices();
+		MarkWorldTransforms();
+	}
+};
@@ -0,0 +1,381 @@
+
+// Copyright 2019 Nikita Fediuchin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+#include "Vulkan.hpp"
+#include "Exceptions.hpp"
+#include "Engine/BuddyAllocator.hpp"
+
+#include <mutex>
+#include <vector>
+
+using namespace std;
+
+namespace Vulkan
+{
+	// Default vulkan device memory block size
+	const VkDeviceSize DefaultMemoryBlockSize = 64 * 1024 * 1024;
+	// Minimal vulkan device memory suballocation size
+	const VkDeviceSize MinMemoryAllocationSize = 512;
+
+	// Returns index of the memory type which is allowed by the type bits and has all properties
+	static uint32_t FindMemoryType(const VkPhysicalDeviceMemoryProperties& memoryProperties, uint32_t typeBits, VkMemoryPropertyFlags properties)
+	{
+		for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++)
+		{
+			if ((typeBits & (1u << i)) && (memoryProperties.memoryTypes[i].propertyFlags & properties) == properties)
+				return i;
+		}
+
+		throw VulkanException("Failed to find suitable memory type");
+	}
+
+	// Vulkan device memory block class
+	class MemoryBlock_T
+	{
+	public:
+		// Vulkan logical device instance
+		VkDevice device;
+
+		// Vulkan device memory instance
+		VkDeviceMemory memory;
+		// Device memory size
+		VkDeviceSize size;
+		// Device memory type index
+		uint32_t memoryTypeIndex;
+		// Is block used by linear resources (buffers), otherwise by optimal tiling images
+		bool isLinear;
+		// Persistently mapped memory pointer (null if memory is not host visible)
+		void* mappedData;
+		// Suballocator (null if block is a dedicated allocation)
+		BuddyAllocator* allocator;
+
+		// Creates a new vulkan device memory block class instance
+		MemoryBlock_T(VkDevice _device, VkDeviceSize _size, uint32_t _memoryTypeIndex, bool _isLinear, bool isHostVisible, bool isDedicated)
+		{
+			device = _device;
+			size = _size;
+			memoryTypeIndex = _memoryTypeIndex;
+			isLinear = _isLinear;
+			mappedData = nullptr;
+			allocator = nullptr;
+
+			VkMemoryAllocateInfo allocateInfo = {};
+			allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+			allocateInfo.allocationSize = _size;
+			allocateInfo.memoryTypeIndex = _memoryTypeIndex;
+
+			auto result = vkAllocateMemory(_device, &allocateInfo, nullptr, &memory);
+			if (result != VK_SUCCESS)
+				throw VulkanException("Failed to allocate device memory. Result: " + to_string(result));
+
+			if (isHostVisible)
+			{
+				result = vkMapMemory(_device, memory, 0, VK_WHOLE_SIZE, 0, &mappedData);
+
+				if (result != VK_SUCCESS)
+				{
+					vkFreeMemory(_device, memory, nullptr);
+					throw VulkanException("Failed to map device memory. Result: " + to_string(result));
+				}
+			}
+
+			if (!isDedicated)
+				allocator = new BuddyAllocator(_size, MinMemoryAllocationSize);
+		}
+		// Destroys vulkan device memory block class instance
+		~MemoryBlock_T()
+		{
+			delete allocator;
+
+			if (mappedData)
+				vkUnmapMemory(device, memory);
+
+			vkFreeMemory(device, memory, nullptr);
+		}
+
+		// Returns true if block is a dedicated allocation
+		bool IsDedicated() { return allocator == nullptr; }
+	};
+
+	// Vulkan device memory block class instance
+	typedef MemoryBlock_T* MemoryBlock;
+
+	// Vulkan device memory allocation
+	struct Allocation
+	{
+		// Memory block instance
+		MemoryBlock block;
+		// Vulkan device memory instance
+		VkDeviceMemory memory;
+		// Allocation offset in the device memory
+		VkDeviceSize offset;
+		// Requested allocation size
+		VkDeviceSize size;
+		// Mapped allocation pointer (null if memory is not host visible)
+		void* mappedData;
+	};
+
+	// Vulkan device memory heap usage statistics
+	struct MemoryHeapStats
+	{
+		// Heap size
+		VkDeviceSize heapSize;
+		// Device memory block count (including dedicated)
+		size_t blockCount;
+		// Allocation count
+		size_t allocationCount;
+		// Allocated device memory size
+		VkDeviceSize allocatedSize;
+		// Size used by the allocations (rounded to the suballocation block sizes)
+		VkDeviceSize usedSize;
+	};
+
+	// Vulkan device memory allocator class
+	// Large blocks are allocated per memory type and suballocated with the buddy scheme.
+	// Linear and optimal tiling resources never share a block, so bufferImageGranularity is always honoured.
+	class Allocator_T
+	{
+	protected:
+		// Vulkan logical device instance
+		VkDevice device;
+		// Vulkan physical device memory properties
+		VkPhysicalDeviceMemoryProperties memoryProperties;
+		// Vulkan physical device buffer image granularity
+		VkDeviceSize bufferImageGranularity;
+
+		// Device memory block size
+		VkDeviceSize blockSize;
+		// Device memory block array
+		vector<MemoryBlock> blocks;
+		// Device memory block array mutex
+		mutex blocksMutex;
+
+		// Destroys memory block and removes it from the array
+		void DestroyBlock(MemoryBlock block)
+		{
+			for (size_t i = 0; i < blocks.size(); i++)
+			{
+				if (blocks[i] == block)
+				{
+					blocks[i] = blocks.back();
+					blocks.pop_back();
+					break;
+				}
+			}
+
+			delete block;
+		}
+
+	public:
+		// Creates a new vulkan device memory allocator class instance
+		Allocator_T(VkDevice _device, VkPhysicalDevice physicalDevice, VkDeviceSize _blockSize)
+		{
+			if (!IsPowerOfTwo(_blockSize))
+				throw ArgumentException("Vulkan memory block size should be power of two");
+
+			device = _device;
+			blockSize = _blockSize;
+
+			vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+
+			VkPhysicalDeviceProperties properties;
+			vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+			bufferImageGranularity = properties.limits.bufferImageGranularity;
+		}
+		// Destroys vulkan device memory allocator class instance (frees all blocks)
+		~Allocator_T()
+		{
+			for (auto block : blocks)
+				delete block;
+		}
+
+		// Returns physical device memory properties
+		const VkPhysicalDeviceMemoryProperties& GetMemoryProperties() { return memoryProperties; }
+		// Returns physical device buffer image granularity
+		VkDeviceSize GetBufferImageGranularity() { return bufferImageGranularity; }
+
+		// Allocates device memory for the resource requirements
+		Allocation Allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, bool isLinear)
+		{
+			auto memoryTypeIndex = FindMemoryType(memoryProperties, requirements.memoryTypeBits, properties);
+			auto isHostVisible = (memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) != 0;
+
+			Allocation allocation = {};
+			allocation.size = requirements.size;
+
+			lock_guard<mutex> lock(blocksMutex);
+
+			// Large resources get their own device memory
+			if (requirements.size > blockSize / 2)
+			{
+				auto block = new MemoryBlock_T(device, requirements.size, memoryTypeIndex, isLinear, isHostVisible, true);
+				blocks.push_back(block);
+
+				allocation.block = block;
+				allocation.memory = block->memory;
+				allocation.offset = 0;
+				allocation.mappedData = block->mappedData;
+				return allocation;
+			}
+
+			for (auto block : blocks)
+			{
+				if (block->IsDedicated() || block->memoryTypeIndex != memoryTypeIndex || block->isLinear != isLinear)
+					continue;
+
+				if (block->allocator->Allocate(requirements.size, requirements.alignment, allocation.offset))
+				{
+					allocation.block = block;
+					break;
+				}
+			}
+
+			if (!allocation.block)
+			{
+				// Empty block fits any request up to its size, so this is the only failure case
+				if (requirements.alignment > blockSize)
+					throw VulkanException("Device memory alignment is larger than the block size. Alignment: " + to_string(requirements.alignment));
+
+				auto block = new MemoryBlock_T(device, blockSize, memoryTypeIndex, isLinear, isHostVisible, false);
+
+				if (!block->allocator->Allocate(requirements.size, requirements.alignment, allocation.offset))
+				{
+					delete block;
+					throw VulkanException("Failed to suballocate device memory");
+				}
+
+				blocks.push_back(block);
+				allocation.block = block;
+			}
+
+			allocation.memory = allocation.block->memory;
+			allocation.mappedData = allocation.block->mappedData ?
+				static_cast<uint8_t*>(allocation.block->mappedData) + allocation.offset : nullptr;
+			return allocation;
+		}
+		// Frees device memory allocation (keeps one empty block per memory type for reuse)
+		void Free(const Allocation& allocation)
+		{
+			lock_guard<mutex> lock(blocksMutex);
+
+			auto block = allocation.block;
+
+			if (block->IsDedicated())
+			{
+				DestroyBlock(block);
+				return;
+			}
+
+			block->allocator->Free(allocation.offset);
+
+			if (!block->allocator->IsEmpty())
+				return;
+
+			for (auto other : blocks)
+			{
+				if (other != block && !other->IsDedicated() && other->allocator->IsEmpty() &&
+					other->memoryTypeIndex == block->memoryTypeIndex && other->isLinear == block->isLinear)
+				{
+					DestroyBlock(block);
+					return;
+				}
+			}
+		}
+
+		// Allocates and binds device memory for the buffer
+		Allocation AllocateBuffer(VkBuffer buffer, VkMemoryPropertyFlags properties)
+		{
+			VkMemoryRequirements requirements;
+			vkGetBufferMemoryRequirements(device, buffer, &requirements);
+
+			auto allocation = Allocate(requirements, properties, true);
+
+			auto result = vkBindBufferMemory(device, buffer, allocation.memory, allocation.offset);
+			if (result != VK_SUCCESS)
+			{
+				Free(allocation);
+				throw VulkanException("Failed to bind buffer memory. Result: " + to_string(result));
+			}
+
+			return allocation;
+		}
+		// Allocates and binds device memory for the image
+		Allocation AllocateImage(VkImage image, VkMemoryPropertyFlags properties, bool isLinear)
+		{
+			VkMemoryRequirements requirements;
+			vkGetImageMemoryRequirements(device, image, &requirements);
+
+			auto allocation = Allocate(requirements, properties, isLinear);
+
+			auto result = vkBindImageMemory(device, image, allocation.memory, allocation.offset);
+			if (result != VK_SUCCESS)
+			{
+				Free(allocation);
+				throw VulkanException("Failed to bind image memory. Result: " + to_string(result));
+			}
+
+			return allocation;
+		}
+
+		// Returns device memory usage statistics per memory heap
+		vector<MemoryHeapStats> GetHeapStats()
+		{
+			lock_guard<mutex> lock(blocksMutex);
+
+			vector<MemoryHeapStats> heapStats(memoryProperties.memoryHeapCount);
+
+			for (uint32_t i = 0; i < memoryProperties.memoryHeapCount; i++)
+			{
+				heapStats[i] = {};
+				heapStats[i].heapSize = memoryProperties.memoryHeaps[i].size;
+			}
+
+			for (auto block : blocks)
+			{
+				auto& stats = heapStats[memoryProperties.memoryTypes[block->memoryTypeIndex].heapIndex];
+				stats.blockCount++;
+				stats.allocatedSize += block->size;
+
+				if (block->IsDedicated())
+				{
+					stats.allocationCount++;
+					stats.usedSize += block->size;
+				}
+				else
+				{
+					stats.allocationCount += block->allocator->GetAllocationCount();
+					stats.usedSize += block->allocator->GetUsedSize();
+				}
+			}
+
+			return heapStats;
+		}
+	};
+
+	// Vulkan device memory allocator class instance
+	typedef Allocator_T* Allocator;
+
+	// Creates a new vulkan device memory allocator class instance
+	static Allocator CreateAllocatorInstance(VkDevice device, VkPhysicalDevice physicalDevice, VkDeviceSize blockSize)
+	{
+		return new Allocator_T(device, physicalDevice, blockSize);
+	}
+	// Destroys vulkan device memory allocator class instance
+	static void DestroyAllocatorInstance(Allocator instance)
+	{
+		delete instance;
+	}
+}
@@ -0,0 +1,105 @@
+
+// Copyright 2019 Nikita Fediuchin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+#include "Vulkan.hpp"
+#include "Allocator.hpp"
+#include "Exceptions.hpp"
+
+using namespace std;
+
+namespace Vulkan
+{
+	// Creates a new vulkan buffer instance (exclusive sharing mode)
+	static VkBuffer CreateVulkanBufferInstance(VkDevice device, VkDeviceSize size, VkBufferUsageFlags usage)
+	{
+		VkBufferCreateInfo bufferInfo = {};
+		bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+		bufferInfo.size = size;
+		bufferInfo.usage = usage;
+		bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+		VkBuffer buffer;
+		auto result = vkCreateBuffer(device, &bufferInfo, nullptr, &buffer);
+
+		if (result != VK_SUCCESS)
+			throw VulkanException("Failed to create buffer. Result: " + to_string(result));
+
+		return buffer;
+	}
+
+	// Vulkan buffer class
+	class Buffer_T
+	{
+	public:
+		// Vulkan logical device instance
+		VkDevice device;
+		// Vulkan device memory allocator instance
+		Allocator allocator;
+
+		// Vulkan buffer instance
+		VkBuffer instance;
+		// Vulkan buffer device memory allocation
+		Allocation allocation;
+		// Buffer size
+		VkDeviceSize size;
+
+		// Creates a new vulkan buffer class instance
+		Buffer_T(VkDevice _device, Allocator _allocator, VkDeviceSize _size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties)
+		{
+			if (_size == 0)
+				throw ArgumentOutOfRangeException("Vulkan buffer size can not be zero");
+
+			device = _device;
+			allocator = _allocator;
+			size = _size;
+
+			instance = CreateVulkanBufferInstance(_device, _size, usage);
+
+			try
+			{
+				allocation = _allocator->AllocateBuffer(instance, properties);
+			}
+			catch (...)
+			{
+				vkDestroyBuffer(_device, instance, nullptr);
+				throw;
+			}
+		}
+		// Destroys vulkan buffer class instance
+		~Buffer_T()
+		{
+			vkDestroyBuffer(device, instance, nullptr);
+			allocator->Free(allocation);
+		}
+
+		// Returns persistently mapped buffer memory (null if memory is not host visible)
+		void* GetMappedData() { return allocation.mappedData; }
+	};
+
+	// Vulkan buffer class instance
+	typedef Buffer_T* Buffer;
+
+	// Creates a new vulkan buffer class instance
+	static Buffer CreateBufferInstance(VkDevice device, Allocator allocator, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties)
+	{
+		return new Buffer_T(device, allocator, size, usage, properties);
+	}
+	// Destroys vulkan buffer class instance
+	static void DestroyBufferInstance(Buffer instance)
+	{
+		delete instance;
+	}
+}
@@ -1,6 +1,6 @@
 #pragma once
 #include "Vulkan.hpp"
-#include "WindowDeviceInfo.hpp"
+#include "Exceptions.hpp"
 
 #include <vector>
 
@@ -8,8 +8,26 @@ using namespace std;
 
 namespace Vulkan
 {
+	// Allocates a new vulkan command buffer array from the command pool
+	static vector<VkCommandBuffer> AllocateCommandBuffers(VkDevice device, VkCommandPool commandPool, VkCommandBufferLevel level, uint32_t count)
+	{
+		vector<VkCommandBuffer> commandBuffers(count);
+
+		VkCommandBufferAllocateInfo allocInfo = {};
+		allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		allocInfo.commandPool = commandPool;
+		allocInfo.level = level;
+		allocInfo.commandBufferCount = count;
+
+		auto result = vkAllocateCommandBuffers(device, &allocInfo, commandBuffers.data());
+		if (result != VK_SUCCESS)
+			throw VulkanException("Failed to allocate command buffers. Result: " + to_string(result));
+
+		return commandBuffers;
+	}
+
 	// Vulkan command pool class
-	class CommandPool_T // TODO: this is graphics command pool, create universal
+	class CommandPool_T
 	{
 	public:
 		// Vulkan logical device instance
@@ -17,81 +35,85 @@ namespace Vulkan
 
 		// Vulkan command pool instance
 		VkCommandPool instance;
-		// Vulkan command buffer array
-		vector<VkCommandBuffer> commandBuffers;
-
-		// Creates a new vulkan command buffer array
-		static vector<VkCommandBuffer> CreateCommandBuffers(VkCommandPool commandPool, VkDevice device, VkRenderPass renderPass, VkExtent2D extent, VkPipeline pipeline, const vector<VkFramebuffer>& framebuffers)
-		{
-			vector<VkCommandBuffer> commandBuffers(framebuffers.size());
-
-			VkCommandBufferAllocateInfo allocInfo = {};
-			allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-			allocInfo.commandPool = commandPool;
-			allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-			allocInfo.commandBufferCount = (uint32_t)commandBuffers.size();
-
-			auto result = vkAllocateCommandBuffers(device, &allocInfo, commandBuffers.data());
-			if (result != VK_SUCCESS)
-				throw VulkanException("Failed to allocate command buffers. Result: " + to_string(result));
-
-			for (size_t i = 0; i < commandBuffers.size(); i++)
-			{
-				VkCommandBufferBeginInfo beginInfo = {};
-				beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-				beginInfo.flags = 0; // Optional
-				beginInfo.pInheritanceInfo = nullptr; // Optional
-
-				auto result = vkBeginCommandBuffer(commandBuffers[i], &beginInfo);
-				if (result != VK_SUCCESS)
-					throw VulkanException("Failed to begin recording command buffer. Result: " + to_string(result));
-
-				VkRenderPassBeginInfo renderPassInfo = {};
-				renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-				renderPassInfo.renderPass = renderPass;
-				renderPassInfo.framebuffer = framebuffers[i];
-				renderPassInfo.renderArea.offset = { 0, 0 };
-				renderPassInfo.renderArea.extent = extent;
-
-				VkClearValue clearColor = { 0.0f, 0.0f, 0.0f, 1.0f };
-				renderPassInfo.clearValueCount = 1;
-				renderPassInfo.pClearValues = &clearColor;
-
-				vkCmdBeginRenderPass(commandBuffers[i], &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-				vkCmdBindPipeline(commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
-				vkCmdDraw(commandBuffers[i], 3, 1, 0, 0);
-				vkCmdEndRenderPass(commandBuffers[i]);
-
-				result = vkEndCommandBuffer(commandBuffers[i]);
-				if (result != VK_SUCCESS)
-					throw VulkanException("Failed to record command buffer. Result: " + to_string(result));
-			}
-
-			return commandBuffers;
-		}
+		// Vulkan command buffer (reused after each pool reset)
+		VkCommandBuffer commandBuffer;
 
 	public:
-		// Creates a new vulkan command buffer class instance
-		CommandPool_T(VkDevice _device, WindowDeviceInfo deviceInfo, VkRenderPass renderPass, VkExtent2D extent, VkPipeline pipeline, const vector<VkFramebuffer>& framebuffers)
+		// Creates a new vulkan command pool class instance
+		CommandPool_T(VkDevice _device, uint32_t queueFamilyIndex, VkCommandPoolCreateFlags flags, VkCommandBufferLevel level)
 		{
 			device = _device;
 
 			VkCommandPoolCreateInfo poolInfo = {};
 			poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
-			poolInfo.queueFamilyIndex = deviceInfo->GetGraphicsFamily();
-			poolInfo.flags = 0; // Optional
+			poolInfo.queueFamilyIndex = queueFamilyIndex;
+			poolInfo.flags = flags;
 
 			auto result = vkCreateCommandPool(_device, &poolInfo, nullptr, &instance);
 			if (result != VK_SUCCESS)
 				throw VulkanException("Failed to create command pool. Result: " + to_string(result));
 
-			commandBuffers = CreateCommandBuffers(instance, _device, renderPass, extent, pipeline, framebuffers);
+			commandBuffer = AllocateCommandBuffers(_device, instance, level, 1)[0];
 		}
-		// Destroys vulkan command buffer class instance
+		// Destroys vulkan command pool class instance
 		~CommandPool_T()
 		{
 			vkDestroyCommandPool(device, instance, nullptr);
 		}
+
+		// Resets command pool and all allocated command buffers at once
+		void Reset()
+		{
+			auto result = vkResetCommandPool(device, instance, 0);
+			if (result != VK_SUCCESS)
+				throw VulkanException("Failed to reset command pool. Result: " + to_string(result));
+		}
+
+		// Resets command pool and begins primary command buffer recording (one time submit)
+		VkCommandBuffer Begin()
+		{
+			Reset();
+
+			VkCommandBufferBeginInfo beginInfo = {};
+			beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+			beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+			beginInfo.pInheritanceInfo = nullptr; // Optional
+
+			auto result = vkBeginCommandBuffer(commandBuffer, &beginInfo);
+			if (result != VK_SUCCESS)
+				throw VulkanException("Failed to begin recording command buffer. Result: " + to_string(result));
+
+			return commandBuffer;
+		}
+		// Resets command pool and begins secondary command buffer recording (inside the render pass)
+		VkCommandBuffer Begin(VkRenderPass renderPass, uint32_t subpass, VkFramebuffer framebuffer)
+		{
+			Reset();
+
+			VkCommandBufferInheritanceInfo inheritanceInfo = {};
+			inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+			inheritanceInfo.renderPass = renderPass;
+			inheritanceInfo.subpass = subpass;
+			inheritanceInfo.framebuffer = framebuffer;
+
+			VkCommandBufferBeginInfo beginInfo = {};
+			beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+			beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+			beginInfo.pInheritanceInfo = &inheritanceInfo;
+
+			auto result = vkBeginCommandBuffer(commandBuffer, &beginInfo);
+			if (result != VK_SUCCESS)
+				throw VulkanException("Failed to begin recording secondary command buffer. Result: " + to_string(result));
+
+			return commandBuffer;
+		}
+		// Ends command buffer recording
+		void End()
+		{
+			auto result = vkEndCommandBuffer(commandBuffer);
+			if (result != VK_SUCCESS)
+				throw VulkanException("Failed to record command buffer. Result: " + to_string(result));
+		}
 	};
 
 
@@ -99,9 +121,9 @@ namespace Vulkan
 	typedef CommandPool_T* CommandPool;
 
 	// Creates a new vulkan command pool class instance
-	static CommandPool CreateCommandPoolInstance(VkDevice device, WindowDeviceInfo deviceInfo, VkRenderPass renderPass, VkExtent2D extent, VkPipeline pipeline, const vector<VkFramebuffer>& framebuffers)
+	static CommandPool CreateCommandPoolInstance(VkDevice device, uint32_t queueFamilyIndex, VkCommandPoolCreateFlags flags, VkCommandBufferLevel level)
 	{
-		return new CommandPool_T(device, deviceInfo, renderPass, extent, pipeline, framebuffers);
+		return new CommandPool_T(device, queueFamilyIndex, flags, level);
 	}
 	// Destroys vulkan command pool class instance
 	static void DestroyCommandPoolInstance(CommandPool instance)
@@ -103,6 +103,9 @@ namespace Vulkan
 			deviceInfo = _deviceInfo;
 			physicalDevice = FindMostSuitablePhysicalDevice(vkInstance, _deviceInfo);
 
+			// Device information contains values of the last enumerated device
+			deviceInfo->UpdateValues(physicalDevice);
+
 			auto queueCreateInfos = deviceInfo->GetQueueCreateInfos();
 			instance = CreateLogicalDevice(physicalDevice, queueCreateInfos, validationLayers, extensions);
 		}
@@ -0,0 +1,232 @@
+
+// Copyright 2019 Nikita Fediuchin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+#include "Renderer.hpp"
+#include "HeadlessDeviceInfo.hpp"
+#include "Image.hpp"
+#include "RenderPass.hpp"
+#include "CommandPool.hpp"
+#include "Synchronization.hpp"
+
+#include <thread>
+
+namespace Vulkan
+{
+	// Headless render target color format (tightly packed RGBA8 readback)
+	const VkFormat HeadlessColorFormat = VK_FORMAT_R8G8B8A8_UNORM;
+
+	// Vulkan headless render target class (no GLFW window, surface or swapchain)
+	// Each frame in flight renders to its own device local color image, which is copied to its readback slot.
+	class Headless_T : public Renderer_T
+	{
+	protected:
+		// Vulkan headless device information
+		HeadlessDeviceInfo deviceInfo;
+		// Render target extent
+		VkExtent2D extent;
+
+		// Color image array (one per frame in flight)
+		vector<Image> colorImages;
+		// Vulkan color image render pass instance (framebuffer per frame in flight)
+		RenderPass renderPass;
+		// Vulkan command pool array (one transient pool per frame in flight)
+		vector<CommandPool> commandPools;
+		// Upload finished semaphore array (one per frame in flight)
+		vector<VkSemaphore> uploadFinishedSemaphores;
+		// Frame in flight fence array (one per frame in flight)
+		vector<VkFence> inFlightFences;
+
+		// Last submitted frame in flight index
+		uint32_t lastFrame;
+
+		// Records frame draw and readback copy commands
+		virtual void RecordCommands(VkCommandBuffer commandBuffer, uint32_t frameIndex)
+		{
+			VkRenderPassBeginInfo renderPassInfo = {};
+			renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+			renderPassInfo.renderPass = renderPass->instance;
+			renderPassInfo.framebuffer = renderPass->framebuffers[frameIndex];
+			renderPassInfo.renderArea.offset = { 0, 0 };
+			renderPassInfo.renderArea.extent = extent;
+
+			auto clearColor = GetClearValue();
+			renderPassInfo.clearValueCount = 1;
+			renderPassInfo.pClearValues = &clearColor;
+
+			vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+			RecordTriangle(commandBuffer, extent);
+			vkCmdEndRenderPass(commandBuffer);
+
+			// Render pass leaves the image in the transfer source layout
+			readback->Record(commandBuffer, frameIndex, colorImages[frameIndex]->instance, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+		}
+
+	public:
+		// Creates a new vulkan headless render target class instance (waits for the graphics pipeline compilation)
+		Headless_T(VkExtent2D _extent, string appName, uint32_t appVersion, const vector<const char*>& vulkanExtensions, const vector<const char*>& validationLayers, const vector<const char*>& deviceExtensions, uint32_t _inFlightFrameCount) :
+			Renderer_T(_inFlightFrameCount)
+		{
+			if (_extent.width == 0 || _extent.height == 0)
+				throw ArgumentOutOfRangeException("Vulkan headless render target extent can not be zero");
+
+			extent = _extent;
+			lastFrame = UINT32_MAX;
+
+			instance = CreateVulkanInstance(appName, appVersion, vulkanExtensions, validationLayers, debug);
+			deviceInfo = CreateHeadlessDeviceInfoInstance(HeadlessColorFormat, deviceExtensions);
+			device = CreateDeviceInstance(deviceInfo, instance, VK_NULL_HANDLE, validationLayers, deviceExtensions);
+			CreateDeviceResources(deviceInfo->GetGraphicsFamily(), deviceInfo->GetTransferFamily());
+
+			auto logicalDevice = device->GetInstance();
+			vector<VkImageView> imageViews(_inFlightFrameCount);
+
+			readback = CreateReadbackInstance(logicalDevice, allocator, _extent, HeadlessColorFormat, _inFlightFrameCount);
+			colorImages.resize(_inFlightFrameCount);
+			commandPools.resize(_inFlightFrameCount);
+			uploadFinishedSemaphores.resize(_inFlightFrameCount);
+			inFlightFences.resize(_inFlightFrameCount);
+
+			for (uint32_t i = 0; i < _inFlightFrameCount; i++)
+			{
+				colorImages[i] = CreateImageInstance(logicalDevice, allocator, _extent, HeadlessColorFormat,
+					VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+				imageViews[i] = colorImages[i]->view;
+
+				commandPools[i] = CreateCommandPoolInstance(logicalDevice, deviceInfo->GetGraphicsFamily(), VK_COMMAND_POOL_CREATE_TRANSIENT_BIT, VK_COMMAND_BUFFER_LEVEL_PRIMARY);
+				uploadFinishedSemaphores[i] = CreateSemaphoreInstance(logicalDevice);
+				inFlightFences[i] = CreateFenceInstance(logicalDevice, VK_FENCE_CREATE_SIGNALED_BIT);
+			}
+
+			renderPass = CreateRenderPassInstance(logicalDevice, HeadlessColorFormat, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, _extent, imageViews);
+			CreateTriangle(renderPass->instance);
+
+			// Headless frames are compared and saved, so the triangle should be in the first frame
+			while (!graphicsPipeline->IsReady() && !graphicsPipeline->IsFailed())
+				this_thread::sleep_for(chrono::milliseconds(1));
+		}
+		// Destroys vulkan headless render target class instance
+		virtual ~Headless_T()
+		{
+			auto logicalDevice = device->GetInstance();
+			vkDeviceWaitIdle(logicalDevice);
+
+			for (uint32_t i = 0; i < inFlightFrameCount; i++)
+			{
+				vkDestroyFence(logicalDevice, inFlightFences[i], nullptr);
+				vkDestroySemaphore(logicalDevice, uploadFinishedSemaphores[i], nullptr);
+				DestroyCommandPoolInstance(commandPools[i]);
+			}
+
+			DestroyRenderPassInstance(renderPass);
+
+			for (uint32_t i = 0; i < inFlightFrameCount; i++)
+				DestroyImageInstance(colorImages[i]);
+
+			DestroyDeviceResources();
+			DestroyHeadlessDeviceInfoInstance(deviceInfo);
+			DestroyInstance();
+		}
+
+		// Returns render target extent
+		VkExtent2D GetExtent() { return extent; }
+		// Returns render target color format
+		VkFormat GetColorFormat() { return HeadlessColorFormat; }
+		// Returns frame pixel data size in bytes (tightly packed RGBA8 rows)
+		size_t GetFrameSize() { return readback->GetFrameSize(); }
+
+		// Draws a new frame from the render packet (packet framebuffer size is ignored)
+		void DrawFrame(const RenderPacket& packet)
+		{
+			auto logicalDevice = device->GetInstance();
+			auto inFlightFence = inFlightFences[currentFrame];
+			auto uploadFinishedSemaphore = uploadFinishedSemaphores[currentFrame];
+
+			if (graphicsPipeline->IsFailed())
+				throw VulkanException("Failed to compile graphics pipeline. " + graphicsPipeline->GetError());
+
+			auto waitStartTime = chrono::high_resolution_clock::now();
+			vkWaitForFences(logicalDevice, 1, &inFlightFence, VK_TRUE, UINT64_MAX);
+			frameWaitTime = chrono::duration<double>(chrono::high_resolution_clock::now() - waitStartTime).count();
+
+			// Frame fence is signaled, so the slot pixels captured by the older frame are ready
+			CollectCapture(currentFrame);
+
+			// Frame fence is signaled, so the whole frame command pool can be reset
+			auto recordStartTime = chrono::high_resolution_clock::now();
+			auto commandPool = commandPools[currentFrame];
+			auto commandBuffer = commandPool->Begin();
+
+			// Frame fence is signaled, so the previous wait on the upload semaphore is finished too
+			uploader->Retire();
+			auto isUploadWaiting = uploader->Flush(commandBuffer, uploadFinishedSemaphore);
+
+			memcpy(frameClearColor, packet.clearColor, sizeof(frameClearColor));
+			RecordCommands(commandBuffer, currentFrame);
+			commandPool->End();
+
+			if (packet.isCaptured && frameEncoder)
+				readback->SetCaptured(currentFrame, packet.frameIndex);
+			frameRecordTime = chrono::duration<double>(chrono::high_resolution_clock::now() - recordStartTime).count();
+
+			VkSubmitInfo submitInfo = {};
+			submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+
+			VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+			submitInfo.waitSemaphoreCount = isUploadWaiting ? 1 : 0;
+			submitInfo.pWaitSemaphores = &uploadFinishedSemaphore;
+			submitInfo.pWaitDstStageMask = &waitStage;
+			submitInfo.commandBufferCount = 1;
+			submitInfo.pCommandBuffers = &commandBuffer;
+
+			vkResetFences(logicalDevice, 1, &inFlightFence);
+
+			auto result = vkQueueSubmit(graphicsQueue, 1, &submitInfo, inFlightFence);
+			if (result != VK_SUCCESS)
+				throw VulkanException("Failed to submit draw command buffer. Result: " + to_string(result));
+
+			RecordSubmitLatency(packet);
+
+			lastFrame = currentFrame;
+			currentFrame = (currentFrame + 1) % inFlightFrameCount;
+		}
+
+		// Waits for the last submitted frame and copies its pixels (tightly packed RGBA8 rows, top to bottom)
+		void ReadFrame(void* pixels)
+		{
+			if (lastFrame == UINT32_MAX)
+				throw VulkanException("Failed to read headless frame, no frame was drawn");
+
+			auto logicalDevice = device->GetInstance();
+			vkWaitForFences(logicalDevice, 1, &inFlightFences[lastFrame], VK_TRUE, UINT64_MAX);
+
+			memcpy(pixels, readback->GetData(lastFrame), GetFrameSize());
+		}
+	};
+
+	// Vulkan headless render target class instance
+	typedef Headless_T* Headless;
+
+	// Creates a new vulkan headless render target class instance
+	static Headless CreateHeadlessInstance(VkExtent2D extent, string appName, uint32_t appVersion, const vector<const char*>& vulkanExtensions, const vector<const char*>& validationLayers, const vector<const char*>& deviceExtensions, uint32_t inFlightFrameCount)
+	{
+		return new Headless_T(extent, appName, appVersion, vulkanExtensions, validationLayers, deviceExtensions, inFlightFrameCount);
+	}
+	// Destroys vulkan headless render target class instance
+	static void DestroyHeadlessInstance(Headless instance)
+	{
+		delete instance;
+	}
+}
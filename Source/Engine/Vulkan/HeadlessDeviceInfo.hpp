@@ -0,0 +1,179 @@
+
+// Copyright 2019 Nikita Fediuchin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+#include "DeviceInfo.hpp"
+
+#include <optional>
+
+namespace Vulkan
+{
+	// Headless device information container class (no surface, any device with a graphics queue)
+	// CPU implementations (software ICDs like lavapipe) are accepted with the lowest score.
+	struct HeadlessDeviceInfo_T : public DeviceInfo_T
+	{
+	protected:
+		// Render target color format
+		VkFormat colorFormat;
+		// Physical device extension array
+		vector<const char*> extensions;
+
+		// Queue family priority instance
+		float* queuePriority;
+		// Graphics queue family
+		optional<uint32_t> graphicsFamily;
+		// Transfer only queue family (dedicated DMA engine, optional)
+		optional<uint32_t> transferFamily;
+		// Is color format usable as color attachment and copy source
+		bool isColorFormatSupported;
+
+		// Updates device queue families
+		void UpdateQueueFamilies(VkPhysicalDevice physicalDevice)
+		{
+			uint32_t queueFamilyCount = 0;
+			vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+
+			vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+			vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
+
+			graphicsFamily.reset();
+			transferFamily.reset();
+
+			for (uint32_t i = 0; i < queueFamilyCount; i++)
+			{
+				auto queueFamily = queueFamilies[i];
+
+				if (!graphicsFamily.has_value() && (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT))
+					graphicsFamily = i;
+
+				// Prefer pure transfer family over the async compute one
+				if ((queueFamily.queueFlags & VK_QUEUE_TRANSFER_BIT) && !(queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT))
+				{
+					if (!transferFamily.has_value() || !(queueFamily.queueFlags & VK_QUEUE_COMPUTE_BIT))
+						transferFamily = i;
+				}
+			}
+		}
+		// Updates color format support
+		void UpdateColorFormat(VkPhysicalDevice physicalDevice)
+		{
+			VkFormatProperties properties;
+			vkGetPhysicalDeviceFormatProperties(physicalDevice, colorFormat, &properties);
+
+			auto requiredFeatures = VK_FORMAT_FEATURE_COLOR_ATTACHMENT_BIT | VK_FORMAT_FEATURE_TRANSFER_SRC_BIT;
+			isColorFormatSupported = (properties.optimalTilingFeatures & requiredFeatures) == requiredFeatures;
+		}
+
+	public:
+		// Creates a new headless device information container instance
+		HeadlessDeviceInfo_T(VkFormat _colorFormat, const vector<const char*>& _extensions)
+		{
+			colorFormat = _colorFormat;
+			extensions = _extensions;
+			isColorFormatSupported = false;
+
+			queuePriority = new float[1]{ 1.0f };
+		}
+		// Destroys headless device information container instance
+		~HeadlessDeviceInfo_T()
+		{
+			delete[] queuePriority;
+		}
+
+		// Returns render target color format
+		VkFormat GetColorFormat() { return colorFormat; }
+		// Returns physical device extension array
+		vector<const char*> GetExtensions() { return extensions; }
+
+		// Returns graphics family value
+		uint32_t GetGraphicsFamily() { return graphicsFamily.value(); }
+		// Returns true if device has a dedicated transfer only family
+		bool HasTransferFamily() { return transferFamily.has_value(); }
+		// Returns transfer family value (graphics family if there is no dedicated one)
+		uint32_t GetTransferFamily() { return transferFamily.has_value() ? transferFamily.value() : graphicsFamily.value(); }
+
+		// Updates device information container values
+		void UpdateValues(VkPhysicalDevice physicalDevice)
+		{
+			UpdateQueueFamilies(physicalDevice);
+			UpdateColorFormat(physicalDevice);
+		}
+
+		// Returns true if device information is valid
+		bool IsValid(VkPhysicalDevice physicalDevice)
+		{
+			try
+			{
+				CheckDeviceExtensionsSupport(physicalDevice, extensions);
+				return graphicsFamily.has_value() && isColorFormatSupported;
+			}
+			catch (VulkanException&)
+			{
+				return false;
+			}
+		}
+
+		// Returns physical device score
+		int GetPhysicalDeviceScore(VkPhysicalDevice physicalDevice)
+		{
+			if (!IsValid(physicalDevice))
+				return 0;
+
+			VkPhysicalDeviceProperties deviceProperties;
+			vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+
+			if (deviceProperties.deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU)
+				return 3;
+			else if (deviceProperties.deviceType == VK_PHYSICAL_DEVICE_TYPE_CPU)
+				return 1;
+			else
+				return 2;
+		}
+
+		// Returns device queue create information array
+		vector<VkDeviceQueueCreateInfo> GetQueueCreateInfos()
+		{
+			vector<VkDeviceQueueCreateInfo> queueCreateInfos = {};
+
+			VkDeviceQueueCreateInfo queueCreateInfo = {};
+			queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+			queueCreateInfo.queueCount = 1;
+			queueCreateInfo.pQueuePriorities = queuePriority;
+			queueCreateInfo.queueFamilyIndex = graphicsFamily.value();
+			queueCreateInfos.push_back(queueCreateInfo);
+
+			if (transferFamily.has_value())
+			{
+				queueCreateInfo.queueFamilyIndex = transferFamily.value();
+				queueCreateInfos.push_back(queueCreateInfo);
+			}
+
+			return queueCreateInfos;
+		}
+	};
+
+	typedef HeadlessDeviceInfo_T* HeadlessDeviceInfo;
+
+	// Creates a new vulkan headless device information container instance
+	static HeadlessDeviceInfo CreateHeadlessDeviceInfoInstance(VkFormat colorFormat, const vector<const char*>& extensions)
+	{
+		return new HeadlessDeviceInfo_T(colorFormat, extensions);
+	}
+	// Destroys vulkan headless device information container instance
+	static void DestroyHeadlessDeviceInfoInstance(HeadlessDeviceInfo instance)
+	{
+		delete instance;
+	}
+}
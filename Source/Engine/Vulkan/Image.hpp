@@ -0,0 +1,148 @@
+
+// Copyright 2019 Nikita Fediuchin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+#include "Vulkan.hpp"
+#include "Allocator.hpp"
+#include "Exceptions.hpp"
+
+using namespace std;
+
+namespace Vulkan
+{
+	// Creates a new vulkan 2D image instance (optimal tiling, exclusive sharing mode)
+	static VkImage CreateVulkanImageInstance(VkDevice device, VkExtent2D extent, VkFormat format, VkImageUsageFlags usage)
+	{
+		VkImageCreateInfo imageInfo = {};
+		imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		imageInfo.imageType = VK_IMAGE_TYPE_2D;
+		imageInfo.format = format;
+		imageInfo.extent = { extent.width, extent.height, 1 };
+		imageInfo.mipLevels = 1;
+		imageInfo.arrayLayers = 1;
+		imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+		imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+		imageInfo.usage = usage;
+		imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+		VkImage image;
+		auto result = vkCreateImage(device, &imageInfo, nullptr, &image);
+
+		if (result != VK_SUCCESS)
+			throw VulkanException("Failed to create image. Result: " + to_string(result));
+
+		return image;
+	}
+	// Creates a new vulkan 2D color image view instance
+	static VkImageView CreateVulkanImageViewInstance(VkDevice device, VkImage image, VkFormat format)
+	{
+		VkImageViewCreateInfo viewInfo = {};
+		viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+		viewInfo.image = image;
+		viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+		viewInfo.format = format;
+		viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		viewInfo.subresourceRange.baseMipLevel = 0;
+		viewInfo.subresourceRange.levelCount = 1;
+		viewInfo.subresourceRange.baseArrayLayer = 0;
+		viewInfo.subresourceRange.layerCount = 1;
+
+		VkImageView imageView;
+		auto result = vkCreateImageView(device, &viewInfo, nullptr, &imageView);
+
+		if (result != VK_SUCCESS)
+			throw VulkanException("Failed to create image view. Result: " + to_string(result));
+
+		return imageView;
+	}
+
+	// Vulkan 2D color image class (single mip level and layer)
+	class Image_T
+	{
+	public:
+		// Vulkan logical device instance
+		VkDevice device;
+		// Vulkan device memory allocator instance
+		Allocator allocator;
+
+		// Vulkan image instance
+		VkImage instance;
+		// Vulkan image view instance
+		VkImageView view;
+		// Vulkan image device memory allocation
+		Allocation allocation;
+		// Image extent
+		VkExtent2D extent;
+		// Image format
+		VkFormat format;
+
+		// Creates a new vulkan image class instance
+		Image_T(VkDevice _device, Allocator _allocator, VkExtent2D _extent, VkFormat _format, VkImageUsageFlags usage, VkMemoryPropertyFlags properties)
+		{
+			if (_extent.width == 0 || _extent.height == 0)
+				throw ArgumentOutOfRangeException("Vulkan image extent can not be zero");
+
+			device = _device;
+			allocator = _allocator;
+			extent = _extent;
+			format = _format;
+
+			instance = CreateVulkanImageInstance(_device, _extent, _format, usage);
+
+			try
+			{
+				allocation = _allocator->AllocateImage(instance, properties, false);
+			}
+			catch (...)
+			{
+				vkDestroyImage(_device, instance, nullptr);
+				throw;
+			}
+
+			try
+			{
+				view = CreateVulkanImageViewInstance(_device, instance, _format);
+			}
+			catch (...)
+			{
+				vkDestroyImage(_device, instance, nullptr);
+				_allocator->Free(allocation);
+				throw;
+			}
+		}
+		// Destroys vulkan image class instance
+		~Image_T()
+		{
+			vkDestroyImageView(device, view, nullptr);
+			vkDestroyImage(device, instance, nullptr);
+			allocator->Free(allocation);
+		}
+	};
+
+	// Vulkan image class instance
+	typedef Image_T* Image;
+
+	// Creates a new vulkan image class instance
+	static Image CreateImageInstance(VkDevice device, Allocator allocator, VkExtent2D extent, VkFormat format, VkImageUsageFlags usage, VkMemoryPropertyFlags properties)
+	{
+		return new Image_T(device, allocator, extent, format, usage, properties);
+	}
+	// Destroys vulkan image class instance
+	static void DestroyImageInstance(Image instance)
+	{
+		delete instance;
+	}
+}
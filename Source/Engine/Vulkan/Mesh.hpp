@@ -0,0 +1,186 @@
+
+// Copyright 2019 Nikita Fediuchin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+#include "Vulkan.hpp"
+#include "Buffer.hpp"
+#include "Uploader.hpp"
+#include "Exceptions.hpp"
+#include "VertexLayout.hpp"
+
+#include <vector>
+
+using namespace std;
+
+namespace Vulkan
+{
+	// Vulkan mesh class (device local vertex streams and optional index buffer)
+	class Mesh_T
+	{
+	protected:
+		// Vertex layout description
+		VertexLayout vertexLayout;
+		// Vertex stream buffer array (one per layout binding)
+		vector<Buffer> vertexBuffers;
+		// Vertex stream buffer instance array (for binding)
+		vector<VkBuffer> vertexBufferInstances;
+		// Vertex stream buffer offset array (always zero)
+		vector<VkDeviceSize> vertexBufferOffsets;
+		// Index buffer (null if mesh is not indexed)
+		Buffer indexBuffer;
+		// Index type
+		VkIndexType indexType;
+
+		// Vertex count
+		uint32_t vertexCount;
+		// Index count
+		uint32_t indexCount;
+		// Upload batch value (mesh data is valid when the batch is finished)
+		uint64_t uploadValue;
+
+		// Destroys created vertex and index buffers
+		void DestroyBuffers()
+		{
+			if (indexBuffer)
+				DestroyBufferInstance(indexBuffer);
+
+			for (auto vertexBuffer : vertexBuffers)
+				DestroyBufferInstance(vertexBuffer);
+
+			indexBuffer = nullptr;
+			vertexBuffers.clear();
+			vertexBufferInstances.clear();
+			vertexBufferOffsets.clear();
+		}
+
+	public:
+		// Creates a new vulkan mesh class instance (data is uploaded with the next frame)
+		Mesh_T(VkDevice device, Allocator allocator, Uploader uploader, const VertexLayout& _vertexLayout, const vector<const void*>& streamData, uint32_t _vertexCount, const void* indexData, uint32_t _indexCount, VkIndexType _indexType)
+		{
+			if (streamData.size() != _vertexLayout.GetStreamCount())
+				throw ArgumentException("Mesh stream data count should be equal to the vertex layout stream count");
+			if (_vertexCount == 0)
+				throw ArgumentOutOfRangeException("Mesh vertex count can not be zero");
+
+			vertexLayout = _vertexLayout;
+			vertexCount = _vertexCount;
+			indexCount = indexData ? _indexCount : 0;
+			indexType = _indexType;
+			indexBuffer = nullptr;
+			uploadValue = 0;
+
+			auto indexSize = static_cast<VkDeviceSize>(indexCount) * (_indexType == VK_INDEX_TYPE_UINT16 ? 2 : 4);
+
+			// Uploads are validated first, so buffers are never destroyed after their copies are recorded
+			for (uint32_t i = 0; i < streamData.size(); i++)
+			{
+				if (!streamData[i])
+					throw ArgumentNullException("Mesh stream data is null");
+				if (static_cast<VkDeviceSize>(_vertexLayout.GetStride(i)) * _vertexCount > uploader->GetStagingSize())
+					throw ArgumentOutOfRangeException("Mesh stream data is bigger than the staging buffer");
+			}
+
+			if (indexSize > uploader->GetStagingSize())
+				throw ArgumentOutOfRangeException("Mesh index data is bigger than the staging buffer");
+
+			vertexBuffers.reserve(streamData.size());
+			vertexBufferInstances.reserve(streamData.size());
+			vertexBufferOffsets.reserve(streamData.size());
+
+			try
+			{
+				for (uint32_t i = 0; i < streamData.size(); i++)
+				{
+					auto size = static_cast<VkDeviceSize>(_vertexLayout.GetStride(i)) * _vertexCount;
+					auto buffer = CreateBufferInstance(device, allocator, size, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+					vertexBuffers.push_back(buffer);
+					vertexBufferInstances.push_back(buffer->instance);
+					vertexBufferOffsets.push_back(0);
+				}
+
+				if (indexCount > 0)
+					indexBuffer = CreateBufferInstance(device, allocator, indexSize, VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+			}
+			catch (...)
+			{
+				DestroyBuffers();
+				throw;
+			}
+
+			for (uint32_t i = 0; i < streamData.size(); i++)
+			{
+				uploadValue = uploader->UploadBuffer(vertexBuffers[i]->instance, 0, streamData[i], vertexBuffers[i]->size,
+					VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT);
+			}
+
+			if (indexBuffer)
+				uploadValue = uploader->UploadBuffer(indexBuffer->instance, 0, indexData, indexSize, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_INDEX_READ_BIT);
+		}
+		// Destroys vulkan mesh class instance (mesh should not be used by the frames in flight)
+		~Mesh_T()
+		{
+			DestroyBuffers();
+		}
+
+		// Returns vertex layout description
+		const VertexLayout& GetVertexLayout() { return vertexLayout; }
+		// Returns vertex count
+		uint32_t GetVertexCount() { return vertexCount; }
+		// Returns index count (zero if mesh is not indexed)
+		uint32_t GetIndexCount() { return indexCount; }
+		// Returns upload batch value
+		uint64_t GetUploadValue() { return uploadValue; }
+
+		// Binds first vertex streams and index buffer (depth passes bind only the position stream)
+		void Bind(VkCommandBuffer commandBuffer, uint32_t streamCount)
+		{
+			if (streamCount == 0 || streamCount > vertexBufferInstances.size())
+				throw ArgumentOutOfRangeException("Mesh stream count is out of range");
+
+			vkCmdBindVertexBuffers(commandBuffer, 0, streamCount, vertexBufferInstances.data(), vertexBufferOffsets.data());
+
+			if (indexBuffer)
+				vkCmdBindIndexBuffer(commandBuffer, indexBuffer->instance, 0, indexType);
+		}
+		// Binds all vertex streams and index buffer
+		void Bind(VkCommandBuffer commandBuffer)
+		{
+			Bind(commandBuffer, static_cast<uint32_t>(vertexBufferInstances.size()));
+		}
+		// Records mesh draw command (indexed if mesh has indices)
+		void Draw(VkCommandBuffer commandBuffer, uint32_t instanceCount)
+		{
+			if (indexBuffer)
+				vkCmdDrawIndexed(commandBuffer, indexCount, instanceCount, 0, 0, 0);
+			else
+				vkCmdDraw(commandBuffer, vertexCount, instanceCount, 0, 0);
+		}
+	};
+
+	// Vulkan mesh class instance
+	typedef Mesh_T* Mesh;
+
+	// Creates a new vulkan mesh class instance
+	static Mesh CreateMeshInstance(VkDevice device, Allocator allocator, Uploader uploader, const VertexLayout& vertexLayout, const vector<const void*>& streamData, uint32_t vertexCount, const void* indexData, uint32_t indexCount, VkIndexType indexType)
+	{
+		return new Mesh_T(device, allocator, uploader, vertexLayout, streamData, vertexCount, indexData, indexCount, indexType);
+	}
+	// Destroys vulkan mesh class instance
+	static void DestroyMeshInstance(Mesh instance)
+	{
+		delete instance;
+	}
+}
@@ -2,9 +2,12 @@
 #include "Vulkan.hpp"
 #include "Shader.hpp"
 #include "Exceptions.hpp"
-#include "WindowDeviceInfo.hpp"
+#include "PipelineState.hpp"
+#include "VertexLayout.hpp"
 
+#include <string>
 #include <vector>
+#include <chrono>
 
 using namespace std;
 
@@ -32,115 +35,74 @@ namespace Vulkan
 		vkDestroyShaderModule(device, instance, nullptr);
 	}
 
-	// Vulkan graphics pipeline class
-	class Pipeline_T
+	// Vulkan graphics pipeline description
+	struct PipelineInfo
 	{
-	public:
-		// Vulkan logical device instance
-		VkDevice device;
-
-		// Vulkan pipeline instance
-		VkPipeline instance;
+		// Vertex shader SPIR-V file path
+		string vertexShaderPath;
+		// Fragment shader SPIR-V file path
+		string fragmentShaderPath;
 		// Vulkan render pass instance
 		VkRenderPass renderPass;
-		// Vulkan pipeline layout instance
-		VkPipelineLayout layout;
-		// Vulkan pipeline framebuffer array
-		vector<VkFramebuffer> framebuffers;
+		// Fixed function state
+		PipelineState state;
+		// Vertex input layout (empty if vertices are generated in the shader)
+		VertexLayout vertexLayout;
 
-		// Creates a new vulkan render pass instance
-		static VkRenderPass CreateRenderPassInstance(VkDevice device, WindowDeviceInfo deviceInfo)
+		// Returns graphics pipeline description hash
+		uint64_t GetHash() const
 		{
-			VkAttachmentDescription colorAttachment = {};
-			colorAttachment.format = deviceInfo->GetSurfaceFormat().format;
-			colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
-			colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-			colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-			colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-			colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-			colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-			colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
-
-			VkAttachmentReference colorAttachmentRef = {};
-			colorAttachmentRef.attachment = 0;
-			colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-
-			VkSubpassDescription subpass = {};
-			subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-			subpass.colorAttachmentCount = 1;
-			subpass.pColorAttachments = &colorAttachmentRef;
-
-			VkSubpassDependency dependency = {};
-			dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-			dependency.dstSubpass = 0;
-			dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-			dependency.srcAccessMask = 0;
-			dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-			dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-
-			VkRenderPassCreateInfo renderPassInfo = {};
-			renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-			renderPassInfo.attachmentCount = 1;
-			renderPassInfo.pAttachments = &colorAttachment;
-			renderPassInfo.subpassCount = 1;
-			renderPassInfo.pSubpasses = &subpass;
-			renderPassInfo.dependencyCount = 1;
-			renderPassInfo.pDependencies = &dependency;
-
-			VkRenderPass renderPass;
-			auto result = vkCreateRenderPass(device, &renderPassInfo, nullptr, &renderPass);
-
-			if (result != VK_SUCCESS)
-				throw VulkanException("Failed to create render pass. Result: " + to_string(result));
-
-			return renderPass;
+			auto hash = state.GetHash(HashSeed);
+			hash = vertexLayout.GetHash(hash);
+			hash = HashBytes(vertexShaderPath.data(), vertexShaderPath.size(), hash);
+			hash = HashBytes(fragmentShaderPath.data(), fragmentShaderPath.size(), hash);
+			return HashBytes(&renderPass, sizeof(VkRenderPass), hash);
 		}
-		// Creates a new vulkan graphics pipeline framebuffer array
-		static vector<VkFramebuffer> CreateFramebuffers(VkDevice device, VkRenderPass renderPass, VkExtent2D extent, const vector<VkImageView>& imageViews)
-		{
-			vector<VkFramebuffer> framebuffers(imageViews.size());
-
-			for (size_t i = 0; i < imageViews.size(); i++)
-			{
-				VkImageView attachments[] =
-				{
-					imageViews[i]
-				};
-
-				VkFramebufferCreateInfo framebufferInfo = {};
-				framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-				framebufferInfo.renderPass = renderPass;
-				framebufferInfo.attachmentCount = 1;
-				framebufferInfo.pAttachments = attachments;
-				framebufferInfo.width = extent.width;
-				framebufferInfo.height = extent.height;
-				framebufferInfo.layers = 1;
-
-				auto result = vkCreateFramebuffer(device, &framebufferInfo, nullptr, &framebuffers[i]);
-				if (result != VK_SUCCESS)
-					throw VulkanException("Failed to create framebuffer. Result: " + to_string(result));
-			}
 
-			return framebuffers;
+		// Returns true if graphics pipeline descriptions are equal
+		bool operator==(const PipelineInfo& other) const
+		{
+			return state == other.state &&
+				vertexLayout == other.vertexLayout &&
+				renderPass == other.renderPass &&
+				vertexShaderPath == other.vertexShaderPath &&
+				fragmentShaderPath == other.fragmentShaderPath;
 		}
-		// Destroys vulkan graphics pipeline framebuffer array
-		static void DestroyFramebuffers(VkDevice device, const vector<VkFramebuffer>& framebuffers)
+	};
+
+	// Vulkan graphics pipeline description hash function
+	struct PipelineInfoHash
+	{
+		// Returns graphics pipeline description hash
+		size_t operator()(const PipelineInfo& pipelineInfo) const
 		{
-			for (auto framebuffer : framebuffers)
-				vkDestroyFramebuffer(device, framebuffer, nullptr);
+			return static_cast<size_t>(pipelineInfo.GetHash());
 		}
+	};
 
+	// Vulkan graphics pipeline class
+	class Pipeline_T
+	{
 	public:
+		// Vulkan logical device instance
+		VkDevice device;
+
+		// Vulkan pipeline instance
+		VkPipeline instance;
+		// Vulkan pipeline layout instance
+		VkPipelineLayout layout;
+		// Graphics pipeline creation time in seconds
+		double creationTime;
+
 		// Creates a new vulkan graphics pipeline class instance
-		Pipeline_T(VkDevice _device, WindowDeviceInfo deviceInfo, const vector<VkImageView>& swapchainImageViews)
+		Pipeline_T(VkDevice _device, const PipelineInfo& pipelineInfo, VkPipelineCache pipelineCache)
 		{
 			device = _device;
-			renderPass = CreateRenderPassInstance(_device, deviceInfo);
 
-			auto vertShaderBytecode = Shader::ReadBytecode("Shaders/Engine/Unlit.vert.spv");
+			auto vertShaderBytecode = Shader::ReadBytecode(pipelineInfo.vertexShaderPath);
 			auto vertShaderModule = CreateShaderModuleInstance(_device, vertShaderBytecode);
 
-			auto fragShaderBytecode = Shader::ReadBytecode("Shaders/Engine/Unlit.frag.spv");
+			auto fragShaderBytecode = Shader::ReadBytecode(pipelineInfo.fragmentShaderPath);
 			auto fragShaderModule = CreateShaderModuleInstance(_device, fragShaderBytecode);
 
 			VkPipelineShaderStageCreateInfo vertShaderStageInfo = {};
@@ -161,45 +123,39 @@ namespace Vulkan
 
 			VkPipelineVertexInputStateCreateInfo vertexInputInfo = {};
 			vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-			vertexInputInfo.vertexBindingDescriptionCount = 0;
-			vertexInputInfo.pVertexBindingDescriptions = nullptr; // Optional
-			vertexInputInfo.vertexAttributeDescriptionCount = 0;
-			vertexInputInfo.pVertexAttributeDescriptions = nullptr; // Optional
+			vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(pipelineInfo.vertexLayout.bindings.size());
+			vertexInputInfo.pVertexBindingDescriptions = pipelineInfo.vertexLayout.bindings.data();
+			vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(pipelineInfo.vertexLayout.attributes.size());
+			vertexInputInfo.pVertexAttributeDescriptions = pipelineInfo.vertexLayout.attributes.data();
 
 			VkPipelineInputAssemblyStateCreateInfo inputAssembly = {};
 			inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-			inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+			inputAssembly.topology = static_cast<VkPrimitiveTopology>(pipelineInfo.state.topology);
 			inputAssembly.primitiveRestartEnable = VK_FALSE;
 
-			VkViewport viewport = {};
-			viewport.x = 0.0f;
-			viewport.y = 0.0f;
-
-			VkExtent2D extent = deviceInfo->GetSurfaceExtent();
-			viewport.width = (float)extent.width;
-			viewport.height = (float)extent.height;
-			viewport.minDepth = 0.0f;
-			viewport.maxDepth = 1.0f;
-
-			VkRect2D scissor = {};
-			scissor.offset = { 0, 0 };
-			scissor.extent = extent;
-
+			// Viewport and scissor are dynamic, so pipeline survives the swapchain resize
 			VkPipelineViewportStateCreateInfo viewportState = {};
 			viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
 			viewportState.viewportCount = 1;
-			viewportState.pViewports = &viewport;
+			viewportState.pViewports = nullptr;
 			viewportState.scissorCount = 1;
-			viewportState.pScissors = &scissor;
+			viewportState.pScissors = nullptr;
+
+			VkDynamicState dynamicStates[] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+
+			VkPipelineDynamicStateCreateInfo dynamicState = {};
+			dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+			dynamicState.dynamicStateCount = 2;
+			dynamicState.pDynamicStates = dynamicStates;
 
 			VkPipelineRasterizationStateCreateInfo rasterizer = {};
 			rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
-			rasterizer.depthClampEnable = VK_FALSE;
+			rasterizer.depthClampEnable = pipelineInfo.state.depthClampEnable;
 			rasterizer.rasterizerDiscardEnable = VK_FALSE;
-			rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
-			rasterizer.lineWidth = 1.0f;
-			rasterizer.cullMode = VK_CULL_MODE_BACK_BIT;
-			rasterizer.frontFace = VK_FRONT_FACE_CLOCKWISE;
+			rasterizer.polygonMode = static_cast<VkPolygonMode>(pipelineInfo.state.polygonMode);
+			rasterizer.lineWidth = pipelineInfo.state.lineWidth;
+			rasterizer.cullMode = pipelineInfo.state.cullMode;
+			rasterizer.frontFace = static_cast<VkFrontFace>(pipelineInfo.state.frontFace);
 			rasterizer.depthBiasEnable = VK_FALSE;
 			rasterizer.depthBiasConstantFactor = 0.0f; // Optional
 			rasterizer.depthBiasClamp = 0.0f; // Optional
@@ -208,21 +164,21 @@ namespace Vulkan
 			VkPipelineMultisampleStateCreateInfo multisampling = {};
 			multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
 			multisampling.sampleShadingEnable = VK_FALSE;
-			multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+			multisampling.rasterizationSamples = static_cast<VkSampleCountFlagBits>(pipelineInfo.state.sampleCount);
 			multisampling.minSampleShading = 1.0f; // Optional
 			multisampling.pSampleMask = nullptr; // Optional
 			multisampling.alphaToCoverageEnable = VK_FALSE; // Optional
 			multisampling.alphaToOneEnable = VK_FALSE; // Optional
 
 			VkPipelineColorBlendAttachmentState colorBlendAttachment = {};
-			colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
-			colorBlendAttachment.blendEnable = VK_FALSE;
-			colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_ONE; // Optional
-			colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ZERO; // Optional
-			colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD; // Optional
-			colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE; // Optional
-			colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO; // Optional
-			colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD; // Optional
+			colorBlendAttachment.colorWriteMask = pipelineInfo.state.colorWriteMask;
+			colorBlendAttachment.blendEnable = pipelineInfo.state.blendEnable;
+			colorBlendAttachment.srcColorBlendFactor = static_cast<VkBlendFactor>(pipelineInfo.state.srcColorBlendFactor);
+			colorBlendAttachment.dstColorBlendFactor = static_cast<VkBlendFactor>(pipelineInfo.state.dstColorBlendFactor);
+			colorBlendAttachment.colorBlendOp = static_cast<VkBlendOp>(pipelineInfo.state.colorBlendOp);
+			colorBlendAttachment.srcAlphaBlendFactor = static_cast<VkBlendFactor>(pipelineInfo.state.srcAlphaBlendFactor);
+			colorBlendAttachment.dstAlphaBlendFactor = static_cast<VkBlendFactor>(pipelineInfo.state.dstAlphaBlendFactor);
+			colorBlendAttachment.alphaBlendOp = static_cast<VkBlendOp>(pipelineInfo.state.alphaBlendOp);
 
 			VkPipelineColorBlendStateCreateInfo colorBlending = {};
 			colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
@@ -246,40 +202,42 @@ namespace Vulkan
 			if (result != VK_SUCCESS)
 				throw VulkanException("Failed to create graphics pipeline layout. Result: " + to_string(result));
 
-			VkGraphicsPipelineCreateInfo pipelineInfo = {};
-			pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-			pipelineInfo.stageCount = 2;
-			pipelineInfo.pStages = shaderStages;
-			pipelineInfo.pVertexInputState = &vertexInputInfo;
-			pipelineInfo.pInputAssemblyState = &inputAssembly;
-			pipelineInfo.pViewportState = &viewportState;
-			pipelineInfo.pRasterizationState = &rasterizer;
-			pipelineInfo.pMultisampleState = &multisampling;
-			pipelineInfo.pDepthStencilState = nullptr; // Optional
-			pipelineInfo.pColorBlendState = &colorBlending;
-			pipelineInfo.pDynamicState = nullptr; // Optional
-			pipelineInfo.layout = layout;
-			pipelineInfo.renderPass = renderPass;
-			pipelineInfo.subpass = 0;
-			pipelineInfo.basePipelineHandle = VK_NULL_HANDLE; // Optional
-			pipelineInfo.basePipelineIndex = -1; // Optional
-
-			result = vkCreateGraphicsPipelines(_device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &instance);
-			if (result != VK_SUCCESS)
-				throw VulkanException("Failed to create graphics pipeline. Result: " + to_string(result));
+			VkGraphicsPipelineCreateInfo pipelineCreateInfo = {};
+			pipelineCreateInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+			pipelineCreateInfo.stageCount = 2;
+			pipelineCreateInfo.pStages = shaderStages;
+			pipelineCreateInfo.pVertexInputState = &vertexInputInfo;
+			pipelineCreateInfo.pInputAssemblyState = &inputAssembly;
+			pipelineCreateInfo.pViewportState = &viewportState;
+			pipelineCreateInfo.pRasterizationState = &rasterizer;
+			pipelineCreateInfo.pMultisampleState = &multisampling;
+			pipelineCreateInfo.pDepthStencilState = nullptr; // Optional
+			pipelineCreateInfo.pColorBlendState = &colorBlending;
+			pipelineCreateInfo.pDynamicState = &dynamicState;
+			pipelineCreateInfo.layout = layout;
+			pipelineCreateInfo.renderPass = pipelineInfo.renderPass;
+			pipelineCreateInfo.subpass = 0;
+			pipelineCreateInfo.basePipelineHandle = VK_NULL_HANDLE; // Optional
+			pipelineCreateInfo.basePipelineIndex = -1; // Optional
+
+			auto creationStartTime = chrono::high_resolution_clock::now();
+			result = vkCreateGraphicsPipelines(_device, pipelineCache, 1, &pipelineCreateInfo, nullptr, &instance);
+			creationTime = chrono::duration<double>(chrono::high_resolution_clock::now() - creationStartTime).count();
 
 			DestroyShaderModuleInstance(_device, vertShaderModule);
 			DestroyShaderModuleInstance(_device, fragShaderModule);
 
-			framebuffers = CreateFramebuffers(device, renderPass, extent, swapchainImageViews);
+			if (result != VK_SUCCESS)
+			{
+				vkDestroyPipelineLayout(_device, layout, nullptr);
+				throw VulkanException("Failed to create graphics pipeline. Result: " + to_string(result));
+			}
 		}
 		// Destroys vulkan graphics pipeline class instance
 		~Pipeline_T()
 		{
-			DestroyFramebuffers(device, framebuffers);
 			vkDestroyPipeline(device, instance, nullptr);
 			vkDestroyPipelineLayout(device, layout, nullptr);
-			vkDestroyRenderPass(device, renderPass, nullptr);
 		}
 	};
 
@@ -287,9 +245,9 @@ namespace Vulkan
 	typedef Pipeline_T* Pipeline;
 
 	// Creates a new vulkan graphics pipeline class instance
-	static Pipeline CreatePipelineInstance(VkDevice device, WindowDeviceInfo deviceInfo, const vector<VkImageView>& swapchainImageViews)
+	static Pipeline CreatePipelineInstance(VkDevice device, const PipelineInfo& pipelineInfo, VkPipelineCache pipelineCache)
 	{
-		return new Pipeline_T(device, deviceInfo, swapchainImageViews);
+		return new Pipeline_T(device, pipelineInfo, pipelineCache);
 	}
 	// Destroys vulkan graphics pipeline class instance
 	static void DestroyPipelineInstance(Pipeline instance)
@@ -0,0 +1,183 @@
+
+// Copyright 2019 Nikita Fediuchin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+#include "Vulkan.hpp"
+#include "Exceptions.hpp"
+
+#include <vector>
+#include <fstream>
+#include <cstring>
+#include <filesystem>
+
+using namespace std;
+
+namespace Vulkan
+{
+	// Vulkan pipeline cache data header (VkPipelineCacheHeaderVersionOne layout)
+	struct PipelineCacheHeader
+	{
+		// Header length in bytes
+		uint32_t headerSize;
+		// Header version (VkPipelineCacheHeaderVersion)
+		uint32_t headerVersion;
+		// Physical device vendor identifier
+		uint32_t vendorID;
+		// Physical device identifier
+		uint32_t deviceID;
+		// Physical device pipeline cache UUID
+		uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+	};
+
+	// Returns true if pipeline cache data was created by the same driver and device
+	static bool IsPipelineCacheCompatible(const vector<char>& data, const VkPhysicalDeviceProperties& properties)
+	{
+		if (data.size() < sizeof(PipelineCacheHeader))
+			return false;
+
+		PipelineCacheHeader header;
+		memcpy(&header, data.data(), sizeof(PipelineCacheHeader));
+
+		return header.headerSize >= sizeof(PipelineCacheHeader) &&
+			header.headerSize <= data.size() &&
+			header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+			header.vendorID == properties.vendorID &&
+			header.deviceID == properties.deviceID &&
+			memcmp(header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+	}
+
+	// Reads pipeline cache data from the disk (returns empty array if file does not exist)
+	static vector<char> ReadPipelineCacheData(const string& filePath)
+	{
+		ifstream file(filePath, ios::ate | ios::binary);
+
+		if (!file.is_open())
+			return vector<char>();
+
+		size_t fileSize = (size_t)file.tellg();
+		vector<char> buffer(fileSize);
+
+		file.seekg(0);
+		file.read(buffer.data(), fileSize);
+
+		if (!file)
+			return vector<char>();
+
+		return buffer;
+	}
+
+	// Vulkan pipeline cache class
+	class PipelineCache_T
+	{
+	protected:
+		// Vulkan logical device instance
+		VkDevice device;
+
+		// Vulkan pipeline cache instance
+		VkPipelineCache instance;
+		// Pipeline cache file path
+		string filePath;
+		// Is pipeline cache loaded from the disk (warm)
+		bool isLoaded;
+
+	public:
+		// Creates a new vulkan pipeline cache class instance (loads valid cache data from the disk)
+		PipelineCache_T(VkDevice _device, VkPhysicalDevice physicalDevice, const string& _filePath)
+		{
+			device = _device;
+			filePath = _filePath;
+
+			VkPhysicalDeviceProperties properties;
+			vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+			auto data = ReadPipelineCacheData(_filePath);
+			isLoaded = IsPipelineCacheCompatible(data, properties);
+
+			VkPipelineCacheCreateInfo createInfo = {};
+			createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+
+			if (isLoaded)
+			{
+				createInfo.initialDataSize = data.size();
+				createInfo.pInitialData = data.data();
+			}
+
+			auto result = vkCreatePipelineCache(_device, &createInfo, nullptr, &instance);
+			if (result != VK_SUCCESS)
+				throw VulkanException("Failed to create pipeline cache. Result: " + to_string(result));
+		}
+		// Destroys vulkan pipeline cache class instance (writes cache data back to the disk)
+		~PipelineCache_T()
+		{
+			Save();
+			vkDestroyPipelineCache(device, instance, nullptr);
+		}
+
+		// Returns vulkan pipeline cache instance
+		VkPipelineCache GetInstance() { return instance; }
+		// Returns pipeline cache file path
+		const string& GetFilePath() { return filePath; }
+		// Returns true if pipeline cache was loaded from the disk
+		bool IsLoaded() { return isLoaded; }
+
+		// Writes pipeline cache data to the disk (temporary file is renamed over the old one)
+		bool Save()
+		{
+			size_t dataSize = 0;
+			auto result = vkGetPipelineCacheData(device, instance, &dataSize, nullptr);
+
+			if (result != VK_SUCCESS || dataSize == 0)
+				return false;
+
+			vector<char> data(dataSize);
+			result = vkGetPipelineCacheData(device, instance, &dataSize, data.data());
+
+			if (result != VK_SUCCESS)
+				return false;
+
+			auto tempFilePath = filePath + ".tmp";
+
+			{
+				ofstream file(tempFilePath, ios::binary | ios::trunc);
+
+				if (!file.is_open())
+					return false;
+
+				file.write(data.data(), dataSize);
+
+				if (!file)
+					return false;
+			}
+
+			error_code errorCode;
+			filesystem::rename(tempFilePath, filePath, errorCode);
+			return !errorCode;
+		}
+	};
+
+	// Vulkan pipeline cache class instance
+	typedef PipelineCache_T* PipelineCache;
+
+	// Creates a new vulkan pipeline cache class instance
+	static PipelineCache CreatePipelineCacheInstance(VkDevice device, VkPhysicalDevice physicalDevice, const string& filePath)
+	{
+		return new PipelineCache_T(device, physicalDevice, filePath);
+	}
+	// Destroys vulkan pipeline cache class instance
+	static void DestroyPipelineCacheInstance(PipelineCache instance)
+	{
+		delete instance;
+	}
+}
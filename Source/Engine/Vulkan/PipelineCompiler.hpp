@@ -0,0 +1,171 @@
+
+// Copyright 2019 Nikita Fediuchin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+#include "Vulkan.hpp"
+#include "Pipeline.hpp"
+#include "Exceptions.hpp"
+#include "Engine/ThreadPool.hpp"
+
+#include <mutex>
+#include <atomic>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace Vulkan
+{
+	// Vulkan asynchronous pipeline compilation handle class
+	class PipelineHandle_T
+	{
+	protected:
+		// Graphics pipeline description
+		PipelineInfo pipelineInfo;
+		// Placeholder pipeline handle (used while this pipeline is compiling)
+		PipelineHandle_T* placeholder;
+
+		// Compiled graphics pipeline instance
+		Pipeline pipeline;
+		// Compilation error message
+		string error;
+		// Is pipeline compilation finished successfully
+		atomic<bool> isReady;
+		// Is pipeline compilation failed
+		atomic<bool> isFailed;
+
+	public:
+		// Creates a new vulkan pipeline handle class instance
+		PipelineHandle_T(const PipelineInfo& _pipelineInfo, PipelineHandle_T* _placeholder)
+		{
+			pipelineInfo = _pipelineInfo;
+			placeholder = _placeholder;
+			pipeline = nullptr;
+			isReady = false;
+			isFailed = false;
+		}
+		// Destroys vulkan pipeline handle class instance
+		~PipelineHandle_T()
+		{
+			if (pipeline)
+				DestroyPipelineInstance(pipeline);
+		}
+
+		// Returns graphics pipeline description
+		const PipelineInfo& GetPipelineInfo() { return pipelineInfo; }
+		// Returns true if pipeline compilation is finished successfully
+		bool IsReady() { return isReady; }
+		// Returns true if pipeline compilation is failed
+		bool IsFailed() { return isFailed; }
+		// Returns compilation error message (valid if failed)
+		const string& GetError() { return error; }
+
+		// Returns compiled graphics pipeline (null if not ready)
+		Pipeline GetPipeline() { return isReady ? pipeline : nullptr; }
+		// Returns compiled pipeline, placeholder pipeline or null handle if none of them is ready yet
+		VkPipeline GetInstance()
+		{
+			if (isReady)
+				return pipeline->instance;
+
+			return placeholder ? placeholder->GetInstance() : VK_NULL_HANDLE;
+		}
+
+		// Compiles graphics pipeline (called once from the compiler thread)
+		void Compile(VkDevice device, VkPipelineCache pipelineCache)
+		{
+			try
+			{
+				pipeline = CreatePipelineInstance(device, pipelineInfo, pipelineCache);
+				isReady = true;
+			}
+			catch (const exception& e)
+			{
+				error = e.what();
+				isFailed = true;
+			}
+		}
+	};
+
+	// Vulkan pipeline handle class instance
+	typedef PipelineHandle_T* PipelineHandle;
+
+	// Vulkan asynchronous pipeline compiler class
+	class PipelineCompiler_T
+	{
+	protected:
+		// Vulkan logical device instance
+		VkDevice device;
+		// Vulkan pipeline cache instance (shared by all compiler threads)
+		VkPipelineCache pipelineCache;
+
+		// Compiler worker thread pool
+		ThreadPool* threadPool;
+		// Pipeline handle array (owned by the compiler)
+		vector<PipelineHandle> handles;
+		// Pipeline handle array mutex
+		mutex handlesMutex;
+
+	public:
+		// Creates a new vulkan pipeline compiler class instance
+		PipelineCompiler_T(VkDevice _device, VkPipelineCache _pipelineCache, size_t threadCount)
+		{
+			if (threadCount == 0)
+				throw ArgumentOutOfRangeException("Vulkan pipeline compiler thread count can not be zero");
+
+			device = _device;
+			pipelineCache = _pipelineCache;
+			threadPool = new ThreadPool(threadCount);
+		}
+		// Destroys vulkan pipeline compiler class instance (waits for the queued compilations)
+		~PipelineCompiler_T()
+		{
+			delete threadPool;
+
+			for (auto handle : handles)
+				delete handle;
+		}
+
+		// Queues a new graphics pipeline compilation and returns its handle
+		PipelineHandle Compile(const PipelineInfo& pipelineInfo, PipelineHandle placeholder)
+		{
+			auto handle = new PipelineHandle_T(pipelineInfo, placeholder);
+
+			{
+				lock_guard<mutex> lock(handlesMutex);
+				handles.push_back(handle);
+			}
+
+			auto _device = device;
+			auto _pipelineCache = pipelineCache;
+			threadPool->Enqueue([handle, _device, _pipelineCache]() { handle->Compile(_device, _pipelineCache); });
+			return handle;
+		}
+	};
+
+	// Vulkan pipeline compiler class instance
+	typedef PipelineCompiler_T* PipelineCompiler;
+
+	// Creates a new vulkan pipeline compiler class instance
+	static PipelineCompiler CreatePipelineCompilerInstance(VkDevice device, VkPipelineCache pipelineCache, size_t threadCount)
+	{
+		return new PipelineCompiler_T(device, pipelineCache, threadCount);
+	}
+	// Destroys vulkan pipeline compiler class instance
+	static void DestroyPipelineCompilerInstance(PipelineCompiler instance)
+	{
+		delete instance;
+	}
+}
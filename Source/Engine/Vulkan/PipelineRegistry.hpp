@@ -0,0 +1,126 @@
+
+// Copyright 2019 Nikita Fediuchin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+#include "Pipeline.hpp"
+#include "PipelineCompiler.hpp"
+
+#include <mutex>
+#include <unordered_map>
+
+using namespace std;
+
+namespace Vulkan
+{
+	// Vulkan pipeline registry lookup statistics
+	struct PipelineRegistryStats
+	{
+		// Lookups which returned an existing pipeline
+		size_t hitCount;
+		// Lookups which queued a new pipeline compilation
+		size_t missCount;
+		// Unique pipeline count
+		size_t pipelineCount;
+		// Compiled pipeline count
+		size_t readyCount;
+		// Total creation time of the compiled pipelines in seconds
+		double compileTime;
+	};
+
+	// Vulkan deduplicating graphics pipeline registry class
+	class PipelineRegistry_T
+	{
+	protected:
+		// Vulkan pipeline compiler instance
+		PipelineCompiler compiler;
+
+		// Pipeline description to handle map
+		unordered_map<PipelineInfo, PipelineHandle, PipelineInfoHash> pipelines;
+		// Pipeline map mutex
+		mutex pipelinesMutex;
+
+		// Lookup hit count
+		size_t hitCount;
+		// Lookup miss count
+		size_t missCount;
+
+	public:
+		// Creates a new vulkan pipeline registry class instance
+		PipelineRegistry_T(PipelineCompiler _compiler)
+		{
+			compiler = _compiler;
+			hitCount = 0;
+			missCount = 0;
+		}
+
+		// Returns pipeline handle for the description (queues compilation only for a new description)
+		PipelineHandle Get(const PipelineInfo& pipelineInfo, PipelineHandle placeholder)
+		{
+			lock_guard<mutex> lock(pipelinesMutex);
+
+			auto iterator = pipelines.find(pipelineInfo);
+
+			if (iterator != pipelines.end())
+			{
+				hitCount++;
+				return iterator->second;
+			}
+
+			missCount++;
+
+			auto handle = compiler->Compile(pipelineInfo, placeholder);
+			pipelines.emplace(pipelineInfo, handle);
+			return handle;
+		}
+
+		// Returns pipeline registry lookup statistics
+		PipelineRegistryStats GetStats()
+		{
+			lock_guard<mutex> lock(pipelinesMutex);
+
+			PipelineRegistryStats stats = {};
+			stats.hitCount = hitCount;
+			stats.missCount = missCount;
+			stats.pipelineCount = pipelines.size();
+
+			for (const auto& pair : pipelines)
+			{
+				auto pipeline = pair.second->GetPipeline();
+
+				if (!pipeline)
+					continue;
+
+				stats.readyCount++;
+				stats.compileTime += pipeline->creationTime;
+			}
+
+			return stats;
+		}
+	};
+
+	// Vulkan pipeline registry class instance
+	typedef PipelineRegistry_T* PipelineRegistry;
+
+	// Creates a new vulkan pipeline registry class instance
+	static PipelineRegistry CreatePipelineRegistryInstance(PipelineCompiler compiler)
+	{
+		return new PipelineRegistry_T(compiler);
+	}
+	// Destroys vulkan pipeline registry class instance
+	static void DestroyPipelineRegistryInstance(PipelineRegistry instance)
+	{
+		delete instance;
+	}
+}
@@ -0,0 +1,126 @@
+
+// Copyright 2019 Nikita Fediuchin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+#include "Vulkan.hpp"
+
+#include <cstring>
+#include <cstdint>
+
+using namespace std;
+
+namespace Vulkan
+{
+	// Returns FNV-1a hash of the byte array (combined with the seed hash)
+	static uint64_t HashBytes(const void* data, size_t size, uint64_t seed)
+	{
+		auto bytes = static_cast<const uint8_t*>(data);
+		auto hash = seed;
+
+		for (size_t i = 0; i < size; i++)
+		{
+			hash ^= bytes[i];
+			hash *= 1099511628211ULL;
+		}
+
+		return hash;
+	}
+
+	// FNV-1a hash initial value
+	const uint64_t HashSeed = 14695981039346656037ULL;
+
+	// Vulkan graphics pipeline fixed function state (compact, hashed as raw bytes)
+	struct PipelineState
+	{
+		// Rasterization line width
+		float lineWidth;
+
+		// Primitive topology (VkPrimitiveTopology)
+		uint8_t topology;
+		// Polygon mode (VkPolygonMode)
+		uint8_t polygonMode;
+		// Cull mode (VkCullModeFlags)
+		uint8_t cullMode;
+		// Front face (VkFrontFace)
+		uint8_t frontFace;
+		// Rasterization sample count (VkSampleCountFlagBits)
+		uint8_t sampleCount;
+		// Is depth clamp enabled
+		uint8_t depthClampEnable;
+
+		// Is color blending enabled
+		uint8_t blendEnable;
+		// Color write mask (VkColorComponentFlags)
+		uint8_t colorWriteMask;
+		// Source color blend factor (VkBlendFactor)
+		uint8_t srcColorBlendFactor;
+		// Destination color blend factor (VkBlendFactor)
+		uint8_t dstColorBlendFactor;
+		// Color blend operation (core VkBlendOp)
+		uint8_t colorBlendOp;
+		// Source alpha blend factor (VkBlendFactor)
+		uint8_t srcAlphaBlendFactor;
+		// Destination alpha blend factor (VkBlendFactor)
+		uint8_t dstAlphaBlendFactor;
+		// Alpha blend operation (core VkBlendOp)
+		uint8_t alphaBlendOp;
+
+		// Explicit padding (always zero, keeps raw byte hashing stable)
+		uint8_t padding[2];
+
+		// Creates a new default opaque pipeline state
+		PipelineState()
+		{
+			lineWidth = 1.0f;
+			topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+			polygonMode = VK_POLYGON_MODE_FILL;
+			cullMode = VK_CULL_MODE_BACK_BIT;
+			frontFace = VK_FRONT_FACE_CLOCKWISE;
+			sampleCount = VK_SAMPLE_COUNT_1_BIT;
+			depthClampEnable = VK_FALSE;
+
+			blendEnable = VK_FALSE;
+			colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+			srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
+			dstColorBlendFactor = VK_BLEND_FACTOR_ZERO;
+			colorBlendOp = VK_BLEND_OP_ADD;
+			srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+			dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+			alphaBlendOp = VK_BLEND_OP_ADD;
+
+			padding[0] = 0;
+			padding[1] = 0;
+		}
+
+		// Returns pipeline state hash
+		uint64_t GetHash(uint64_t seed) const
+		{
+			return HashBytes(this, sizeof(PipelineState), seed);
+		}
+
+		// Returns true if pipeline states are equal
+		bool operator==(const PipelineState& other) const
+		{
+			return memcmp(this, &other, sizeof(PipelineState)) == 0;
+		}
+		// Returns true if pipeline states are not equal
+		bool operator!=(const PipelineState& other) const
+		{
+			return !(*this == other);
+		}
+	};
+
+	static_assert(sizeof(PipelineState) == 20, "Pipeline state should not contain implicit padding");
+}
@@ -0,0 +1,182 @@
+
+// Copyright 2019 Nikita Fediuchin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+#include "Vulkan.hpp"
+#include "Buffer.hpp"
+#include "Exceptions.hpp"
+
+#include <vector>
+
+using namespace std;
+
+namespace Vulkan
+{
+	// Returns true if color images of the format can be read back (8 bit RGBA or BGRA)
+	static bool IsReadbackFormatSupported(VkFormat format)
+	{
+		return format == VK_FORMAT_R8G8B8A8_UNORM || format == VK_FORMAT_R8G8B8A8_SRGB ||
+			format == VK_FORMAT_B8G8R8A8_UNORM || format == VK_FORMAT_B8G8R8A8_SRGB;
+	}
+
+	// Vulkan color image readback ring class (one host visible buffer per frame in flight)
+	// Slot is reused only after its frame fence is signaled, so reading it back never waits for the GPU.
+	class Readback_T
+	{
+	protected:
+		// Not captured slot frame index value
+		static constexpr uint64_t NoCapturedFrame = UINT64_MAX;
+
+		// Readback image extent
+		VkExtent2D extent;
+		// Readback image color format
+		VkFormat format;
+
+		// Host visible readback buffer array (one per slot)
+		vector<Buffer> buffers;
+		// Captured frame index per slot (waiting to be taken after the frame fence)
+		vector<uint64_t> capturedFrames;
+
+	public:
+		// Creates a new vulkan readback ring class instance (host cached memory is preferred for the CPU reads)
+		Readback_T(VkDevice device, Allocator allocator, VkExtent2D _extent, VkFormat _format, uint32_t slotCount)
+		{
+			if (_extent.width == 0 || _extent.height == 0)
+				throw ArgumentOutOfRangeException("Vulkan readback extent can not be zero");
+			if (slotCount == 0)
+				throw ArgumentOutOfRangeException("Vulkan readback slot count can not be zero");
+			if (!IsReadbackFormatSupported(_format))
+				throw VulkanException("Unsupported vulkan readback color format. Format: " + to_string(_format));
+
+			extent = _extent;
+			format = _format;
+			capturedFrames.resize(slotCount, NoCapturedFrame);
+			buffers.resize(slotCount);
+
+			auto size = static_cast<VkDeviceSize>(_extent.width) * _extent.height * 4;
+
+			for (uint32_t i = 0; i < slotCount; i++)
+			{
+				try
+				{
+					buffers[i] = CreateBufferInstance(device, allocator, size, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+						VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT);
+				}
+				catch (VulkanException&)
+				{
+					buffers[i] = CreateBufferInstance(device, allocator, size, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+						VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+				}
+			}
+		}
+		// Destroys vulkan readback ring class instance
+		~Readback_T()
+		{
+			for (auto buffer : buffers)
+				DestroyBufferInstance(buffer);
+		}
+
+		// Returns readback image extent
+		VkExtent2D GetExtent() { return extent; }
+		// Returns readback image color format
+		VkFormat GetFormat() { return format; }
+		// Returns true if read back pixels are in the BGRA8 order
+		bool IsBgra() { return format == VK_FORMAT_B8G8R8A8_UNORM || format == VK_FORMAT_B8G8R8A8_SRGB; }
+		// Returns readback slot count
+		uint32_t GetSlotCount() { return static_cast<uint32_t>(buffers.size()); }
+		// Returns frame pixel data size in bytes (tightly packed rows)
+		size_t GetFrameSize() { return static_cast<size_t>(extent.width) * extent.height * 4; }
+		// Returns slot pixels (valid after the slot frame fence is signaled)
+		const uint8_t* GetData(uint32_t slot) { return static_cast<const uint8_t*>(buffers[slot]->GetMappedData()); }
+
+		// Records rendered color image copy to the slot buffer
+		// Image is in the layout before and after the copy, its last writes are the color attachment writes.
+		void Record(VkCommandBuffer commandBuffer, uint32_t slot, VkImage image, VkImageLayout layout)
+		{
+			VkImageMemoryBarrier imageBarrier = {};
+			imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+			imageBarrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+			imageBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+			imageBarrier.oldLayout = layout;
+			imageBarrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+			imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			imageBarrier.image = image;
+			imageBarrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+
+			vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+				0, 0, nullptr, 0, nullptr, 1, &imageBarrier);
+
+			VkBufferImageCopy region = {};
+			region.bufferOffset = 0;
+			region.bufferRowLength = 0;
+			region.bufferImageHeight = 0;
+			region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+			region.imageOffset = { 0, 0, 0 };
+			region.imageExtent = { extent.width, extent.height, 1 };
+
+			vkCmdCopyImageToBuffer(commandBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, buffers[slot]->instance, 1, &region);
+
+			// Presentation is ordered by the render finished semaphore, so the transition back waits for nothing
+			if (layout != VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL)
+			{
+				imageBarrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+				imageBarrier.dstAccessMask = 0;
+				imageBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+				imageBarrier.newLayout = layout;
+
+				vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+					0, 0, nullptr, 0, nullptr, 1, &imageBarrier);
+			}
+
+			VkBufferMemoryBarrier bufferBarrier = {};
+			bufferBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+			bufferBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			bufferBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+			bufferBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			bufferBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			bufferBarrier.buffer = buffers[slot]->instance;
+			bufferBarrier.offset = 0;
+			bufferBarrier.size = VK_WHOLE_SIZE;
+
+			vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT,
+				0, 0, nullptr, 1, &bufferBarrier, 0, nullptr);
+		}
+
+		// Marks slot as captured by the frame (its pixels are taken after the frame fence)
+		void SetCaptured(uint32_t slot, uint64_t frameIndex) { capturedFrames[slot] = frameIndex; }
+		// Takes captured slot frame index, returns false if slot was not captured
+		bool TakeCaptured(uint32_t slot, uint64_t& frameIndex)
+		{
+			frameIndex = capturedFrames[slot];
+			capturedFrames[slot] = NoCapturedFrame;
+			return frameIndex != NoCapturedFrame;
+		}
+	};
+
+	// Vulkan readback ring class instance
+	typedef Readback_T* Readback;
+
+	// Creates a new vulkan readback ring class instance
+	static Readback CreateReadbackInstance(VkDevice device, Allocator allocator, VkExtent2D extent, VkFormat format, uint32_t slotCount)
+	{
+		return new Readback_T(device, allocator, extent, format, slotCount);
+	}
+	// Destroys vulkan readback ring class instance
+	static void DestroyReadbackInstance(Readback instance)
+	{
+		delete instance;
+	}
+}
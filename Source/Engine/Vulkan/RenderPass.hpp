@@ -0,0 +1,171 @@
+
+// Copyright 2019 Nikita Fediuchin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+#include "Vulkan.hpp"
+#include "Exceptions.hpp"
+
+#include <vector>
+
+using namespace std;
+
+namespace Vulkan
+{
+	// Creates a new vulkan single color attachment render pass instance
+	static VkRenderPass CreateVulkanRenderPassInstance(VkDevice device, VkFormat colorFormat, VkImageLayout finalLayout)
+	{
+		VkAttachmentDescription colorAttachment = {};
+		colorAttachment.format = colorFormat;
+		colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+		colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+		colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+		colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+		colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+		colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		colorAttachment.finalLayout = finalLayout;
+
+		VkAttachmentReference colorAttachmentRef = {};
+		colorAttachmentRef.attachment = 0;
+		colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+		VkSubpassDescription subpass = {};
+		subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+		subpass.colorAttachmentCount = 1;
+		subpass.pColorAttachments = &colorAttachmentRef;
+
+		VkSubpassDependency dependencies[2] = {};
+		dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+		dependencies[0].dstSubpass = 0;
+		dependencies[0].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+		dependencies[0].srcAccessMask = 0;
+		dependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+		dependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+
+		// Color writes are visible to the transfer commands after the pass (capture and headless readback copies)
+		dependencies[1].srcSubpass = 0;
+		dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+		dependencies[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+		dependencies[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+		dependencies[1].dstStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+		dependencies[1].dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+		VkRenderPassCreateInfo renderPassInfo = {};
+		renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+		renderPassInfo.attachmentCount = 1;
+		renderPassInfo.pAttachments = &colorAttachment;
+		renderPassInfo.subpassCount = 1;
+		renderPassInfo.pSubpasses = &subpass;
+		renderPassInfo.dependencyCount = 2;
+		renderPassInfo.pDependencies = dependencies;
+
+		VkRenderPass renderPass;
+		auto result = vkCreateRenderPass(device, &renderPassInfo, nullptr, &renderPass);
+
+		if (result != VK_SUCCESS)
+			throw VulkanException("Failed to create render pass. Result: " + to_string(result));
+
+		return renderPass;
+	}
+
+	// Creates a new vulkan render pass framebuffer array (one per image view)
+	static vector<VkFramebuffer> CreateFramebuffers(VkDevice device, VkRenderPass renderPass, VkExtent2D extent, const vector<VkImageView>& imageViews)
+	{
+		vector<VkFramebuffer> framebuffers(imageViews.size());
+
+		for (size_t i = 0; i < imageViews.size(); i++)
+		{
+			VkImageView attachments[] =
+			{
+				imageViews[i]
+			};
+
+			VkFramebufferCreateInfo framebufferInfo = {};
+			framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+			framebufferInfo.renderPass = renderPass;
+			framebufferInfo.attachmentCount = 1;
+			framebufferInfo.pAttachments = attachments;
+			framebufferInfo.width = extent.width;
+			framebufferInfo.height = extent.height;
+			framebufferInfo.layers = 1;
+
+			auto result = vkCreateFramebuffer(device, &framebufferInfo, nullptr, &framebuffers[i]);
+			if (result != VK_SUCCESS)
+				throw VulkanException("Failed to create framebuffer. Result: " + to_string(result));
+		}
+
+		return framebuffers;
+	}
+	// Destroys vulkan render pass framebuffer array
+	static void DestroyFramebuffers(VkDevice device, const vector<VkFramebuffer>& framebuffers)
+	{
+		for (auto framebuffer : framebuffers)
+			vkDestroyFramebuffer(device, framebuffer, nullptr);
+	}
+
+	// Vulkan render pass class
+	class RenderPass_T
+	{
+	public:
+		// Vulkan logical device instance
+		VkDevice device;
+
+		// Vulkan render pass instance
+		VkRenderPass instance;
+		// Vulkan render pass framebuffer array
+		vector<VkFramebuffer> framebuffers;
+		// Vulkan framebuffer extent
+		VkExtent2D extent;
+
+		// Creates a new vulkan render pass class instance
+		RenderPass_T(VkDevice _device, VkFormat colorFormat, VkImageLayout finalLayout, VkExtent2D _extent, const vector<VkImageView>& imageViews)
+		{
+			device = _device;
+			extent = _extent;
+
+			instance = CreateVulkanRenderPassInstance(_device, colorFormat, finalLayout);
+			framebuffers = CreateFramebuffers(_device, instance, _extent, imageViews);
+		}
+		// Destroys vulkan render pass class instance
+		~RenderPass_T()
+		{
+			DestroyFramebuffers(device, framebuffers);
+			vkDestroyRenderPass(device, instance, nullptr);
+		}
+
+		// Recreates render pass framebuffers for the new image views (render pass and pipelines are kept)
+		void RecreateFramebuffers(VkExtent2D _extent, const vector<VkImageView>& imageViews)
+		{
+			DestroyFramebuffers(device, framebuffers);
+			framebuffers.clear();
+
+			extent = _extent;
+			framebuffers = CreateFramebuffers(device, instance, _extent, imageViews);
+		}
+	};
+
+	// Vulkan render pass class instance
+	typedef RenderPass_T* RenderPass;
+
+	// Creates a new vulkan render pass class instance
+	static RenderPass CreateRenderPassInstance(VkDevice device, VkFormat colorFormat, VkImageLayout finalLayout, VkExtent2D extent, const vector<VkImageView>& imageViews)
+	{
+		return new RenderPass_T(device, colorFormat, finalLayout, extent, imageViews);
+	}
+	// Destroys vulkan render pass class instance
+	static void DestroyRenderPassInstance(RenderPass instance)
+	{
+		delete instance;
+	}
+}
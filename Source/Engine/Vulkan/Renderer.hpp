@@ -0,0 +1,351 @@
+
+// Copyright 2019 Nikita Fediuchin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+#include "Debug.hpp"
+#include "Device.hpp"
+#include "Allocator.hpp"
+#include "Uploader.hpp"
+#include "Mesh.hpp"
+#include "PipelineCache.hpp"
+#include "PipelineCompiler.hpp"
+#include "PipelineRegistry.hpp"
+#include "Readback.hpp"
+#include "Engine/EngineInfo.hpp"
+#include "Engine/RenderQueue.hpp"
+#include "Engine/FrameEncoder.hpp"
+
+#include <chrono>
+#include <cstring>
+#include <algorithm>
+
+namespace Vulkan
+{
+	// Creates a new vulkan instance with the extensions (with debug if enabled)
+	static VkInstance CreateVulkanInstance(string appName, uint32_t appVersion, const vector<const char*>& extensions, const vector<const char*>& validationLayers, Debug& debug)
+	{
+		VkApplicationInfo appInfo = {};
+		appInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+		appInfo.pApplicationName = appName.c_str();
+		appInfo.applicationVersion = appVersion;
+		appInfo.pEngineName = EngineName.c_str();
+		appInfo.engineVersion = EngineVersion;
+		appInfo.apiVersion = VulkanVersion;
+
+		VkInstanceCreateInfo instanceCreateInfo = {};
+		instanceCreateInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+		instanceCreateInfo.pApplicationInfo = &appInfo;
+		instanceCreateInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
+		instanceCreateInfo.ppEnabledExtensionNames = extensions.data();
+
+		VkDebugUtilsMessengerCreateInfoEXT debugCreateInfo = {};
+
+		if (validationLayers.size() > 0)
+			EnableDebug(instanceCreateInfo, debugCreateInfo, validationLayers);
+
+		VkInstance instance;
+		auto result = vkCreateInstance(&instanceCreateInfo, nullptr, &instance);
+
+		if (result != VK_SUCCESS)
+			throw VulkanException("Failed to create Vulkan instance. Result: " + to_string(result));
+
+		if (validationLayers.size() > 0)
+			debug = CreateDebugInstance(instance, debugCreateInfo);
+
+		return instance;
+	}
+
+	// Vulkan renderer base class (device resources shared by the window and headless render targets)
+	// Derived class creates the instance and device, then the shared resources, and destroys them in reverse.
+	class Renderer_T
+	{
+	protected:
+		// Vulkan instance
+		VkInstance instance;
+		// Vulkan debug instance (null if validation is disabled)
+		Debug debug;
+		// Vulkan device instance
+		Device device;
+
+		// Vulkan graphics queue
+		VkQueue graphicsQueue;
+		// Vulkan transfer queue (graphics queue if there is no dedicated transfer family)
+		VkQueue transferQueue;
+
+		// Vulkan device memory allocator instance
+		Allocator allocator;
+		// Vulkan upload scheduler instance
+		Uploader uploader;
+		// Vulkan pipeline cache instance (shared by all pipelines)
+		PipelineCache pipelineCache;
+		// Vulkan asynchronous pipeline compiler instance
+		PipelineCompiler pipelineCompiler;
+		// Vulkan deduplicating pipeline registry instance
+		PipelineRegistry pipelineRegistry;
+		// Vulkan graphics pipeline handle (compiled in the background)
+		PipelineHandle graphicsPipeline;
+		// Vulkan triangle mesh instance (split position and color streams)
+		Mesh triangleMesh;
+		// Vulkan frame readback ring instance (null until the frames can be read back)
+		Readback readback;
+		// Captured frame encoder (null if capture is disabled, owned by the caller)
+		FrameEncoder* frameEncoder;
+
+		// Frames in flight count
+		uint32_t inFlightFrameCount;
+		// Current frame in flight index
+		uint32_t currentFrame;
+
+		// Last frame CPU wait time in seconds
+		double frameWaitTime;
+		// Last frame command record time in seconds
+		double frameRecordTime;
+		// Current frame clear color (RGBA, copied from the render packet)
+		float frameClearColor[4];
+
+		// Last frame input to submit latency in seconds
+		double submitLatency;
+		// Sum of the frame input to submit latencies in seconds
+		double totalSubmitLatency;
+		// Maximal frame input to submit latency in seconds
+		double maxSubmitLatency;
+		// Submitted frame count
+		uint64_t submittedFrameCount;
+
+		// Creates device queues, allocator, uploader and pipeline compilation resources (device should be created)
+		void CreateDeviceResources(uint32_t graphicsFamily, uint32_t transferFamily)
+		{
+			auto logicalDevice = device->GetInstance();
+			vkGetDeviceQueue(logicalDevice, graphicsFamily, 0, &graphicsQueue);
+			vkGetDeviceQueue(logicalDevice, transferFamily, 0, &transferQueue);
+
+			allocator = CreateAllocatorInstance(logicalDevice, device->GetPhysicalDevice(), DefaultMemoryBlockSize);
+			uploader = CreateUploaderInstance(logicalDevice, allocator, transferQueue, transferFamily, graphicsFamily, StagingBufferSize);
+			pipelineCache = CreatePipelineCacheInstance(logicalDevice, device->GetPhysicalDevice(), PipelineCacheFilePath);
+			pipelineCompiler = CreatePipelineCompilerInstance(logicalDevice, pipelineCache->GetInstance(), PipelineCompileThreadCount);
+			pipelineRegistry = CreatePipelineRegistryInstance(pipelineCompiler);
+		}
+		// Creates triangle mesh and requests its graphics pipeline for the render pass
+		void CreateTriangle(VkRenderPass renderPass)
+		{
+			const float trianglePositions[] = { 0.0f, -0.5f, 0.5f, 0.5f, -0.5f, 0.5f };
+			const float triangleColors[] = { 1.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f };
+			const uint16_t triangleIndices[] = { 0, 1, 2 };
+
+			auto vertexLayout = CreateSplitVertexLayout({ { VK_FORMAT_R32G32_SFLOAT }, { VK_FORMAT_R32G32B32_SFLOAT } });
+			triangleMesh = CreateMeshInstance(device->GetInstance(), allocator, uploader, vertexLayout, { trianglePositions, triangleColors }, 3, triangleIndices, 3, VK_INDEX_TYPE_UINT16);
+
+			PipelineInfo pipelineInfo = {};
+			pipelineInfo.vertexShaderPath = "Shaders/Engine/Unlit.vert.spv";
+			pipelineInfo.fragmentShaderPath = "Shaders/Engine/Unlit.frag.spv";
+			pipelineInfo.renderPass = renderPass;
+			pipelineInfo.vertexLayout = vertexLayout;
+
+			// Frames are drawn without the triangle until its pipeline is compiled
+			graphicsPipeline = pipelineRegistry->Get(pipelineInfo, nullptr);
+		}
+		// Destroys shared device resources and the device (frames in flight should be finished)
+		void DestroyDeviceResources()
+		{
+			if (readback)
+				DestroyReadbackInstance(readback);
+
+			DestroyMeshInstance(triangleMesh);
+			DestroyPipelineRegistryInstance(pipelineRegistry);
+			DestroyPipelineCompilerInstance(pipelineCompiler);
+			DestroyPipelineCacheInstance(pipelineCache);
+			DestroyUploaderInstance(uploader);
+			DestroyAllocatorInstance(allocator);
+			DestroyDeviceInstance(device);
+		}
+		// Destroys debug and vulkan instance (device and surfaces should be destroyed)
+		void DestroyInstance()
+		{
+			DestroyDebugInstance(debug);
+			vkDestroyInstance(instance, nullptr);
+		}
+
+		// Records triangle draw commands (skipped while its pipeline is compiling)
+		void RecordTriangle(VkCommandBuffer commandBuffer, VkExtent2D extent)
+		{
+			auto pipeline = graphicsPipeline->GetInstance();
+
+			if (pipeline == VK_NULL_HANDLE)
+				return;
+
+			VkViewport viewport = {};
+			viewport.x = 0.0f;
+			viewport.y = 0.0f;
+			viewport.width = (float)extent.width;
+			viewport.height = (float)extent.height;
+			viewport.minDepth = 0.0f;
+			viewport.maxDepth = 1.0f;
+
+			VkRect2D scissor = {};
+			scissor.offset = { 0, 0 };
+			scissor.extent = extent;
+
+			vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+			vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+			vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+			triangleMesh->Bind(commandBuffer);
+			triangleMesh->Draw(commandBuffer, 1);
+		}
+		// Returns frame clear value (clear color of the current render packet)
+		VkClearValue GetClearValue()
+		{
+			VkClearValue clearValue = {};
+			clearValue.color = { { frameClearColor[0], frameClearColor[1], frameClearColor[2], frameClearColor[3] } };
+			return clearValue;
+		}
+		// Records frame input to submit latency (called right after the queue submit)
+		void RecordSubmitLatency(const RenderPacket& packet)
+		{
+			submitLatency = chrono::duration<double>(chrono::high_resolution_clock::now() - packet.inputTime).count();
+			totalSubmitLatency += submitLatency;
+			maxSubmitLatency = max(maxSubmitLatency, submitLatency);
+			submittedFrameCount++;
+		}
+
+		// Records frame image copy to the current frame readback slot if the frame is captured
+		void RecordCapture(VkCommandBuffer commandBuffer, const RenderPacket& packet, VkImage image, VkImageLayout layout)
+		{
+			if (!packet.isCaptured || !frameEncoder)
+				return;
+
+			readback->Record(commandBuffer, currentFrame, image, layout);
+			readback->SetCaptured(currentFrame, packet.frameIndex);
+		}
+		// Passes captured slot pixels to the frame encoder (slot frame fence should be signaled)
+		void CollectCapture(uint32_t slot)
+		{
+			uint64_t capturedFrame;
+
+			if (!readback || !readback->TakeCaptured(slot, capturedFrame) || !frameEncoder)
+				return;
+
+			// Encoder copies the pixels and returns, frame is dropped if it is behind
+			auto extent = readback->GetExtent();
+			frameEncoder->Submit(capturedFrame, extent.width, extent.height, readback->IsBgra(), readback->GetData(slot));
+		}
+		// Passes all captured slot pixels to the frame encoder (device should be idle)
+		void CollectCaptures()
+		{
+			if (!readback)
+				return;
+
+			for (uint32_t i = 0; i < readback->GetSlotCount(); i++)
+				CollectCapture(i);
+		}
+
+	public:
+		// Creates a new vulkan renderer base class instance (resources are created by the derived class)
+		Renderer_T(uint32_t _inFlightFrameCount)
+		{
+			if (_inFlightFrameCount == 0)
+				throw ArgumentOutOfRangeException("Vulkan renderer frames in flight count can not be zero");
+
+			instance = VK_NULL_HANDLE;
+			debug = nullptr;
+			device = nullptr;
+			graphicsQueue = VK_NULL_HANDLE;
+			transferQueue = VK_NULL_HANDLE;
+			allocator = nullptr;
+			uploader = nullptr;
+			pipelineCache = nullptr;
+			pipelineCompiler = nullptr;
+			pipelineRegistry = nullptr;
+			graphicsPipeline = nullptr;
+			triangleMesh = nullptr;
+			readback = nullptr;
+			frameEncoder = nullptr;
+
+			inFlightFrameCount = _inFlightFrameCount;
+			currentFrame = 0;
+			frameWaitTime = 0.0;
+			frameRecordTime = 0.0;
+			frameClearColor[0] = 0.0f;
+			frameClearColor[1] = 0.0f;
+			frameClearColor[2] = 0.0f;
+			frameClearColor[3] = 1.0f;
+			submitLatency = 0.0;
+			totalSubmitLatency = 0.0;
+			maxSubmitLatency = 0.0;
+			submittedFrameCount = 0;
+		}
+		// Destroys vulkan renderer base class instance
+		virtual ~Renderer_T() {}
+
+		Renderer_T(const Renderer_T&) = delete;
+		Renderer_T& operator=(const Renderer_T&) = delete;
+
+		// Draws a new frame from the render packet
+		virtual void DrawFrame(const RenderPacket& packet) = 0;
+		// Returns render target extent
+		virtual VkExtent2D GetExtent() = 0;
+
+		// Sets captured frame encoder (null disables capture, frames should not be drawn meanwhile)
+		// Render packets with the capture flag are copied back and passed to the encoder once their fence is signaled.
+		virtual void SetFrameEncoder(FrameEncoder* encoder)
+		{
+			FlushCaptures();
+			frameEncoder = encoder;
+		}
+		// Waits for the submitted frames and passes their captured pixels to the frame encoder
+		void FlushCaptures()
+		{
+			if (!readback)
+				return;
+
+			vkDeviceWaitIdle(device->GetInstance());
+			CollectCaptures();
+		}
+
+		// Returns device memory usage statistics per memory heap
+		vector<MemoryHeapStats> GetMemoryHeapStats() { return allocator->GetHeapStats(); }
+		// Returns device memory allocator instance
+		Allocator GetAllocator() { return allocator; }
+		// Returns upload scheduler instance (uploads are submitted with the next frame)
+		Uploader GetUploader() { return uploader; }
+
+		// Returns frames in flight count
+		uint32_t GetInFlightFrameCount() { return inFlightFrameCount; }
+		// Returns last frame CPU wait time in seconds
+		double GetFrameWaitTime() { return frameWaitTime; }
+		// Returns last frame command record time in seconds
+		double GetFrameRecordTime() { return frameRecordTime; }
+		// Returns true if pipeline cache was loaded from the disk (warm start)
+		bool IsPipelineCacheLoaded() { return pipelineCache->IsLoaded(); }
+		// Returns true if graphics pipeline compilation is finished
+		bool IsPipelineReady() { return graphicsPipeline->IsReady(); }
+		// Returns graphics pipeline creation time in seconds (zero if not ready yet)
+		double GetPipelineCreationTime() { return graphicsPipeline->IsReady() ? graphicsPipeline->GetPipeline()->creationTime : 0.0; }
+		// Returns pipeline registry lookup statistics
+		PipelineRegistryStats GetPipelineRegistryStats() { return pipelineRegistry->GetStats(); }
+
+		// Returns last frame input to submit latency in seconds
+		double GetSubmitLatency() { return submitLatency; }
+		// Returns average frame input to submit latency in seconds
+		double GetAverageSubmitLatency() { return submittedFrameCount > 0 ? totalSubmitLatency / submittedFrameCount : 0.0; }
+		// Returns maximal frame input to submit latency in seconds
+		double GetMaxSubmitLatency() { return maxSubmitLatency; }
+		// Returns submitted frame count
+		uint64_t GetSubmittedFrameCount() { return submittedFrameCount; }
+	};
+
+	// Vulkan renderer class instance
+	typedef Renderer_T* Renderer;
+}
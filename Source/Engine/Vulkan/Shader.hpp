@@ -4,6 +4,7 @@
 
 #include <vector>
 #include <fstream>
+#include <filesystem>
 
 using namespace std;
 using namespace filesystem;
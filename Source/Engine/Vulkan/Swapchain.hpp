@@ -24,7 +24,7 @@ using namespace std;
 namespace Vulkan
 {
 	// Creates a new vulkan swapchain instance
-	static VkSwapchainKHR CreateVulkanSwapchainInstance(VkDevice device, WindowDeviceInfo deviceInfo)
+	static VkSwapchainKHR CreateVulkanSwapchainInstance(VkDevice device, WindowDeviceInfo deviceInfo, VkSwapchainKHR oldSwapchain)
 	{
 		VkSwapchainCreateInfoKHR createInfo = {};
 		createInfo.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
@@ -47,6 +47,10 @@ namespace Vulkan
 		createInfo.imageArrayLayers = 1;
 		createInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
 
+		// Presented images can be copied back for the frame capture
+		if (surfaceCapabilities.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_SRC_BIT)
+			createInfo.imageUsage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+
 		uint32_t queueFamilies[] =
 		{
 			deviceInfo->GetGraphicsFamily(),
@@ -70,7 +74,7 @@ namespace Vulkan
 		auto presentMode = deviceInfo->GetPresentMode();
 		createInfo.presentMode = presentMode;
 		createInfo.clipped = VK_TRUE;
-		createInfo.oldSwapchain = VK_NULL_HANDLE;
+		createInfo.oldSwapchain = oldSwapchain;
 
 		VkSwapchainKHR swapchain;
 		auto result = vkCreateSwapchainKHR(device, &createInfo, nullptr, &swapchain);
@@ -132,13 +136,16 @@ namespace Vulkan
 		vector<VkImage> images;
 		// Vulkan image view array
 		vector<VkImageView> imageViews;
+		// Vulkan swapchain image extent
+		VkExtent2D extent;
 
 	public:
-		// Creates a new vulkan window swapchain class instance
-		WindowSwapchain_T(VkDevice _device, WindowDeviceInfo deviceInfo)
+		// Creates a new vulkan window swapchain class instance (old swapchain resources are reused by the driver)
+		WindowSwapchain_T(VkDevice _device, WindowDeviceInfo deviceInfo, VkSwapchainKHR oldSwapchain)
 		{
 			device = _device;
-			instance = CreateVulkanSwapchainInstance(_device, deviceInfo);
+			extent = deviceInfo->GetSurfaceExtent();
+			instance = CreateVulkanSwapchainInstance(_device, deviceInfo, oldSwapchain);
 
 			uint32_t imageCount;
 			vkGetSwapchainImagesKHR(_device, instance, &imageCount, nullptr);
@@ -165,15 +172,17 @@ namespace Vulkan
 		vector<VkImage> GetImages() { return images; }
 		// Returns vulkan image view array
 		vector<VkImageView> GetImageViews() { return imageViews; }
+		// Returns vulkan swapchain image extent
+		VkExtent2D GetExtent() { return extent; }
 	};
 
 	// Vulkan window swapchain class instance
 	typedef WindowSwapchain_T* Swapchain;
 
 	// Creates a new vulkan window swapchain class instance
-	static Swapchain CreateSwapchainInstance(VkDevice device, WindowDeviceInfo deviceInfo)
+	static Swapchain CreateSwapchainInstance(VkDevice device, WindowDeviceInfo deviceInfo, VkSwapchainKHR oldSwapchain)
 	{
-		return new WindowSwapchain_T(device, deviceInfo);
+		return new WindowSwapchain_T(device, deviceInfo, oldSwapchain);
 	}
 	// Destroys vulkan window swapchain class instance
 	static void DestroySwapchainInstance(Swapchain instance)
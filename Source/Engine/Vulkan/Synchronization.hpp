@@ -0,0 +1,53 @@
+
+// Copyright 2019 Nikita Fediuchin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+#include "Vulkan.hpp"
+#include "Exceptions.hpp"
+
+using namespace std;
+
+namespace Vulkan
+{
+	// Creates a new vulkan semaphore instance
+	static VkSemaphore CreateSemaphoreInstance(VkDevice device)
+	{
+		VkSemaphoreCreateInfo createInfo = {};
+		createInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+		VkSemaphore semaphore;
+		auto result = vkCreateSemaphore(device, &createInfo, nullptr, &semaphore);
+
+		if (result != VK_SUCCESS)
+			throw VulkanException("Failed to create Vulkan semaphore. Result: " + to_string(result));
+
+		return semaphore;
+	}
+	// Creates a new vulkan fence instance
+	static VkFence CreateFenceInstance(VkDevice device, VkFenceCreateFlags flags)
+	{
+		VkFenceCreateInfo createInfo = {};
+		createInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+		createInfo.flags = flags;
+
+		VkFence fence;
+		auto result = vkCreateFence(device, &createInfo, nullptr, &fence);
+
+		if (result != VK_SUCCESS)
+			throw VulkanException("Failed to create Vulkan fence. Result: " + to_string(result));
+
+		return fence;
+	}
+}
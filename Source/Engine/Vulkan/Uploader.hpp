@@ -0,0 +1,456 @@
+
+// Copyright 2019 Nikita Fediuchin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+#include "Vulkan.hpp"
+#include "Buffer.hpp"
+#include "CommandPool.hpp"
+#include "Synchronization.hpp"
+#include "Exceptions.hpp"
+#include "Engine/RingAllocator.hpp"
+
+#include <deque>
+#include <vector>
+#include <cstring>
+
+using namespace std;
+
+namespace Vulkan
+{
+	// Staging buffer copy region alignment (suitable for any texel size)
+	const VkDeviceSize StagingCopyAlignment = 16;
+
+	// Vulkan upload batch (transfer command buffer with its retirement fence)
+	struct UploadBatch
+	{
+		// Transfer command pool instance
+		CommandPool commandPool;
+		// Batch retirement fence
+		VkFence fence;
+		// Is batch command buffer recorded
+		bool isRecording;
+		// Batch timeline value (submission index)
+		uint64_t value;
+		// Staging ring head position at the submission
+		uint64_t stagingPosition;
+	};
+
+	// Vulkan upload scheduler class
+	// Data is copied to the persistently mapped staging ring and batched into one transfer command buffer.
+	// Batches are retired in the submission order by their fences (emulated timeline values).
+	// Should be used from the rendering thread only, it submits to the transfer queue.
+	class Uploader_T
+	{
+	protected:
+		// Vulkan logical device instance
+		VkDevice device;
+		// Vulkan transfer queue (graphics queue if there is no dedicated transfer family)
+		VkQueue transferQueue;
+		// Transfer queue family index
+		uint32_t transferFamily;
+		// Graphics queue family index
+		uint32_t graphicsFamily;
+
+		// Staging buffer instance (host visible and coherent)
+		Buffer stagingBuffer;
+		// Persistently mapped staging buffer memory
+		uint8_t* stagingData;
+		// Staging buffer range allocator
+		RingAllocator* stagingRing;
+
+		// Currently recording batch (null if there are no uploads since the last submission)
+		UploadBatch* recordingBatch;
+		// Submitted batch queue (in the submission order)
+		deque<UploadBatch*> submittedBatches;
+		// Retired batch array (ready for reuse)
+		vector<UploadBatch*> freeBatches;
+
+		// Recording batch buffer barriers (acquire form)
+		vector<VkBufferMemoryBarrier> recordingBufferBarriers;
+		// Recording batch image barriers (acquire form)
+		vector<VkImageMemoryBarrier> recordingImageBarriers;
+		// Recording batch destination pipeline stages
+		VkPipelineStageFlags recordingStageMask;
+
+		// Submitted, but not yet acquired buffer barriers
+		vector<VkBufferMemoryBarrier> acquireBufferBarriers;
+		// Submitted, but not yet acquired image barriers
+		vector<VkImageMemoryBarrier> acquireImageBarriers;
+		// Submitted, but not yet acquired destination pipeline stages
+		VkPipelineStageFlags acquireStageMask;
+
+		// Last submitted batch value
+		uint64_t submittedValue;
+		// Last retired batch value
+		uint64_t completedValue;
+		// Is there a submission which did not signal the graphics semaphore
+		bool isSignalPending;
+		// Total uploaded data size
+		uint64_t uploadedSize;
+
+		// Returns unused batch (creates a new one if there is no retired batch)
+		UploadBatch* GetFreeBatch()
+		{
+			Retire();
+
+			if (!freeBatches.empty())
+			{
+				auto batch = freeBatches.back();
+				freeBatches.pop_back();
+				return batch;
+			}
+
+			auto batch = new UploadBatch();
+			batch->commandPool = CreateCommandPoolInstance(device, transferFamily, VK_COMMAND_POOL_CREATE_TRANSIENT_BIT, VK_COMMAND_BUFFER_LEVEL_PRIMARY);
+			batch->fence = CreateFenceInstance(device, 0);
+			return batch;
+		}
+		// Returns recording batch command buffer (begins a new batch if required)
+		VkCommandBuffer GetRecordingCommandBuffer()
+		{
+			if (!recordingBatch)
+			{
+				auto batch = GetFreeBatch();
+				batch->commandPool->Begin();
+				batch->isRecording = true;
+				recordingBatch = batch;
+			}
+
+			return recordingBatch->commandPool->commandBuffer;
+		}
+
+		// Submits recording batch (or empty batch if there is none) to the transfer queue
+		void SubmitBatch(VkSemaphore signalSemaphore)
+		{
+			UploadBatch* batch;
+
+			if (recordingBatch)
+			{
+				batch = recordingBatch;
+				recordingBatch = nullptr;
+
+				// Release half of the queue family ownership transfer
+				if (IsOwnershipTransfer() && (!recordingBufferBarriers.empty() || !recordingImageBarriers.empty()))
+				{
+					auto bufferBarriers = recordingBufferBarriers;
+					auto imageBarriers = recordingImageBarriers;
+
+					for (auto& barrier : bufferBarriers)
+					{
+						barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+						barrier.dstAccessMask = 0;
+					}
+					for (auto& barrier : imageBarriers)
+					{
+						barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+						barrier.dstAccessMask = 0;
+					}
+
+					vkCmdPipelineBarrier(batch->commandPool->commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0,
+						0, nullptr, static_cast<uint32_t>(bufferBarriers.size()), bufferBarriers.data(), static_cast<uint32_t>(imageBarriers.size()), imageBarriers.data());
+				}
+
+				batch->commandPool->End();
+
+				acquireBufferBarriers.insert(acquireBufferBarriers.end(), recordingBufferBarriers.begin(), recordingBufferBarriers.end());
+				acquireImageBarriers.insert(acquireImageBarriers.end(), recordingImageBarriers.begin(), recordingImageBarriers.end());
+				acquireStageMask |= recordingStageMask;
+
+				recordingBufferBarriers.clear();
+				recordingImageBarriers.clear();
+				recordingStageMask = 0;
+			}
+			else
+			{
+				batch = GetFreeBatch();
+				batch->isRecording = false;
+			}
+
+			VkSubmitInfo submitInfo = {};
+			submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+			submitInfo.commandBufferCount = batch->isRecording ? 1 : 0;
+			submitInfo.pCommandBuffers = &batch->commandPool->commandBuffer;
+
+			if (signalSemaphore != VK_NULL_HANDLE)
+			{
+				submitInfo.signalSemaphoreCount = 1;
+				submitInfo.pSignalSemaphores = &signalSemaphore;
+			}
+
+			auto result = vkResetFences(device, 1, &batch->fence);
+			if (result != VK_SUCCESS)
+				throw VulkanException("Failed to reset upload fence. Result: " + to_string(result));
+
+			result = vkQueueSubmit(transferQueue, 1, &submitInfo, batch->fence);
+			if (result != VK_SUCCESS)
+				throw VulkanException("Failed to submit upload command buffer. Result: " + to_string(result));
+
+			batch->isRecording = false;
+			batch->value = ++submittedValue;
+			batch->stagingPosition = stagingRing->GetHead();
+			submittedBatches.push_back(batch);
+
+			isSignalPending = signalSemaphore == VK_NULL_HANDLE;
+		}
+		// Waits for the oldest submitted batch and retires it
+		void WaitOldestBatch()
+		{
+			auto fence = submittedBatches.front()->fence;
+
+			auto result = vkWaitForFences(device, 1, &fence, VK_TRUE, UINT64_MAX);
+			if (result != VK_SUCCESS)
+				throw VulkanException("Failed to wait for upload fence. Result: " + to_string(result));
+
+			Retire();
+		}
+
+		// Allocates staging ring range (waits for the older batches if the ring is full, throws on zero size)
+		VkDeviceSize AllocateStaging(VkDeviceSize size, VkDeviceSize alignment)
+		{
+			// Empty range is never allocated by the ring, and zero sized copy regions are invalid
+			if (size == 0)
+				throw ArgumentOutOfRangeException("Vulkan upload size is zero");
+			if (size > stagingRing->GetSize())
+				throw ArgumentOutOfRangeException("Vulkan upload size is bigger than the staging buffer");
+
+			uint64_t offset;
+
+			while (!stagingRing->Allocate(size, alignment, offset))
+			{
+				// Whole ring is used by the recording batch
+				if (submittedBatches.empty())
+					SubmitBatch(VK_NULL_HANDLE);
+
+				WaitOldestBatch();
+			}
+
+			return offset;
+		}
+
+	public:
+		// Creates a new vulkan upload scheduler class instance
+		Uploader_T(VkDevice _device, Allocator allocator, VkQueue _transferQueue, uint32_t _transferFamily, uint32_t _graphicsFamily, VkDeviceSize stagingSize)
+		{
+			device = _device;
+			transferQueue = _transferQueue;
+			transferFamily = _transferFamily;
+			graphicsFamily = _graphicsFamily;
+
+			stagingBuffer = CreateBufferInstance(_device, allocator, stagingSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+			stagingData = static_cast<uint8_t*>(stagingBuffer->GetMappedData());
+			stagingRing = new RingAllocator(stagingSize);
+
+			recordingBatch = nullptr;
+			recordingStageMask = 0;
+			acquireStageMask = 0;
+			submittedValue = 0;
+			completedValue = 0;
+			isSignalPending = false;
+			uploadedSize = 0;
+		}
+		// Destroys vulkan upload scheduler class instance (device should be idle)
+		~Uploader_T()
+		{
+			if (recordingBatch)
+				freeBatches.push_back(recordingBatch);
+
+			for (auto batch : submittedBatches)
+				freeBatches.push_back(batch);
+
+			for (auto batch : freeBatches)
+			{
+				vkDestroyFence(device, batch->fence, nullptr);
+				DestroyCommandPoolInstance(batch->commandPool);
+				delete batch;
+			}
+
+			delete stagingRing;
+			DestroyBufferInstance(stagingBuffer);
+		}
+
+		// Returns true if uploads are transfered between different queue families
+		bool IsOwnershipTransfer() { return transferFamily != graphicsFamily; }
+		// Returns last submitted batch value
+		uint64_t GetSubmittedValue() { return submittedValue; }
+		// Returns last retired batch value (all uploads with lower or equal value are finished)
+		uint64_t GetCompletedValue() { return completedValue; }
+		// Returns total uploaded data size
+		uint64_t GetUploadedSize() { return uploadedSize; }
+		// Returns staging ring size (largest single upload size)
+		uint64_t GetStagingSize() { return stagingRing->GetSize(); }
+		// Returns used staging ring size
+		uint64_t GetStagingUsedSize() { return stagingRing->GetUsedSize(); }
+
+		// Queues buffer region upload, returns its batch value
+		uint64_t UploadBuffer(VkBuffer buffer, VkDeviceSize offset, const void* data, VkDeviceSize size, VkPipelineStageFlags dstStageMask, VkAccessFlags dstAccessMask)
+		{
+			if (!data)
+				throw ArgumentNullException("Vulkan upload data is null");
+
+			auto stagingOffset = AllocateStaging(size, StagingCopyAlignment);
+			memcpy(stagingData + stagingOffset, data, static_cast<size_t>(size));
+
+			auto commandBuffer = GetRecordingCommandBuffer();
+
+			VkBufferCopy region = {};
+			region.srcOffset = stagingOffset;
+			region.dstOffset = offset;
+			region.size = size;
+			vkCmdCopyBuffer(commandBuffer, stagingBuffer->instance, buffer, 1, &region);
+
+			VkBufferMemoryBarrier barrier = {};
+			barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+			barrier.srcAccessMask = IsOwnershipTransfer() ? 0 : VK_ACCESS_TRANSFER_WRITE_BIT;
+			barrier.dstAccessMask = dstAccessMask;
+			barrier.srcQueueFamilyIndex = IsOwnershipTransfer() ? transferFamily : VK_QUEUE_FAMILY_IGNORED;
+			barrier.dstQueueFamilyIndex = IsOwnershipTransfer() ? graphicsFamily : VK_QUEUE_FAMILY_IGNORED;
+			barrier.buffer = buffer;
+			barrier.offset = offset;
+			barrier.size = size;
+
+			recordingBufferBarriers.push_back(barrier);
+			recordingStageMask |= dstStageMask;
+			uploadedSize += size;
+			return submittedValue + 1;
+		}
+		// Queues whole image (first mip level and layer) upload, returns its batch value
+		uint64_t UploadImage(VkImage image, VkImageAspectFlags aspectMask, VkExtent3D extent, const void* data, VkDeviceSize size, VkImageLayout finalLayout, VkPipelineStageFlags dstStageMask, VkAccessFlags dstAccessMask)
+		{
+			if (!data)
+				throw ArgumentNullException("Vulkan upload data is null");
+
+			auto stagingOffset = AllocateStaging(size, StagingCopyAlignment);
+			memcpy(stagingData + stagingOffset, data, static_cast<size_t>(size));
+
+			auto commandBuffer = GetRecordingCommandBuffer();
+
+			VkImageMemoryBarrier barrier = {};
+			barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+			barrier.srcAccessMask = 0;
+			barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+			barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+			barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.image = image;
+			barrier.subresourceRange.aspectMask = aspectMask;
+			barrier.subresourceRange.baseMipLevel = 0;
+			barrier.subresourceRange.levelCount = 1;
+			barrier.subresourceRange.baseArrayLayer = 0;
+			barrier.subresourceRange.layerCount = 1;
+
+			vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+			VkBufferImageCopy region = {};
+			region.bufferOffset = stagingOffset;
+			region.bufferRowLength = 0;
+			region.bufferImageHeight = 0;
+			region.imageSubresource.aspectMask = aspectMask;
+			region.imageSubresource.mipLevel = 0;
+			region.imageSubresource.baseArrayLayer = 0;
+			region.imageSubresource.layerCount = 1;
+			region.imageOffset = { 0, 0, 0 };
+			region.imageExtent = extent;
+			vkCmdCopyBufferToImage(commandBuffer, stagingBuffer->instance, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+			// Layout transition is a part of the ownership transfer
+			barrier.srcAccessMask = IsOwnershipTransfer() ? 0 : VK_ACCESS_TRANSFER_WRITE_BIT;
+			barrier.dstAccessMask = dstAccessMask;
+			barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+			barrier.newLayout = finalLayout;
+			barrier.srcQueueFamilyIndex = IsOwnershipTransfer() ? transferFamily : VK_QUEUE_FAMILY_IGNORED;
+			barrier.dstQueueFamilyIndex = IsOwnershipTransfer() ? graphicsFamily : VK_QUEUE_FAMILY_IGNORED;
+
+			recordingImageBarriers.push_back(barrier);
+			recordingStageMask |= dstStageMask;
+			uploadedSize += size;
+			return submittedValue + 1;
+		}
+
+		// Submits queued uploads and records their acquire barriers to the graphics command buffer
+		// Returns true if the graphics submission should wait for the signal semaphore (transfer stage)
+		bool Flush(VkCommandBuffer commandBuffer, VkSemaphore signalSemaphore)
+		{
+			auto isSignaled = false;
+
+			if (recordingBatch || (IsOwnershipTransfer() && isSignalPending))
+			{
+				// Semaphore signal also covers all earlier submissions to the transfer queue
+				isSignaled = IsOwnershipTransfer();
+				SubmitBatch(isSignaled ? signalSemaphore : VK_NULL_HANDLE);
+			}
+
+			if (!acquireBufferBarriers.empty() || !acquireImageBarriers.empty())
+			{
+				vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, acquireStageMask, 0, 0, nullptr,
+					static_cast<uint32_t>(acquireBufferBarriers.size()), acquireBufferBarriers.data(), static_cast<uint32_t>(acquireImageBarriers.size()), acquireImageBarriers.data());
+
+				acquireBufferBarriers.clear();
+				acquireImageBarriers.clear();
+				acquireStageMask = 0;
+			}
+
+			return isSignaled;
+		}
+
+		// Retires all finished batches and releases their staging ranges
+		void Retire()
+		{
+			while (!submittedBatches.empty())
+			{
+				auto batch = submittedBatches.front();
+				auto result = vkGetFenceStatus(device, batch->fence);
+
+				if (result == VK_NOT_READY)
+					break;
+				else if (result != VK_SUCCESS)
+					throw VulkanException("Failed to get upload fence status. Result: " + to_string(result));
+
+				completedValue = batch->value;
+				stagingRing->Release(batch->stagingPosition);
+
+				submittedBatches.pop_front();
+				freeBatches.push_back(batch);
+			}
+		}
+		// Waits until batch with the value is finished on the transfer queue (submits it if required)
+		void Wait(uint64_t value)
+		{
+			if (value > submittedValue + (recordingBatch ? 1 : 0))
+				throw ArgumentOutOfRangeException("Vulkan upload batch value is out of range");
+
+			if (value > submittedValue)
+				SubmitBatch(VK_NULL_HANDLE);
+
+			while (completedValue < value)
+				WaitOldestBatch();
+		}
+	};
+
+	// Vulkan upload scheduler class instance
+	typedef Uploader_T* Uploader;
+
+	// Creates a new vulkan upload scheduler class instance
+	static Uploader CreateUploaderInstance(VkDevice device, Allocator allocator, VkQueue transferQueue, uint32_t transferFamily, uint32_t graphicsFamily, VkDeviceSize stagingSize)
+	{
+		return new Uploader_T(device, allocator, transferQueue, transferFamily, graphicsFamily, stagingSize);
+	}
+	// Destroys vulkan upload scheduler class instance
+	static void DestroyUploaderInstance(Uploader instance)
+	{
+		delete instance;
+	}
+}
@@ -0,0 +1,156 @@
+
+// Copyright 2019 Nikita Fediuchin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+#include "Vulkan.hpp"
+#include "Exceptions.hpp"
+#include "PipelineState.hpp"
+
+#include <vector>
+#include <cstring>
+
+using namespace std;
+
+namespace Vulkan
+{
+	// Returns vertex attribute format size in bytes
+	static uint32_t GetVertexFormatSize(VkFormat format)
+	{
+		switch (format)
+		{
+		case VK_FORMAT_R8G8B8A8_UNORM:
+		case VK_FORMAT_R8G8B8A8_SNORM:
+		case VK_FORMAT_R8G8B8A8_UINT:
+		case VK_FORMAT_R16G16_SFLOAT:
+		case VK_FORMAT_R32_SFLOAT:
+		case VK_FORMAT_R32_UINT:
+		case VK_FORMAT_R32_SINT:
+			return 4;
+		case VK_FORMAT_R16G16B16A16_SFLOAT:
+		case VK_FORMAT_R32G32_SFLOAT:
+		case VK_FORMAT_R32G32_UINT:
+		case VK_FORMAT_R32G32_SINT:
+			return 8;
+		case VK_FORMAT_R32G32B32_SFLOAT:
+		case VK_FORMAT_R32G32B32_UINT:
+		case VK_FORMAT_R32G32B32_SINT:
+			return 12;
+		case VK_FORMAT_R32G32B32A32_SFLOAT:
+		case VK_FORMAT_R32G32B32A32_UINT:
+		case VK_FORMAT_R32G32B32A32_SINT:
+			return 16;
+		default:
+			throw ArgumentException("Unsupported vertex attribute format. Format: " + to_string(format));
+		}
+	}
+
+	// Vulkan vertex layout description (one binding per vertex stream)
+	// Attribute locations are assigned sequentially across the streams
+	struct VertexLayout
+	{
+		// Vertex stream binding description array
+		vector<VkVertexInputBindingDescription> bindings;
+		// Vertex attribute description array
+		vector<VkVertexInputAttributeDescription> attributes;
+
+		// Adds a new vertex stream with packed attributes, returns its binding index
+		uint32_t AddStream(const vector<VkFormat>& formats, VkVertexInputRate inputRate)
+		{
+			if (formats.empty())
+				throw ArgumentException("Vertex stream should have at least one attribute");
+
+			VkVertexInputBindingDescription binding = {};
+			binding.binding = static_cast<uint32_t>(bindings.size());
+			binding.stride = 0;
+			binding.inputRate = inputRate;
+
+			for (auto format : formats)
+			{
+				VkVertexInputAttributeDescription attribute = {};
+				attribute.location = static_cast<uint32_t>(attributes.size());
+				attribute.binding = binding.binding;
+				attribute.format = format;
+				attribute.offset = binding.stride;
+				attributes.push_back(attribute);
+
+				binding.stride += GetVertexFormatSize(format);
+			}
+
+			bindings.push_back(binding);
+			return binding.binding;
+		}
+
+		// Returns vertex stream count
+		uint32_t GetStreamCount() const { return static_cast<uint32_t>(bindings.size()); }
+		// Returns vertex stream stride
+		uint32_t GetStride(uint32_t binding) const { return bindings.at(binding).stride; }
+
+		// Returns layout of the first vertex streams (for example position only stream for the depth pass)
+		VertexLayout GetStreams(uint32_t count) const
+		{
+			if (count > bindings.size())
+				throw ArgumentOutOfRangeException("Vertex layout stream count is out of range");
+
+			VertexLayout layout;
+			layout.bindings.assign(bindings.begin(), bindings.begin() + count);
+
+			for (const auto& attribute : attributes)
+			{
+				if (attribute.binding < count)
+					layout.attributes.push_back(attribute);
+			}
+
+			return layout;
+		}
+
+		// Returns vertex layout hash
+		uint64_t GetHash(uint64_t seed) const
+		{
+			auto hash = HashBytes(bindings.data(), bindings.size() * sizeof(VkVertexInputBindingDescription), seed);
+			return HashBytes(attributes.data(), attributes.size() * sizeof(VkVertexInputAttributeDescription), hash);
+		}
+
+		// Returns true if vertex layouts are equal
+		bool operator==(const VertexLayout& other) const
+		{
+			return bindings.size() == other.bindings.size() && attributes.size() == other.attributes.size() &&
+				memcmp(bindings.data(), other.bindings.data(), bindings.size() * sizeof(VkVertexInputBindingDescription)) == 0 &&
+				memcmp(attributes.data(), other.attributes.data(), attributes.size() * sizeof(VkVertexInputAttributeDescription)) == 0;
+		}
+		// Returns true if vertex layouts are not equal
+		bool operator!=(const VertexLayout& other) const
+		{
+			return !(*this == other);
+		}
+	};
+
+	// Creates a new interleaved vertex layout (all attributes in one stream)
+	static VertexLayout CreateInterleavedVertexLayout(const vector<VkFormat>& formats)
+	{
+		VertexLayout layout;
+		layout.AddStream(formats, VK_VERTEX_INPUT_RATE_VERTEX);
+		return layout;
+	}
+	// Creates a new split stream vertex layout (one binding per attribute group)
+	static VertexLayout CreateSplitVertexLayout(const vector<vector<VkFormat>>& streams)
+	{
+		VertexLayout layout;
+
+		for (const auto& formats : streams)
+			layout.AddStream(formats, VK_VERTEX_INPUT_RATE_VERTEX);
+
+		return layout;
+	}
+}
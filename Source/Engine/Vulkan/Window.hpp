@@ -14,12 +14,12 @@
 // limitations under the License.
 
 #pragma once
-#include "Debug.hpp"
-#include "Device.hpp"
-#include "Pipeline.hpp"
+#include "Renderer.hpp"
 #include "Swapchain.hpp"
+#include "RenderPass.hpp"
 #include "CommandPool.hpp"
-#include "Engine/EngineInfo.hpp"
+#include "Synchronization.hpp"
+#include "Engine/JobSystem.hpp"
 
 namespace Vulkan
 {
@@ -38,42 +38,6 @@ namespace Vulkan
 		return extensions;
 	}
 
-	// Creates a new vulkan instance (with debug if enabled)
-	static VkInstance CreateVulkanInstance(string appName, uint32_t appVersion, const vector<const char*>& additionalExtensions, const vector<const char*>& validationLayers, Debug& debug)
-	{
-		VkApplicationInfo appInfo = {};
-		appInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
-		appInfo.pApplicationName = appName.c_str();
-		appInfo.applicationVersion = appVersion;
-		appInfo.pEngineName = EngineName.c_str();
-		appInfo.engineVersion = EngineVersion;
-		appInfo.apiVersion = VulkanVersion;
-
-		VkInstanceCreateInfo instanceCreateInfo = {};
-		instanceCreateInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
-		instanceCreateInfo.pApplicationInfo = &appInfo;
-
-		auto extensions = GetVulkanRequiredExtensions(additionalExtensions);
-		instanceCreateInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
-		instanceCreateInfo.ppEnabledExtensionNames = extensions.data();
-
-		VkDebugUtilsMessengerCreateInfoEXT debugCreateInfo = {};
-
-		if (validationLayers.size() > 0)
-			EnableDebug(instanceCreateInfo, debugCreateInfo, validationLayers);
-
-		VkInstance instance;
-		auto result = vkCreateInstance(&instanceCreateInfo, nullptr, &instance);
-
-		if (result != VK_SUCCESS)
-			throw VulkanException("Failed to create Vulkan instance. Result: " + to_string(result));
-
-		if (validationLayers.size() > 0)
-			debug = CreateDebugInstance(instance, debugCreateInfo);
-
-		return instance;
-	}
-
 	// Creates a new vulkan window surface instance
 	static VkSurfaceKHR CreateWindowSurfaceInstance(VkInstance instance, GlfwWindow window)
 	{
@@ -87,98 +51,316 @@ namespace Vulkan
 	}
 
 	// Vulkan window class
-	class Window_T
+	class Window_T : public Renderer_T
 	{
 	protected:
-		// Vulkan instance
-		VkInstance instance;
+		// GLFW window instance
+		GlfwWindow glfwWindow;
 		// Vulkan surface instance
 		VkSurfaceKHR surface;
-
-		// Vulkan graphics queue
-		VkQueue graphicsQueue;
 		// Vulkan present queue (image to surface)
 		VkQueue presentQueue;
 
-		// Vulkan debug instance
-		Debug debug;
-		// Vulkan device instance
-		Device device;
+		// Vulkan window device information
+		WindowDeviceInfo deviceInfo;
 		// Vulkan swapchain instance
 		Swapchain swapchain;
-		// Vulkan graphics pipeline instance
-		Pipeline graphicsPipeline;
-		// VUlkan command pool instance
-		CommandPool commandPool;
-
-		VkSemaphore imageAvailableSemaphore;
-		VkSemaphore renderFinishedSemaphore;
+		// Vulkan swapchain render pass instance
+		RenderPass renderPass;
+		// Vulkan command pool array (one transient pool per frame in flight)
+		vector<CommandPool> commandPools;
+		// Vulkan secondary command pool array (one transient pool per record thread per frame in flight)
+		vector<vector<CommandPool>> secondaryCommandPools;
+		// Recorded secondary command buffer array (one per record thread)
+		vector<VkCommandBuffer> secondaryCommandBuffers;
+
+		// Command record job system (not owned, calling thread records too)
+		JobSystem* jobSystem;
+		// Command record thread count (one secondary command buffer per job system thread)
+		uint32_t recordThreadCount;
+
+		// Image available semaphore array (one per frame in flight)
+		vector<VkSemaphore> imageAvailableSemaphores;
+		// Render finished semaphore array (one per frame in flight)
+		vector<VkSemaphore> renderFinishedSemaphores;
+		// Upload finished semaphore array (one per frame in flight)
+		vector<VkSemaphore> uploadFinishedSemaphores;
+		// Frame in flight fence array (one per frame in flight)
+		vector<VkFence> inFlightFences;
+		// Swapchain image fence array (fence of the frame which is using the image)
+		vector<VkFence> imagesInFlight;
+
+		// Is window framebuffer resized since the last frame (set from the window event thread)
+		atomic<bool> isFramebufferResized;
+		// Swapchain recreation count
+		size_t swapchainRecreateCount;
+		// Last swapchain recreation time in seconds
+		double swapchainRecreateTime;
 
 	public:
 		// Creates a new vulkan window class instance
-		Window_T(GlfwWindow glfwWindow, VkExtent2D windowSize, string appName, uint32_t appVersion, const vector<const char*>& vulkanExtensions, const vector<const char*>& validationLayers, const vector<const char*>& deviceExtensions)
+		Window_T(GlfwWindow _glfwWindow, VkExtent2D windowSize, string appName, uint32_t appVersion, const vector<const char*>& vulkanExtensions, const vector<const char*>& validationLayers, const vector<const char*>& deviceExtensions, uint32_t _inFlightFrameCount, JobSystem* _jobSystem) :
+			Renderer_T(_inFlightFrameCount)
 		{
-			instance = CreateVulkanInstance(appName, appVersion, vulkanExtensions, validationLayers, debug);
-			surface = CreateWindowSurfaceInstance(instance, glfwWindow);
+			if (!_jobSystem)
+				throw ArgumentNullException("Vulkan window record job system is null");
+
+			glfwWindow = _glfwWindow;
+			instance = CreateVulkanInstance(appName, appVersion, GetVulkanRequiredExtensions(vulkanExtensions), validationLayers, debug);
+			surface = CreateWindowSurfaceInstance(instance, _glfwWindow);
 
-			auto deviceInfo = CreateWindowDeviceInfoInstance(surface, windowSize, deviceExtensions);
+			deviceInfo = CreateWindowDeviceInfoInstance(surface, windowSize, deviceExtensions);
 			device = CreateDeviceInstance(deviceInfo, instance, surface, validationLayers, deviceExtensions);
 
 			auto logicalDevice = device->GetInstance();
-			vkGetDeviceQueue(logicalDevice, deviceInfo->GetGraphicsFamily(), 0, &graphicsQueue);
 			vkGetDeviceQueue(logicalDevice, deviceInfo->GetPresentFamily(), 0, &presentQueue);
-
-			swapchain = CreateSwapchainInstance(logicalDevice, deviceInfo);
-			graphicsPipeline = CreatePipelineInstance(logicalDevice, deviceInfo, swapchain->GetImageViews());
-			commandPool = CreateCommandPoolInstance(logicalDevice, deviceInfo, graphicsPipeline->renderPass, deviceInfo->GetSurfaceExtent(), graphicsPipeline->instance, graphicsPipeline->framebuffers);
-
-			VkSemaphoreCreateInfo semaphoreInfo = {};
-			semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
-
-			if (vkCreateSemaphore(logicalDevice, &semaphoreInfo, nullptr, &imageAvailableSemaphore) != VK_SUCCESS ||
-				vkCreateSemaphore(logicalDevice, &semaphoreInfo, nullptr, &renderFinishedSemaphore) != VK_SUCCESS) {
-				throw std::runtime_error("failed to create semaphores!");
+			CreateDeviceResources(deviceInfo->GetGraphicsFamily(), deviceInfo->GetTransferFamily());
+
+			swapchain = CreateSwapchainInstance(logicalDevice, deviceInfo, VK_NULL_HANDLE);
+			renderPass = CreateRenderPassInstance(logicalDevice, deviceInfo->GetSurfaceFormat().format, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, deviceInfo->GetSurfaceExtent(), swapchain->GetImageViews());
+			CreateTriangle(renderPass->instance);
+
+			isFramebufferResized = false;
+			swapchainRecreateCount = 0;
+			swapchainRecreateTime = 0.0;
+			jobSystem = _jobSystem;
+			recordThreadCount = static_cast<uint32_t>(_jobSystem->GetThreadCount());
+
+			imageAvailableSemaphores.resize(_inFlightFrameCount);
+			renderFinishedSemaphores.resize(_inFlightFrameCount);
+			uploadFinishedSemaphores.resize(_inFlightFrameCount);
+			inFlightFences.resize(_inFlightFrameCount);
+			commandPools.resize(_inFlightFrameCount);
+			secondaryCommandPools.resize(_inFlightFrameCount);
+			secondaryCommandBuffers.resize(recordThreadCount);
+
+			for (uint32_t i = 0; i < _inFlightFrameCount; i++)
+			{
+				commandPools[i] = CreateCommandPoolInstance(logicalDevice, deviceInfo->GetGraphicsFamily(), VK_COMMAND_POOL_CREATE_TRANSIENT_BIT, VK_COMMAND_BUFFER_LEVEL_PRIMARY);
+				secondaryCommandPools[i].resize(recordThreadCount);
+
+				for (uint32_t j = 0; j < recordThreadCount; j++)
+					secondaryCommandPools[i][j] = CreateCommandPoolInstance(logicalDevice, deviceInfo->GetGraphicsFamily(), VK_COMMAND_POOL_CREATE_TRANSIENT_BIT, VK_COMMAND_BUFFER_LEVEL_SECONDARY);
+
+				imageAvailableSemaphores[i] = CreateSemaphoreInstance(logicalDevice);
+				renderFinishedSemaphores[i] = CreateSemaphoreInstance(logicalDevice);
+				uploadFinishedSemaphores[i] = CreateSemaphoreInstance(logicalDevice);
+				inFlightFences[i] = CreateFenceInstance(logicalDevice, VK_FENCE_CREATE_SIGNALED_BIT);
 			}
 
+			imagesInFlight.resize(swapchain->GetImages().size(), VK_NULL_HANDLE);
 		}
 		// Destroys vulkan window class instance
-		~Window_T()
+		virtual ~Window_T()
 		{
-			vkDestroySemaphore(device->GetInstance(), renderFinishedSemaphore, nullptr);
-			vkDestroySemaphore(device->GetInstance(), imageAvailableSemaphore, nullptr);
+			auto logicalDevice = device->GetInstance();
+			vkDeviceWaitIdle(logicalDevice);
+
+			for (uint32_t i = 0; i < inFlightFrameCount; i++)
+			{
+				for (auto secondaryCommandPool : secondaryCommandPools[i])
+					DestroyCommandPoolInstance(secondaryCommandPool);
+
+				vkDestroyFence(logicalDevice, inFlightFences[i], nullptr);
+				vkDestroySemaphore(logicalDevice, uploadFinishedSemaphores[i], nullptr);
+				vkDestroySemaphore(logicalDevice, renderFinishedSemaphores[i], nullptr);
+				vkDestroySemaphore(logicalDevice, imageAvailableSemaphores[i], nullptr);
+				DestroyCommandPoolInstance(commandPools[i]);
+			}
 
-			DestroyCommandPoolInstance(commandPool);
-			DestroyPipelineInstance(graphicsPipeline);
+			DestroyRenderPassInstance(renderPass);
 			DestroySwapchainInstance(swapchain);
-			DestroyDeviceInstance(device);
+			DestroyDeviceResources();
+			DestroyWindowDeviceInfoInstance(deviceInfo);
 			vkDestroySurfaceKHR(instance, surface, nullptr);
-			DestroyDebugInstance(debug);
-			vkDestroyInstance(instance, nullptr);
+			DestroyInstance();
+		}
+
+	protected:
+		// Records frame draw commands to the primary command buffer
+		virtual void RecordCommands(VkCommandBuffer commandBuffer, uint32_t imageIndex)
+		{
+			VkRenderPassBeginInfo renderPassInfo = {};
+			renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+			renderPassInfo.renderPass = renderPass->instance;
+			renderPassInfo.framebuffer = renderPass->framebuffers[imageIndex];
+			renderPassInfo.renderArea.offset = { 0, 0 };
+			renderPassInfo.renderArea.extent = renderPass->extent;
+
+			auto clearColor = GetClearValue();
+			renderPassInfo.clearValueCount = 1;
+			renderPassInfo.pClearValues = &clearColor;
+
+			vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+
+			auto& framePools = secondaryCommandPools[currentFrame];
+			auto framebuffer = renderPassInfo.framebuffer;
+
+			// One range per secondary command buffer, so each pool is used by a single job at a time
+			jobSystem->ParallelFor(recordThreadCount, 1, [&](size_t begin, size_t end)
+			{
+				auto secondaryCommandBuffer = framePools[begin]->Begin(renderPass->instance, 0, framebuffer);
+				RecordDrawCommands(secondaryCommandBuffer, begin, recordThreadCount);
+				framePools[begin]->End();
+
+				secondaryCommandBuffers[begin] = secondaryCommandBuffer;
+			});
+
+			vkCmdExecuteCommands(commandBuffer, recordThreadCount, secondaryCommandBuffers.data());
+			vkCmdEndRenderPass(commandBuffer);
+		}
+		// Records part of the frame draw commands to the secondary command buffer (called from the job system threads)
+		virtual void RecordDrawCommands(VkCommandBuffer commandBuffer, size_t threadIndex, size_t threadCount)
+		{
+			// Dynamic state is not inherited by the secondary command buffers, triangle sets it
+			if (threadIndex == 0)
+				RecordTriangle(commandBuffer, renderPass->extent);
+		}
+
+		// Recreates swapchain, its image views and framebuffers (pipelines are kept)
+		// Framebuffer size is passed in, so GLFW is not called and the render thread can recreate it.
+		void RecreateSwapchain(VkExtent2D windowSize)
+		{
+			auto recreateStartTime = chrono::high_resolution_clock::now();
+			auto logicalDevice = device->GetInstance();
+			vkDeviceWaitIdle(logicalDevice);
+
+			// Captured frames are taken before the readback slots are resized
+			CollectCaptures();
+
+			deviceInfo->UpdateSurfaceExtent(device->GetPhysicalDevice(), windowSize);
+
+			auto oldSwapchain = swapchain;
+			swapchain = CreateSwapchainInstance(logicalDevice, deviceInfo, oldSwapchain->GetInstance());
+			DestroySwapchainInstance(oldSwapchain);
+
+			renderPass->RecreateFramebuffers(swapchain->GetExtent(), swapchain->GetImageViews());
+			imagesInFlight.assign(swapchain->GetImages().size(), VK_NULL_HANDLE);
+
+			auto extent = swapchain->GetExtent();
+
+			if (readback && (readback->GetExtent().width != extent.width || readback->GetExtent().height != extent.height))
+			{
+				DestroyReadbackInstance(readback);
+				readback = CreateReadbackInstance(logicalDevice, allocator, extent, deviceInfo->GetSurfaceFormat().format, inFlightFrameCount);
+			}
+
+			isFramebufferResized = false;
+			swapchainRecreateCount++;
+			swapchainRecreateTime = chrono::duration<double>(chrono::high_resolution_clock::now() - recreateStartTime).count();
+		}
+
+	public:
+		// Marks window framebuffer as resized (swapchain is recreated on the next frame)
+		void OnFramebufferResize() { isFramebufferResized = true; }
+		// Returns swapchain recreation count
+		size_t GetSwapchainRecreateCount() { return swapchainRecreateCount; }
+		// Returns last swapchain recreation time in seconds
+		double GetSwapchainRecreateTime() { return swapchainRecreateTime; }
+		// Returns command record thread count
+		uint32_t GetRecordThreadCount() { return recordThreadCount; }
+		// Returns swapchain extent
+		VkExtent2D GetExtent() { return swapchain->GetExtent(); }
+		// Returns true if swapchain images can be captured (transfer source usage and 8 bit color format)
+		bool IsCaptureSupported()
+		{
+			return (deviceInfo->GetSurfaceCapabilities().supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_SRC_BIT) &&
+				IsReadbackFormatSupported(deviceInfo->GetSurfaceFormat().format);
 		}
 
-		void DrawFrame()
+		// Sets captured frame encoder, creates swapchain readback slots on the first use
+		void SetFrameEncoder(FrameEncoder* encoder)
 		{
+			if (encoder && !IsCaptureSupported())
+				throw VulkanException("Vulkan swapchain images can not be captured on this device");
+
+			Renderer_T::SetFrameEncoder(encoder);
+
+			if (encoder && !readback)
+				readback = CreateReadbackInstance(device->GetInstance(), allocator, swapchain->GetExtent(), deviceInfo->GetSurfaceFormat().format, inFlightFrameCount);
+		}
+
+		// Draws a new window frame from the render packet (frame is skipped if framebuffer is empty)
+		void DrawFrame(const RenderPacket& packet)
+		{
+			VkExtent2D windowSize = { packet.framebufferWidth, packet.framebufferHeight };
+
+			// Window is minimized, there is nothing to present
+			if (windowSize.width == 0 || windowSize.height == 0)
+				return;
+
+			auto logicalDevice = device->GetInstance();
+			auto inFlightFence = inFlightFences[currentFrame];
+			auto imageAvailableSemaphore = imageAvailableSemaphores[currentFrame];
+			auto renderFinishedSemaphore = renderFinishedSemaphores[currentFrame];
+			auto uploadFinishedSemaphore = uploadFinishedSemaphores[currentFrame];
+
+			if (graphicsPipeline->IsFailed())
+				throw VulkanException("Failed to compile graphics pipeline. " + graphicsPipeline->GetError());
+
+			auto waitStartTime = chrono::high_resolution_clock::now();
+			vkWaitForFences(logicalDevice, 1, &inFlightFence, VK_TRUE, UINT64_MAX);
+
+			// Frame fence is signaled, so the slot pixels captured by the older frame are ready
+			CollectCapture(currentFrame);
+
 			uint32_t imageIndex;
-			vkAcquireNextImageKHR(device->GetInstance(), swapchain->GetInstance(), UINT64_MAX, imageAvailableSemaphore, VK_NULL_HANDLE, &imageIndex);
+			auto result = vkAcquireNextImageKHR(logicalDevice, swapchain->GetInstance(), UINT64_MAX, imageAvailableSemaphore, VK_NULL_HANDLE, &imageIndex);
+
+			if (result == VK_ERROR_OUT_OF_DATE_KHR)
+			{
+				RecreateSwapchain(windowSize);
+				return;
+			}
+			else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR)
+			{
+				throw VulkanException("Failed to acquire next swapchain image. Result: " + to_string(result));
+			}
+
+			// Swapchain image can still be used by the older frame
+			if (imagesInFlight[imageIndex] != VK_NULL_HANDLE)
+				vkWaitForFences(logicalDevice, 1, &imagesInFlight[imageIndex], VK_TRUE, UINT64_MAX);
+
+			imagesInFlight[imageIndex] = inFlightFence;
+			frameWaitTime = chrono::duration<double>(chrono::high_resolution_clock::now() - waitStartTime).count();
+
+			// Frame fence is signaled, so the whole frame command pool can be reset
+			auto recordStartTime = chrono::high_resolution_clock::now();
+			auto commandPool = commandPools[currentFrame];
+			auto commandBuffer = commandPool->Begin();
+
+			// Frame fence is signaled, so the previous wait on the upload semaphore is finished too
+			uploader->Retire();
+			auto isUploadWaiting = uploader->Flush(commandBuffer, uploadFinishedSemaphore);
+
+			memcpy(frameClearColor, packet.clearColor, sizeof(frameClearColor));
+			RecordCommands(commandBuffer, imageIndex);
+			RecordCapture(commandBuffer, packet, swapchain->GetImages()[imageIndex], VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+			commandPool->End();
+			frameRecordTime = chrono::duration<double>(chrono::high_resolution_clock::now() - recordStartTime).count();
 
 			VkSubmitInfo submitInfo = {};
 			submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 
-			VkSemaphore waitSemaphores[] = { imageAvailableSemaphore };
-			VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
-			submitInfo.waitSemaphoreCount = 1;
+			VkSemaphore waitSemaphores[] = { imageAvailableSemaphore, uploadFinishedSemaphore };
+			VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT };
+			submitInfo.waitSemaphoreCount = isUploadWaiting ? 2 : 1;
 			submitInfo.pWaitSemaphores = waitSemaphores;
 			submitInfo.pWaitDstStageMask = waitStages;
 			submitInfo.commandBufferCount = 1;
-			submitInfo.pCommandBuffers = &commandPool->commandBuffers[imageIndex];
+			submitInfo.pCommandBuffers = &commandBuffer;
 
 			VkSemaphore signalSemaphores[] = { renderFinishedSemaphore };
 			submitInfo.signalSemaphoreCount = 1;
 			submitInfo.pSignalSemaphores = signalSemaphores;
 
-			if (vkQueueSubmit(graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS) {
-				throw std::runtime_error("failed to submit draw command buffer!");
-			}
+			vkResetFences(logicalDevice, 1, &inFlightFence);
+
+			result = vkQueueSubmit(graphicsQueue, 1, &submitInfo, inFlightFence);
+			if (result != VK_SUCCESS)
+				throw VulkanException("Failed to submit draw command buffer. Result: " + to_string(result));
+
+			RecordSubmitLatency(packet);
 
 			VkPresentInfoKHR presentInfo = {};
 			presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
@@ -191,7 +373,13 @@ namespace Vulkan
 			presentInfo.pImageIndices = &imageIndex;
 			presentInfo.pResults = nullptr; // Optional
 
-			vkQueuePresentKHR(presentQueue, &presentInfo);
+			result = vkQueuePresentKHR(presentQueue, &presentInfo);
+			currentFrame = (currentFrame + 1) % inFlightFrameCount;
+
+			if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || isFramebufferResized)
+				RecreateSwapchain(windowSize);
+			else if (result != VK_SUCCESS)
+				throw VulkanException("Failed to present swapchain image. Result: " + to_string(result));
 		}
 	};
 
@@ -199,9 +387,9 @@ namespace Vulkan
 	typedef Window_T* Window;
 
 	// Creates a new vulkan window class instance
-	static Window CreateWindowInstance(GlfwWindow glfwWindow, VkExtent2D windowSize, string appName, uint32_t appVersion, const vector<const char*>& validationLayers, const vector<const char*>& vulkanExtensions, const vector<const char*>& deviceExtensions)
+	static Window CreateWindowInstance(GlfwWindow glfwWindow, VkExtent2D windowSize, string appName, uint32_t appVersion, const vector<const char*>& validationLayers, const vector<const char*>& vulkanExtensions, const vector<const char*>& deviceExtensions, uint32_t inFlightFrameCount, JobSystem* jobSystem)
 	{
-		return new Window_T(glfwWindow, windowSize, appName, appVersion, validationLayers, vulkanExtensions, deviceExtensions);
+		return new Window_T(glfwWindow, windowSize, appName, appVersion, validationLayers, vulkanExtensions, deviceExtensions, inFlightFrameCount, jobSystem);
 	}
 	// Destroys vulkan window class instance
 	static void DestroyWindowInstance(Window instance)
@@ -77,6 +77,13 @@ namespace Vulkan
 		optional<uint32_t> graphicsFamily;
 		// Present queue family
 		optional<uint32_t> presentFamily;
+		// Transfer only queue family (dedicated DMA engine, optional)
+		optional<uint32_t> transferFamily;
+
+		// Physical device surface format array
+		vector<VkSurfaceFormatKHR> surfaceFormats;
+		// Physical device present mode array
+		vector<VkPresentModeKHR> presentModes;
 
 		// Physical device surface capabilities
 		VkSurfaceCapabilitiesKHR surfaceCapabilities;
@@ -96,21 +103,29 @@ namespace Vulkan
 			vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
 			vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
 
+			graphicsFamily.reset();
+			presentFamily.reset();
+			transferFamily.reset();
+
 			for (uint32_t i = 0; i < queueFamilyCount; i++)
 			{
 				auto queueFamily = queueFamilies[i];
 
-				if (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT)
+				if (!graphicsFamily.has_value() && (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT))
 					graphicsFamily = i;
 
 				VkBool32 presentSupport = false;
 				vkGetPhysicalDeviceSurfaceSupportKHR(physicalDevice, i, surface, &presentSupport);
 
-				if (presentSupport)
+				if (!presentFamily.has_value() && presentSupport)
 					presentFamily = i;
 
-				if (graphicsFamily.has_value() && presentFamily.has_value())
-					break;
+				// Prefer pure transfer family over the async compute one
+				if ((queueFamily.queueFlags & VK_QUEUE_TRANSFER_BIT) && !(queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT))
+				{
+					if (!transferFamily.has_value() || !(queueFamily.queueFlags & VK_QUEUE_COMPUTE_BIT))
+						transferFamily = i;
+				}
 			}
 		}
 
@@ -125,7 +140,7 @@ namespace Vulkan
 			if (formatCount == 0)
 				throw VulkanException("Failed to get physical device surafce formats");
 
-			vector<VkSurfaceFormatKHR> surfaceFormats;
+			surfaceFormats.resize(formatCount);
 			vkGetPhysicalDeviceSurfaceFormatsKHR(physicalDevice, surface, &formatCount, surfaceFormats.data());
 
 			uint32_t presentModeCount;
@@ -134,7 +149,7 @@ namespace Vulkan
 			if (presentModeCount == 0)
 				throw VulkanException("Failed to get physical device present modes");
 
-			vector<VkPresentModeKHR> presentModes;
+			presentModes.resize(presentModeCount);
 			vkGetPhysicalDeviceSurfacePresentModesKHR(physicalDevice, surface, &presentModeCount, presentModes.data());
 
 			surfaceFormat = GetBestSurfaceFormat(surfaceFormats);
@@ -169,6 +184,10 @@ namespace Vulkan
 		uint32_t GetGraphicsFamily() { return graphicsFamily.value(); }
 		// Returns present family value
 		uint32_t GetPresentFamily() { return presentFamily.value(); }
+		// Returns true if device has a dedicated transfer only family
+		bool HasTransferFamily() { return transferFamily.has_value(); }
+		// Returns transfer family value (graphics family if there is no dedicated one)
+		uint32_t GetTransferFamily() { return transferFamily.has_value() ? transferFamily.value() : graphicsFamily.value(); }
 
 		// Returns physical device surface capabilities
 		VkSurfaceCapabilitiesKHR GetSurfaceCapabilities() { return surfaceCapabilities; }
@@ -186,6 +205,18 @@ namespace Vulkan
 			UpdateSwapchain(physicalDevice);
 		}
 
+		// Updates surface capabilities and extent after the window resize
+		void UpdateSurfaceExtent(VkPhysicalDevice physicalDevice, VkExtent2D _windowSize)
+		{
+			windowSize = _windowSize;
+
+			auto result = vkGetPhysicalDeviceSurfaceCapabilitiesKHR(physicalDevice, surface, &surfaceCapabilities);
+			if (result != VK_SUCCESS)
+				throw VulkanException("Failed to get physical device surface capabilities. Result: " + to_string(result));
+
+			surfaceExtent = GetBestExtent(surfaceCapabilities, _windowSize);
+		}
+
 		// Returns true if device information is valid
 		bool IsValid(VkPhysicalDevice physicalDevice)
 		{
@@ -228,17 +259,23 @@ namespace Vulkan
 			queueCreateInfo.queueCount = 1;
 			queueCreateInfo.pQueuePriorities = queuePriority;
 
-			if (graphicsFamily == presentFamily)
-			{
-				queueCreateInfo.queueFamilyIndex = graphicsFamily.value();
-				queueCreateInfos.push_back(queueCreateInfo);
-			}
-			else
+			// Each queue family can be requested only once
+			uint32_t families[] = { graphicsFamily.value(), presentFamily.value(), GetTransferFamily() };
+
+			for (auto family : families)
 			{
-				queueCreateInfo.queueFamilyIndex = graphicsFamily.value();
-				queueCreateInfos.push_back(queueCreateInfo);
+				auto isRequested = false;
+
+				for (const auto& info : queueCreateInfos)
+				{
+					if (info.queueFamilyIndex == family)
+						isRequested = true;
+				}
+
+				if (isRequested)
+					continue;
 
-				queueCreateInfo.queueFamilyIndex = presentFamily.value();
+				queueCreateInfo.queueFamilyIndex = family;
 				queueCreateInfos.push_back(queueCreateInfo);
 			}
 
@@ -15,18 +15,89 @@
 
 #include "Engine/Graphics.hpp"
 
+#include <cmath>
+#include <cctype>
+#include <cstring>
+
 const int windowWidth = 800;
 const int windowHeight = 600;
 
 const VkExtent2D windowSize = { 800, 600 };
 const string appName = "Engine Dev";
 const uint32_t appVersion = VK_MAKE_VERSION(0, 1, 0);
+const uint32_t inFlightFrameCount = 2;
+const uint32_t recordThreadCount = 4;
+const bool isRenderThreaded = true;
+const double simulationTickRate = 30.0;
+const uint64_t headlessFrameCount = 1000;
 
 vector<const char*> vulkanExtensions = {};
 vector<const char*> validationLayers = {};
 vector<const char*> deviceExtensions = {};
 
-int main()
+// Prints captured frame statistics
+void PrintCaptureStats(Graphics& graphics)
+{
+	if (!graphics.IsCapturing())
+		return;
+
+	std::cout << "Captured frames: " << graphics.GetCapturedFrameCount() << " written, " << graphics.GetDroppedCaptureCount() <<
+		" dropped (" << graphics.GetAverageCaptureTime() * 1000.0 << " ms average encode time)" << std::endl;
+}
+
+// Prints pipeline, latency and frame time statistics of the window loop ("--stats")
+void PrintLoopStats(Graphics& graphics)
+{
+	if (graphics.IsPipelineReady())
+	{
+		std::cout << "Pipeline creation time: " << graphics.GetPipelineCreationTime() * 1000.0 << " ms (" <<
+			(graphics.IsPipelineCacheLoaded() ? "warm" : "cold") << " pipeline cache)" << std::endl;
+	}
+
+	auto pipelineStats = graphics.GetPipelineRegistryStats();
+	std::cout << "Unique pipelines: " << pipelineStats.pipelineCount << " (hits: " << pipelineStats.hitCount <<
+		", misses: " << pipelineStats.missCount << ", compile time: " << pipelineStats.compileTime * 1000.0 << " ms)" << std::endl;
+
+	std::cout << "Input to submit latency: " << graphics.GetAverageSubmitLatency() * 1000.0 << " ms average, " <<
+		graphics.GetMaxSubmitLatency() * 1000.0 << " ms max (" << graphics.GetSubmittedFrameCount() << " frames, " <<
+		(graphics.IsRenderThreaded() ? "render thread" : "single thread") << ")" << std::endl;
+
+	auto frameTimes = graphics.GetFrameTimeSummary();
+	std::cout << "Frame time: " << frameTimes.minTime * 1000.0 << " ms min, " << frameTimes.averageTime * 1000.0 << " ms average, " <<
+		frameTimes.p99Time * 1000.0 << " ms p99 (" << graphics.GetSimulatedTickCount() << " ticks, " << graphics.GetDroppedTickCount() << " dropped)" << std::endl;
+}
+
+// Renders frames back to back without a window and prints the throughput ("--headless [frame count]")
+int RunHeadless(uint64_t frameCount, const string& capturePrefix)
+{
+	auto graphics = Graphics::CreateHeadless(windowSize, appName, appVersion, vulkanExtensions, validationLayers, deviceExtensions, inFlightFrameCount, isRenderThreaded);
+
+	if (!capturePrefix.empty())
+		graphics.StartCapture(capturePrefix, ImageFileFormat::Png);
+
+	auto startTime = chrono::high_resolution_clock::now();
+
+	graphics.RenderFrames(frameCount, [&](RenderPacket& packet)
+	{
+		packet.clearColor[2] = static_cast<float>(packet.frameIndex % 256) / 255.0f;
+	});
+
+	vector<uint8_t> pixels;
+	graphics.ReadFrame(pixels);
+
+	auto totalTime = chrono::duration<double>(chrono::high_resolution_clock::now() - startTime).count();
+	auto frameTimes = graphics.GetFrameTimeSummary();
+
+	std::cout << "Headless frames: " << graphics.GetSubmittedFrameCount() << " in " << totalTime * 1000.0 << " ms (" <<
+		graphics.GetSubmittedFrameCount() / totalTime << " fps, " << graphics.GetFrameExtent().width << "x" << graphics.GetFrameExtent().height << ")" << std::endl;
+	std::cout << "Frame time: " << frameTimes.minTime * 1000.0 << " ms min, " << frameTimes.averageTime * 1000.0 << " ms average, " <<
+		frameTimes.p99Time * 1000.0 << " ms p99, " << frameTimes.maxTime * 1000.0 << " ms max" << std::endl;
+	PrintCaptureStats(graphics);
+
+	return EXIT_SUCCESS;
+}
+
+int main(int argc, char* argv[])
 {
 	try
 	{
@@ -35,10 +106,59 @@ int main()
 		validationLayers.push_back("VK_LAYER_KHRONOS_validation");
 #endif
 
+		// "--capture <file prefix>" writes every loop frame as the PNG image, "--stats" prints loop statistics
+		auto isHeadless = false;
+		auto isStatsPrinted = false;
+		auto frameCount = headlessFrameCount;
+		string capturePrefix;
+
+		for (int i = 1; i < argc; i++)
+		{
+			if (strcmp(argv[i], "--headless") == 0)
+			{
+				isHeadless = true;
+
+				if (i + 1 < argc && isdigit(argv[i + 1][0]))
+					frameCount = strtoull(argv[++i], nullptr, 10);
+			}
+			else if (strcmp(argv[i], "--capture") == 0 && i + 1 < argc)
+			{
+				capturePrefix = argv[++i];
+			}
+			else if (strcmp(argv[i], "--stats") == 0)
+			{
+				isStatsPrinted = true;
+			}
+		}
+
+		if (isHeadless)
+			return RunHeadless(frameCount, capturePrefix);
+
 		deviceExtensions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
 
-		auto graphics = Graphics(windowSize, appName, appVersion, vulkanExtensions, validationLayers, deviceExtensions);
-		graphics.EnterLoop();
+		auto graphics = Graphics(windowSize, appName, appVersion, vulkanExtensions, validationLayers, deviceExtensions, inFlightFrameCount, recordThreadCount, isRenderThreaded);
+
+		if (!capturePrefix.empty())
+			graphics.StartCapture(capturePrefix, ImageFileFormat::Png);
+
+		// Background pulse is simulated at the fixed tick rate and interpolated at the display rate
+		float previousPulse = 0.0f, currentPulse = 0.0f;
+
+		graphics.EnterLoop(simulationTickRate, [&](double tickTime, uint64_t tickIndex)
+		{
+			previousPulse = currentPulse;
+			currentPulse = 0.5f + 0.5f * std::sin(static_cast<float>(tickIndex * tickTime));
+		},
+		[&](RenderPacket& packet)
+		{
+			auto pulse = previousPulse + (currentPulse - previousPulse) * packet.interpolationAlpha;
+			packet.clearColor[2] = pulse * 0.25f;
+		});
+
+		if (isStatsPrinted)
+			PrintLoopStats(graphics);
+
+		PrintCaptureStats(graphics);
 	}
 	catch (const std::exception & e)
 	{